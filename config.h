@@ -85,7 +85,9 @@
  * just fix your 'gs' so it looks in the right places without being told...)
  *
  * GS_DEV is the file format that ghostscript will convert PS into.  It
- * should not need to be changed
+ * should not need to be changed.  (As long as it's one of the PBM/PGM/PPM
+ * devices, pages are read straight out of a pipe, and only rendered when
+ * they're looked at.  PDF files are read, too.)
  */
 
 /* #define GS_PATH "/usr/local/bin/gs" */
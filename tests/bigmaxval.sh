@@ -0,0 +1,30 @@
+#!/bin/sh
+#
+# bigmaxval.sh - regression test for PGM files with maxval > 65535
+#
+# Such a file is too deep for a DEEPPIC, and once overran its histogram.
+# It should load the old way (dropping bits), and convert without trouble.
+#
+# usage:  sh tests/bigmaxval.sh [path-to-xv]
+
+XV=${1:-./xv}
+TMP=${TMPDIR:-/tmp}/xvtest.$$
+
+mkdir $TMP $TMP/out || exit 1
+trap 'rm -rf $TMP' 0
+
+printf 'P2\n2 2\n1000000\n0 999999 500000 1000000\n' > $TMP/big.pgm
+
+if $XV -convert pgm -odir $TMP/out $TMP/big.pgm; then :
+else
+  echo "bigmaxval: xv -convert failed on $TMP/big.pgm" 1>&2
+  exit 1
+fi
+
+if [ ! -s $TMP/out/big.pgm ]; then
+  echo "bigmaxval: no output written" 1>&2
+  exit 1
+fi
+
+echo "bigmaxval: ok"
+exit 0
@@ -43,6 +43,10 @@
 /*                                                                  */
 /*    VDCOMP [infile] [outfile] [output format]                     */
 /*                                                                  */
+/*  or, to decompress many files at once (not on VMS):              */
+/*                                                                  */
+/*    VDCOMP -b [-f format] [-j jobs] [-o outdir] file|dir ...      */
+/*                                                                  */
 /*       infile        - name of compressed image file.             */
 /*       outfile       - name of uncompressed output file.          */
 /*       output format - selected from the following list:          */
@@ -71,6 +75,13 @@
 /*  portability conflicts.                                          */
 /*                                                                  */
 /* HIST                                                             */
+/*  Added batch mode ('-b'), which decompresses any number of files */
+/*  (or all the .IMQ files in a directory), several at once, and    */
+/*  buffered the input.                                             */
+/*  Huffman tree nodes come out of one fixed array, rather than a   */
+/*  malloc() apiece, and dcmprs() decodes all codes of up to        */
+/*  LOOKUP_BITS bits with a single table lookup, rather than        */
+/*  walking the tree a bit at a time.                               */
 /*  bradley@cis.upenn.edu 06-23-94 ansi-fied program                */
 /*  datri@convex.com, 11-15-91 added recognition of - as stdout for */
 /*  	output filename; disabled various messages; directed        */
@@ -121,6 +132,12 @@
 
 #include <X11/Xos.h>
 
+#ifndef VMS
+#  include <sys/stat.h>
+#  include <sys/wait.h>
+#  include <dirent.h>
+#endif
+
 #define TRUE                  1
 #define FALSE                 0
 
@@ -139,11 +156,31 @@ typedef struct leaf { struct leaf *right;
 
 /*************************************************************************
  Declare the tree pointer. This pointer will hold the root of the tree
- once the tree is created by the accompanying routine huff_tree.
+ once the tree is created by the accompanying routine huff_tree.  The
+ nodes all come out of node_pool: there are at most 512 leaves, and the
+ 511 nodes that join them together.
 **************************************************************************/
 
   NODE *tree;
 
+#define MAX_NODES    1023
+  NODE  node_pool[MAX_NODES];
+  int   nodes_used = 0;
+
+/*************************************************************************
+ The lookup table used by dcmprs.  Entry 'i' is for the codes that start
+ with the LOOKUP_BITS bits of 'i'.  If the code is no longer than that,
+ 'len' is its length, and 'dn' its value.  Otherwise, 'len' is 0, and
+ dcmprs walks the tree.
+**************************************************************************/
+
+#define LOOKUP_BITS  10
+#define LOOKUP_SIZE  (1 << LOOKUP_BITS)
+
+  struct lookup { short int dn;
+		  short int len;
+		} lookup[LOOKUP_SIZE];
+
 /* subroutine definitions                                           */
 
 #undef PARM
@@ -154,6 +191,10 @@ typedef struct leaf { struct leaf *right;
 #endif
 
 int  main         PARM((int, char **));
+int  decomp       PARM((int));
+int  batch_main   PARM((int, char **));
+int  batch_file   PARM((char *, char *, int));
+int  read_in      PARM((char *, int));
 void pds_labels   PARM((int));
 void fits_labels  PARM((int));
 void vicar_labels PARM((int));
@@ -168,9 +209,9 @@ int  read_var     PARM((char *, int));
 NODE *huff_tree   PARM((int *));
 NODE *new_node    PARM((int));
 void sort_freq    PARM((int *, NODE **, int));
+void make_lookup  PARM((NODE *));
 void dcmprs       PARM((char *, char *, int *, int *, NODE *));
 void free_tree    PARM((int *));
-int  free_node    PARM((NODE *, int));
 
 /* global variables                                                 */
 
@@ -181,6 +222,11 @@ int                output_format;
 int                record_bytes, max_lines;
 int                line_samples, fits_pad;
 int               label_checksum = 0L, checksum = 0L;
+int                batch = 0;         /* in batch mode: be quiet */
+
+#define IN_BUFSIZE 65536              /* input buffer, used by read_in() */
+unsigned char      in_buf[IN_BUFSIZE];
+int                in_pos = 0, in_len = 0;
 
 
 /*************************************************/
@@ -188,11 +234,7 @@ int main(argc,argv)
      int  argc;
      char **argv;
 {
-  unsigned char ibuf[2048],obuf[2048];
-  unsigned char blank=32;
-  short         host,length,total_bytes,line,i;
-  int          x,hist[511];
-  int           count, int_length;
+  short         host;
 
   /*********************************************************************/
   /*                                                                   */
@@ -219,8 +261,19 @@ int main(argc,argv)
     fprintf(stderr,"     2  FITS format.              \n");   
     fprintf(stderr,"     3  VICAR format.             \n");   
     fprintf(stderr,"     4  Unlabelled binary array.  \n\n");   
+    fprintf(stderr,"or, to decompress many files at once:\n\n");
+    fprintf(stderr,
+	    "VDCOMP -b [-f format] [-j jobs] [-o outdir] file|dir ...\n");
+    fprintf(stderr,"   -f format     - output format (as above)\n");
+    fprintf(stderr,"   -j jobs       - # of files to decompress at once\n");
+    fprintf(stderr,"   -o outdir     - where to put the output files\n");
+    fprintf(stderr,"   file|dir      - compressed files, or directories\n");
+    fprintf(stderr,"                   of them (named *.IMQ)\n\n");
     exit(1);
   }  
+  else if (strcmp(argv[1],"-b") == 0) {
+    exit(batch_main(argc,argv));
+  }
   else {
     strcpy(inname,argv[1]);  
     if (argc >= 3) strcpy(outname,argv[2]); 
@@ -231,6 +284,25 @@ int main(argc,argv)
   host = check_host();
   host = get_files(host); /* may change host if VAX */
 
+  return decomp(host);
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/* subroutine decomp - decompress the (open) input file              */
+/*                                                                   */
+/*********************************************************************/
+
+int decomp(host)
+     int host;
+{
+  unsigned char ibuf[2048],obuf[2048];
+  unsigned char blank=32;
+  short         length,total_bytes,line,i;
+  int          x,hist[640];    /* up to 3 records of 836 bytes go in here */
+  int           count, int_length;
+
   /*********************************************************************/
   /*                                                                   */
   /* read and edit compressed file labels                              */
@@ -352,7 +424,7 @@ int main(argc,argv)
   /*                                                                   */
   /*********************************************************************/
 
-  if (outfile != stdout)
+  if (outfile != stdout && !batch)
     fprintf(stderr,"\nInitializing decompression routine...");
   decmpinit(hist);
 
@@ -363,7 +435,7 @@ int main(argc,argv)
   /*                                                                   */
   /*********************************************************************/
 
-  if (outfile!=stdout) fprintf(stderr,"\nDecompressing data...");
+  if (outfile!=stdout && !batch) fprintf(stderr,"\nDecompressing data...");
   line=0;
 
   do {
@@ -394,12 +466,12 @@ int main(argc,argv)
     if (record_bytes == 1204) /* do checksum for viking */
       for (i=0; i<record_bytes; i++) checksum += (int)obuf[i];
 
-    if ((line % 100 == 0) && (outfile != stdout)) 
+    if ((line % 100 == 0) && (outfile != stdout) && !batch) 
       fprintf(stderr,"\nline %d",line);
 
   } while (length > 0 && line < max_lines);
 
-  if (record_bytes == 1204  && (outfile  != stdout)) 
+  if (record_bytes == 1204  && (outfile  != stdout) && !batch) 
     /* print checksum for viking */
     fprintf(stderr,"\n Image label checksum = %d computed checksum = %d\n",
 	    label_checksum,checksum);
@@ -408,7 +480,7 @@ int main(argc,argv)
   if (output_format == 2)
     for (i=0;i<fits_pad;i++) fputc(blank,outfile);
 
-  if (outfile!=stdout) printf("\n");
+  if (outfile!=stdout && !batch) printf("\n");
   free_tree(&int_length);
 
   close(infile);
@@ -418,6 +490,177 @@ int main(argc,argv)
 }
 
 
+/*********************************************************************/
+/*                                                                   */
+/* subroutine batch_main - decompress all the files named on the     */
+/*   command line (from argv[2] on), and the .IMQ files in any       */
+/*   directories named there, running up to 'jobs' of them at once.  */
+/*   returns the exit status for the program.                        */
+/*                                                                   */
+/*********************************************************************/
+
+int batch_main(argc,argv)
+     int  argc;
+     char **argv;
+{
+#ifdef VMS
+  fprintf(stderr,"vdcomp: batch mode isn't supported on VMS.\n");
+  return 1;
+#else
+  char   **files, *odir, *dname, *fname;
+  int      nfiles, maxfiles, njobs, nfail, host, i, len;
+  int      running, status, pid;
+  struct stat    st;
+  DIR           *dirp;
+  struct dirent *dp;
+
+  batch = 1;
+  output_format = 1;
+  njobs = 1;
+  odir  = NULL;
+
+  maxfiles = argc;
+  files = (char **) malloc(maxfiles * sizeof(char *));
+  if (files == NULL) {
+    fprintf(stderr,"vdcomp: out of memory\n");
+    return 1;
+  }
+  nfiles = 0;
+
+  for (i=2; i<argc; i++) {
+    if (strcmp(argv[i],"-f") == 0 && i+1 < argc)
+      output_format = atoi(argv[++i]);
+    else if (strcmp(argv[i],"-j") == 0 && i+1 < argc)
+      njobs = atoi(argv[++i]);
+    else if (strcmp(argv[i],"-o") == 0 && i+1 < argc)
+      odir = argv[++i];
+
+    else if (stat(argv[i],&st) == 0 && S_ISDIR(st.st_mode)) {
+      if ((dirp = opendir(argv[i])) == NULL) {
+	fprintf(stderr,"vdcomp: can't read directory %s\n",argv[i]);
+	continue;
+      }
+
+      while ((dp = readdir(dirp)) != NULL) {
+	dname = dp->d_name;
+	len = strlen(dname);
+	if (len < 5 || dname[len-4] != '.' ||
+	    (dname[len-3] != 'i' && dname[len-3] != 'I') ||
+	    (dname[len-2] != 'm' && dname[len-2] != 'M') ||
+	    (dname[len-1] != 'q' && dname[len-1] != 'Q')) continue;
+
+	if (nfiles == maxfiles) {
+	  maxfiles *= 2;
+	  files = (char **) realloc(files, maxfiles * sizeof(char *));
+	}
+	fname = (char *) malloc(strlen(argv[i]) + len + 2);
+	if (files == NULL || fname == NULL) {
+	  fprintf(stderr,"vdcomp: out of memory\n");
+	  return 1;
+	}
+	sprintf(fname,"%s/%s",argv[i],dname);
+	files[nfiles++] = fname;
+      }
+      closedir(dirp);
+    }
+
+    else {
+      if (nfiles == maxfiles) {
+	maxfiles *= 2;
+	files = (char **) realloc(files, maxfiles * sizeof(char *));
+	if (files == NULL) {
+	  fprintf(stderr,"vdcomp: out of memory\n");
+	  return 1;
+	}
+      }
+      files[nfiles++] = argv[i];
+    }
+  }
+
+  if (output_format < 1 || output_format > 4 || nfiles == 0) {
+    fprintf(stderr,
+	"usage: vdcomp -b [-f format] [-j jobs] [-o outdir] file|dir ...\n");
+    return 1;
+  }
+  if (njobs < 1) njobs = 1;
+
+  host = check_host();
+
+  /* keep up to 'njobs' children busy, one file apiece.  Each file gets
+     its own process (even with one job), as the decompression routines
+     keep their state in globals, and exit() when they hit an error */
+
+  fflush(stdout);  fflush(stderr);
+  nfail = 0;
+
+  for (i=0, running=0; i<nfiles || running; ) {
+    if (i<nfiles && running<njobs) {
+      pid = fork();
+      if (pid == 0) exit(batch_file(files[i], odir, host));
+      else if (pid < 0) {
+	fprintf(stderr,"vdcomp: can't fork to decompress %s\n",files[i]);
+	nfail++;
+      }
+      else running++;
+      i++;
+    }
+
+    else {
+      if (wait(&status) < 0) break;
+      running--;
+      if (!WIFEXITED(status) || WEXITSTATUS(status)) nfail++;
+    }
+  }
+
+  if (nfail)
+    fprintf(stderr,"vdcomp: %d of %d file%s not decompressed.\n",
+	    nfail, nfiles, (nfiles==1) ? "" : "s");
+
+  return (nfail) ? 1 : 0;
+#endif /* VMS */
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/* subroutine batch_file - decompress one file, in batch mode.       */
+/*   The output file goes in 'odir' (or next to the input file, if   */
+/*   that's NULL), and is named after the input file, with an        */
+/*   extension for the output format.                                */
+/*                                                                   */
+/*********************************************************************/
+
+int batch_file(name,odir,host)
+     char *name, *odir;
+     int   host;
+{
+  static char *exts[5] = { "", ".img", ".fit", ".vic", ".raw" };
+  char *base, *dot, *slash;
+
+  base = strrchr(name,'/');
+  base = (base) ? base+1 : name;
+
+  if (strlen(name) + ((odir) ? strlen(odir) : 0) + 8 > sizeof(outname)) {
+    fprintf(stderr,"vdcomp: name too long: %s\n",name);
+    return 1;
+  }
+
+  strcpy(inname,name);
+  if (odir) sprintf(outname,"%s/%s",odir,base);
+       else strcpy(outname,name);
+
+  dot   = strrchr(outname,'.');
+  slash = strrchr(outname,'/');
+  if (dot && (!slash || dot > slash) && strcmp(dot,exts[output_format]))
+    strcpy(dot,exts[output_format]);       /* foo.imq -> foo.img */
+  else
+    strcat(outname,exts[output_format]);   /* don't write over the input */
+
+  host = get_files(host);
+  return decomp(host);
+}
+
+
 /*********************************************************************/
 /*                                                                   */
 /* subroutine get_files - get input filenames and open               */
@@ -459,9 +702,9 @@ int host;
        read(infile,&shortint, (size_t) 2);
        if (shortint > 0 && shortint < 80) {
 	 host = 4;              /* change host to 4                */
-	 printf("This is not a VAX variable length file.");
+	 if (!batch) printf("This is not a VAX variable length file.");
        }
-       else printf("This is a VAX variable length file.");
+       else if (!batch) printf("This is a VAX variable length file.");
        lseek(infile,(off_t) 0,0);     /* reposition to beginning of file */
      }
   }
@@ -994,7 +1237,7 @@ int read_var(ibuf,host)
 char  *ibuf;
 int   host;
 {
-  int   length,result,nlen;
+  int   length,result;
   char  temp;
   union /* this union is used to swap 16 and 32 bit integers          */
     {
@@ -1008,8 +1251,8 @@ int   host;
           /* IBM PC host                                         */
           /*******************************************************/
     length = 0;
-    result = read(infile,&length,(size_t) 2);
-    nlen =   read(infile,ibuf,(size_t) (length+(length%2)));
+    result = read_in((char *) &length,2);
+    read_in(ibuf,length+(length%2));
     return (length);
 
   case 2: /*******************************************************/
@@ -1017,13 +1260,13 @@ int   host;
           /*******************************************************/
 
     length = 0;
-    result = read(infile,onion.ichar,(size_t) 2);
+    result = read_in(onion.ichar,2);
     /*     byte swap the length field                            */
     temp   = onion.ichar[0];
     onion.ichar[0]=onion.ichar[1];
     onion.ichar[1]=temp;
     length = onion.slen;       /* left out of earlier versions   */
-    nlen =   read(infile,ibuf,(size_t) length+(length%2));
+    read_in(ibuf,length+(length%2));
     return (length);
 
   case 3: /*******************************************************/
@@ -1036,31 +1279,59 @@ int   host;
           /* VAX host, but not a variable length file            */
           /*******************************************************/
     length = 0;
-    result = read(infile,&length,(size_t) 2);
-    nlen =   read(infile,ibuf,(size_t) length+(length%2));
-
-    /* check to see if we crossed a vax record boundary          */
-    while (nlen < length)
-      nlen += read(infile,ibuf+nlen,(size_t) length+(length%2)-nlen);
+    result = read_in((char *) &length,2);
+    read_in(ibuf,length+(length%2));   /* (crosses vax records) */
     return (length);
 
   case 5: /*******************************************************/
           /* Unix workstation host (non-byte-swapped 32 bit host)*/
           /*******************************************************/
     length = 0;
-    result = read(infile,onion.ichar,(size_t) 2);
+    result = read_in(onion.ichar,2);
     /*     byte swap the length field                            */
     temp   = onion.ichar[0];
     onion.ichar[0]=onion.ichar[1];
     onion.ichar[1]=temp;
     length = onion.slen;
-    nlen =   read(infile,ibuf,(size_t) length+(length%2));
+    read_in(ibuf,length+(length%2));
     return (length);
   }
 
   return 0;
 }
 
+/*********************************************************************/
+/*                                                                   */
+/* subroutine read_in - read 'n' bytes from the input file, through  */
+/*   in_buf.  returns the # of bytes read (less than 'n' at EOF)     */
+/*   (not used for VAX variable length files, where each read()      */
+/*   returns one record)                                             */
+/*                                                                   */
+/*********************************************************************/
+
+int read_in(buf,n)
+     char *buf;
+     int   n;
+{
+  int got, k;
+
+  for (got=0; got < n; got += k) {
+    if (in_pos >= in_len) {
+      in_pos = 0;
+      in_len = read(infile,(char *) in_buf,(size_t) IN_BUFSIZE);
+      if (in_len <= 0) { in_len = 0;  break; }
+    }
+
+    k = in_len - in_pos;
+    if (k > n - got) k = n - got;
+    memcpy(buf + got, (char *) in_buf + in_pos, (size_t) k);
+    in_pos += k;
+  }
+
+  return got;
+}
+
+
 /*********************************************************************/
 /*                                                                   */
 /* subroutine check_host - find out what kind of machine we are on   */
@@ -1115,7 +1386,7 @@ int check_host()
 	   "Host 5 - 32 bit integers without swapping, no var len support.");
   }
 
-  if ((*outname)!='-') fprintf(stderr,"%s\n",hostname);
+  if ((*outname)!='-' && !batch) fprintf(stderr,"%s\n",hostname);
   return(host);
 }
 
@@ -1170,6 +1441,7 @@ void decmpinit(hist)
 {
   extern NODE *tree;          /* Huffman tree root pointer */
   tree = huff_tree(hist);
+  make_lookup(tree);
   return;
 }
 
@@ -1183,7 +1455,7 @@ NODE *huff_tree(hist)
 {
   /*  Local variables used */
   int freq_list[512];      /* Histogram frequency list */
-  NODE **node_list;             /* DN pointer array list */
+  NODE *node_list[512];         /* DN pointer array list */
 
   int   *fp;        /* Frequency list pointer */
   NODE **np;        /* Node list pointer */
@@ -1200,18 +1472,13 @@ NODE *huff_tree(hist)
 
 
   /**************************************************************************
-    Allocate the array of nodes from memory and initialize these with numbers
+    Get the array of nodes from node_pool and initialize these with numbers
     corresponding with the frequency list.  There are only 511 possible
     permutations of first difference histograms.  There are 512 allocated
     here to adhere to the FORTRAN version.
    **************************************************************************/
 
   fp = freq_list;
-  node_list = (NODE **) malloc(sizeof(temp) * 512);
-  if (node_list == NULL) {
-    fprintf(stderr,"\nOut of memory in huff_tree!\n");
-    exit(1);
-  }
   np = node_list;
 
   for (num_nodes=1, cnt=512 ; cnt-- ; num_nodes++) {
@@ -1282,12 +1549,11 @@ NODE *new_node(value)
   NODE *temp;         /* Pointer to the memory block */
 
   /************************************************************************
-    Allocate the memory and intialize the fields.
+    Take the next node from node_pool and intialize the fields.
    ************************************************************************/
 
-  temp = (NODE *) malloc(sizeof(NODE));
-
-  if (temp != NULL) {
+  if (nodes_used < MAX_NODES) {
+    temp = &node_pool[nodes_used++];
     temp->right = NULL;
     temp->dn = (short int) value;
     temp->left = NULL;
@@ -1347,6 +1613,37 @@ void sort_freq(freq_list,node_list,num_freq)
 }
 
 
+void make_lookup(root)
+/****************************************************************************
+*_TITLE make_lookup - builds the lookup table used by dcmprs                 *
+*_ARGS  TYPE       NAME       I/O       DESCRIPTION                         */
+        NODE       *root;   /* I        Huffman coded tree                  */
+
+{
+  NODE *ptr;               /* pointer to position in tree */
+  int   i, len;
+
+  /**************************************************************************
+    For each possible LOOKUP_BITS bits of input, follow them down the tree
+    (a 1 goes left, a 0 right) until they run out, or a leaf is reached.
+   **************************************************************************/
+
+  for (i=0 ; i < LOOKUP_SIZE ; i++) {
+    ptr = root;
+    for (len=0 ; len < LOOKUP_BITS && ptr->dn == -1 ; len++)
+      ptr = (i & (1 << (LOOKUP_BITS-1-len))) ? ptr->left : ptr->right;
+
+    if (ptr->dn != -1 && len > 0) {
+      lookup[i].dn  = ptr->dn;
+      lookup[i].len = len;
+    }
+    else
+      lookup[i].len = 0;
+  }
+  return;
+}
+
+
 void dcmprs(ibuf,obuf,nin,nout,root)
 /****************************************************************************
 *_TITLE dcmprs - decompresses Huffman coded compressed image lines          *
@@ -1359,9 +1656,11 @@ void dcmprs(ibuf,obuf,nin,nout,root)
 
 {
   /* Local Variables */
-  NODE *ptr = root;        /* pointer to position in tree */
-  unsigned char test;      /* test byte for bit set */
-  unsigned char idn;       /* input compressed byte */
+  NODE *ptr;               /* pointer to position in tree */
+  struct lookup *lp;       /* lookup table entry for the next code */
+  unsigned long bits = 0;  /* input bits not decoded yet (the low 'nbits') */
+  int nbits = 0;           /* number of bits in 'bits' */
+  int code;                /* next LOOKUP_BITS bits of input */
   
   char odn;                /* last dn value decompressed */
   
@@ -1379,26 +1678,51 @@ void dcmprs(ibuf,obuf,nin,nout,root)
     exit(1);
   }
 
+  if (root->dn != -1) return;      /* no codes in a one-leaf tree */
+
   /************************************************************************
-    Decompress the input buffer.  Assign the first byte to the working
-    variable, idn.  An arithmatic and (&) is performed using the variable
-    'test' that is bit shifted to the right.  If the result is 0, then
-    go to right else go to left.
+    Decompress the input buffer.  Keep at least 24 bits of input on hand
+    in 'bits' (while there are that many left), and look up the code that
+    the next LOOKUP_BITS of them start with.  Codes that are longer than
+    that (or that run past the end of the input) are decoded by walking
+    the tree, a bit at a time: if the bit is set, go to left else go to
+    right.  Any bits at the end that don't make up a whole code are
+    ignored.
    ************************************************************************/
 
-  for (idn=(*ibuf) ; ibuf < ilim  ; idn =(*++ibuf)) {
-    for (test=0x80 ; test ; test >>= 1) {
-      ptr = (test & idn) ? ptr->left : ptr->right;
+  for (;;) {
+    while (nbits <= 24 && ibuf < ilim) {
+      bits = (bits << 8) | (unsigned char) *ibuf++;
+      nbits += 8;
+    }
+
+    if (nbits >= LOOKUP_BITS) code = (int) (bits >> (nbits - LOOKUP_BITS));
+                         else code = (int) (bits << (LOOKUP_BITS - nbits));
+    lp = &lookup[code & (LOOKUP_SIZE - 1)];
 
-      if (ptr->dn != -1)  {
-	if (obuf >= olim) return;
-	odn -= ptr->dn + 256;
-	*obuf++ = odn;
-	ptr = root;
-      }
+    if (lp->len && lp->len <= nbits) {
+      nbits -= lp->len;
+      if (obuf >= olim) return;
+      odn -= lp->dn + 256;
+      *obuf++ = odn;
+      continue;
     }
+
+    ptr = root;
+    do {
+      if (nbits == 0) {
+	if (ibuf >= ilim) return;
+	bits = (unsigned char) *ibuf++;
+	nbits = 8;
+      }
+      nbits--;
+      ptr = ((bits >> nbits) & 1) ? ptr->left : ptr->right;
+    } while (ptr->dn == -1);
+
+    if (obuf >= olim) return;
+    odn -= ptr->dn + 256;
+    *obuf++ = odn;
   }
-  return;
 }
 
 
@@ -1416,55 +1740,19 @@ void free_tree(nfreed)
 *       purpose of the routine is so if the user wishes to decompress more  *
 *       than one file per run, the program will not keep allocating new     *
 *       memory without first deallocating all previous nodes associated     *
-*       with the previous file decompression.                               *
+*       with the previous file decompression.  As the nodes all come out   *
+*       of node_pool, that just means starting over at the beginning of it. *
 
 *_HIST  16-AUG-89 Kris Becker   USGS, Flagstaff Original Version            *
 *_END                                                                       *
 ****************************************************************************/
 
 {
-  int total_free = 0;
-
   extern NODE *tree;      /* Huffman tree root pointer */
 
-  *nfreed = free_node(tree,total_free);
+  *nfreed = nodes_used;
+  nodes_used = 0;
+  tree = (NODE *) NULL;
 
   return;
 }
-
-
-int free_node(pnode,total_free)
-/***************************************************************************
-*_TITLE free_node - deallocates an allocated NODE pointer
-*_ARGS  TYPE     NAME          I/O   DESCRIPTION                           */
-        NODE     *pnode;       /* I  Pointer to node to free               */
-        int       total_free;   /* I  Total number of freed nodes           */
-
-/*
-*_DESCR  free_node will check both right and left pointers of a node       *
-*        and then free the current node using the free() C utility.        *
-*        Note that all nodes attached to the node via right or left        *
-*        pointers area also freed, so be sure that this is the desired     *
-*        result when calling this routine.                                 *
-
-*        This routine is supplied to allow successive calls to the         *
-*        decmpinit routine.  It will free up the memory allocated          *
-*        by previous calls to the decmpinit routine.  The call to free     *
-*        a previous huffman tree is:  total = free_node(tree,(int) 0);    *
-*        This call must be done by the programmer application routine      *
-*        and is not done by any of these routines.                         *
-*_HIST   16-AUG-89  Kris Becker U.S.G.S  Flagstaff Original Version        */
-{
-  if (pnode == (NODE *) NULL) return(total_free);
-  
-  if (pnode->right != (NODE *) NULL)
-    total_free = free_node(pnode->right,total_free);
-  if (pnode->left != (NODE *) NULL)
-    total_free = free_node(pnode->left,total_free);
-  
-  free((char *) pnode);
-  return(total_free + 1);
-}
-
-
-
@@ -96,6 +96,7 @@ static void printoption              PARM((char *));
 static void cmdSyntax                PARM((void));
 static void rmodeSyntax              PARM((void));
 static int  openPic                  PARM((int));
+static void killPages                PARM((void));
 static int  readpipe                 PARM((char *, char *));
 static void openFirstPic             PARM((void));
 static void openNextPic              PARM((void));
@@ -104,6 +105,14 @@ static void openNextLoop             PARM((void));
 static void openPrevPic              PARM((void));
 static void openNamedPic             PARM((void));
 static int  findRandomPic            PARM((void));
+static int  nextRandomPic            PARM((void));
+static int  prepConvert              PARM((void));
+static int  prepESize                PARM((int, int, int *, int *));
+static int  prepEpicOK               PARM((void));
+static int  usePrep                  PARM((char *, int, PICINFO *));
+static int  usePrepEpic              PARM((void));
+static void freePrep                 PARM((void));
+static int  reloadRows               PARM((void));
 static void mainLoop                 PARM((void));
 static void createMainWindow         PARM((char *, char *));
 static void setWinIconNames          PARM((char *));
@@ -121,13 +130,29 @@ int   imap, ctrlmap, gmap, browmap, cmtmap, clrroot, nopos, limit2x;
 char *display, *whitestr, *blackstr, *histr, *lostr,
      *infogeom, *fgstr, *bgstr, *ctrlgeom, *gamgeom, *browgeom, *tmpstr;
 char *rootfgstr, *rootbgstr, *visualstr, *textgeom, *cmtgeom;
-char *monofontname, *flistName;
-int  curstype, stdinflag, browseMode, savenorm, preview, pscomp, preset, 
-     rmodeset, gamset, cgamset, perfect, owncmap, rwcolor, stdcmap;
+char *monofontname, *flistName, *stretchstr;
+int  curstype, stdinflag, browseMode, savenorm, preview, pscomp, pslevel2,
+     preset, rmodeset, gamset, cgamset, perfect, owncmap, rwcolor, stdcmap;
 int  nodecor;
 double gamval, rgamval, ggamval, bgamval;
 
 
+/* the next image of a '-wait' slideshow, read in ahead of time by
+   PrefetchNextPic(), while the current one is being shown */
+static PICINFO prepInfo;
+static char    prepName[512];       /* file it came from ("" if none) */
+static int     prepType;            /* its RFT_* type */
+static time_t  prepMtime;           /* to see if the file changed since */
+static long    prepSize;
+static int     prepRandom = -2;     /* findRandomPic() result, picked early */
+static float   prepAspect;          /* normaspect, as read from the file */
+static int     prep824;             /* 1: converted 24->8, 2: 8->24, 0: not */
+static int     prepGiven;           /* handed over to openPic() by usePrep() */
+static int     prepConv24, prepNcols;  /* how it was converted */
+static byte   *prepEpic;            /* 24-bit 'epic', already smoothed... */
+static int     prepEW, prepEH;      /* ... to this size */
+
+
 
 
 /*******************************************/
@@ -164,7 +189,7 @@ int main(argc, argv)
   display = NULL;
   fgstr = bgstr = rootfgstr = rootbgstr = NULL;
   histr = lostr = whitestr = blackstr = NULL;
-  visualstr = monofontname = flistName = NULL;
+  visualstr = monofontname = flistName = stretchstr = NULL;
   winTitle = NULL;
 
   pic = egampic = epic = cpic = NULL;
@@ -180,6 +205,7 @@ int main(argc, argv)
   autoclose = autoDelete = 0; 
   cmapInGam = 0;
   grabDelay = 0;
+  grabFrames = 32;  grabInterval = 500;  grabSave = (char *) NULL;
   showzoomcursor = 0;
   perfect = owncmap = stdcmap = rwcolor = 0;
 
@@ -239,6 +265,7 @@ int main(argc, argv)
   DEBUG = 0;  bwidth = 2;
   nolimits = useroot = clrroot = noqcheck = 0;
   waitsec = -1;  waitloop = 0;  automax = 0;
+  pollRows = -1;
   rootMode = 0;  hsvmode = 0;
   rmodeset = gamset = cgamset = 0;
   nopos = limit2x = 0;
@@ -247,7 +274,7 @@ int main(argc, argv)
   curstype = XC_top_left_arrow;
   browseMode = savenorm = nostat = 0;
   preview = 0;
-  pscomp = 0;
+  pscomp = pslevel2 = 0;
   preset = 0;
   viewonly = 0;
 
@@ -301,6 +328,11 @@ int main(argc, argv)
   Init24to8();
 
 
+  /* '-convert' doesn't need (or want) a display.  see xvbatch.c */
+  for (i=1; i<argc; i++)
+    if (!strcmp(argv[i], "-convert")) Quit(BatchConvert(argc, argv));
+
+
   /* handle user-specified resources and cmd-line arguments */
   parseResources(argc,argv);
   parseCmdLine(argc, argv);
@@ -774,6 +806,7 @@ int main(argc, argv)
   XSetTransientForHint(theDisp, psW, dirW);
   encapsCB.val = preview;
   pscompCB.val = pscomp;
+  pslevel2CB.val = pslevel2;
   
   
 #ifdef HAVE_JPEG
@@ -1093,6 +1126,9 @@ static void parseResources(argc, argv)
   if (rd_flag("force24"))        force24     = def_int;
   if (rd_str ("foreground"))     fgstr       = def_str;
   if (rd_str ("geometry"))       maingeom    = def_str;
+  if (rd_int ("grabFrames"))     grabFrames  = def_int;
+  if (rd_int ("grabInterval"))   grabInterval = def_int;
+  if (rd_str ("grabSave"))       grabSave    = def_str;
   if (rd_str ("gsDevice"))       gsDev       = def_str;
   if (rd_str ("gsGeometry"))     gsGeomStr   = def_str;
   if (rd_int ("gsResolution"))   gsRes       = def_int;
@@ -1113,12 +1149,14 @@ static void parseResources(argc, argv)
   if (rd_flag("nopos"))          nopos       = def_int;
   if (rd_flag("noqcheck"))       noqcheck    = def_int;
   if (rd_flag("nostat"))         nostat      = def_int;
+  if (rd_flag("ordered24") && def_int)  conv24 = CONV24_ORDER;
   if (rd_flag("ownCmap"))        owncmap     = def_int;
   if (rd_flag("perfect"))        perfect     = def_int;
   if (rd_flag("popupKludge"))    winCtrPosKludge = def_int;
   if (rd_str ("print"))          strncpy(printCmd, def_str, 
 					 (size_t) PRINTCMDLEN);
   if (rd_flag("pscompress"))     pscomp      = def_int;
+  if (rd_flag("pslevel2"))       pslevel2    = def_int;
   if (rd_flag("pspreview"))      preview     = def_int;
   if (rd_flag("quick24") && def_int)  conv24 = CONV24_FAST;
   if (rd_flag("resetroot"))      resetroot   = def_int;
@@ -1129,6 +1167,7 @@ static void parseResources(argc, argv)
   if (rd_flag("rwColor"))        rwcolor     = def_int;
   if (rd_flag("saveNormal"))     savenorm    = def_int;
   if (rd_str ("searchDirectory"))  strcpy(searchdir, def_str);
+  if (rd_str ("stretch"))        stretchstr  = def_str;
   if (rd_str ("textviewGeometry")) textgeom  = def_str;
   if (rd_flag("useStdCmap"))     stdcmap     = def_int;
   if (rd_str ("visual"))         visualstr   = def_str;
@@ -1297,6 +1336,15 @@ static void parseCmdLine(argc, argv)
     else if (!argcmp(argv[i],"-grabdelay",3,0,&pm))	  /* grabDelay */
       { if (++i<argc) grabDelay = atoi(argv[i]); }
     
+    else if (!argcmp(argv[i],"-grabframes",6,0,&pm))	  /* grabFrames */
+      { if (++i<argc) grabFrames = atoi(argv[i]); }
+    
+    else if (!argcmp(argv[i],"-grabinterval",6,0,&pm))	  /* grabInterval */
+      { if (++i<argc) grabInterval = atoi(argv[i]); }
+    
+    else if (!argcmp(argv[i],"-grabsave",6,0,&pm))	  /* grabSave */
+      { if (++i<argc) grabSave = argv[i]; }
+    
     else if (!argcmp(argv[i],"-gsdev",4,0,&pm))	          /* gsDevice */
       { if (++i<argc) gsDev = argv[i]; }
     
@@ -1369,6 +1417,9 @@ static void parseCmdLine(argc, argv)
     else if (!argcmp(argv[i],"-norm",      5,1,&autonorm));   /* norm */
     else if (!argcmp(argv[i],"-nostat",    4,1,&nostat));     /* nostat */
     else if (!argcmp(argv[i],"-owncmap",   2,1,&owncmap));    /* own cmap */
+
+    else if (!argcmp(argv[i],"-ordered24",3,0,&pm))   /* ordered dither 24->8 */
+      conv24 = CONV24_ORDER;
     else if (!argcmp(argv[i],"-perfect",   3,1,&perfect));    /* -perfect */
     else if (!argcmp(argv[i],"-pkludge",   3,1,&winCtrPosKludge));
     else if (!argcmp(argv[i],"-poll",      3,1,&polling));    /* chk mod? */
@@ -1414,6 +1465,9 @@ static void parseCmdLine(argc, argv)
     else if (!argcmp(argv[i],"-smooth",3,1,&autosmooth));  /* autosmooth */
     else if (!argcmp(argv[i],"-stdcmap",3,1,&stdcmap));    /* use stdcmap */
 
+    else if (!argcmp(argv[i],"-stretch",4,0,&pm))	   /* deep data stretch */
+      { if (++i<argc) stretchstr = argv[i]; }
+
     else if (!argcmp(argv[i],"-tgeometry",2,0,&pm))	   /* textview geom */
       { if (++i<argc) textgeom = argv[i]; }
     
@@ -1495,12 +1549,31 @@ static void verifyArgs()
   } 
 
 
+  if (stretchstr && (stretchMode = StretchParse(stretchstr)) < 0) {
+    fprintf(stderr,"Invalid stretch '%s' ignored.\n", stretchstr);
+    fprintf(stderr,"  (Valid stretches:  linear, clip, log, sqrt, asinh, norm,");
+    fprintf(stderr," histeq)\n");
+    stretchMode = STR_LINEAR;
+  }
+
+
   if (grabDelay < 0 || grabDelay > 15) {
     fprintf(stderr,
         "Invalid '-grabdelay' value ignored.  Valid range is 0-15 seconds.\n");
     grabDelay = 0;
   }
 
+  if (grabFrames < 1) {
+    fprintf(stderr,"Invalid '-grabframes' value ignored.\n");
+    grabFrames = 32;
+  }
+
+  if (grabInterval < 10) {
+    fprintf(stderr,
+	"Invalid '-grabinterval' value ignored.  Must be at least 10 ms.\n");
+    grabInterval = 500;
+  }
+
   if (preset<0 || preset>4) {
     fprintf(stderr,"Invalid default preset value (%d) ignored.\n", preset);
     fprintf(stderr,"  (Valid values:  1, 2, 3, 4)\n");
@@ -1573,6 +1646,7 @@ static void cmdSyntax()
   printoption("[-/+cmap]");
   printoption("[-cmtgeometry geom]");
   printoption("[-/+cmtmap]");
+  printoption("[-convert fmt ...]");
   printoption("[-crop x y w h]");
   printoption("[-cursor char#]");
 
@@ -1593,6 +1667,9 @@ static void cmdSyntax()
   printoption("[-gamma val]");
   printoption("[-geometry geom]");
   printoption("[-grabdelay seconds]");
+  printoption("[-grabframes #]");
+  printoption("[-grabinterval ms]");
+  printoption("[-grabsave fname]");
   printoption("[-gsdev str]");
   printoption("[-gsgeom geom]");
   printoption("[-gsres int]");
@@ -1623,6 +1700,7 @@ static void cmdSyntax()
   printoption("[-/+noresetroot]");
   printoption("[-/+norm]");
   printoption("[-/+nostat]");
+  printoption("[-ordered24]");
   printoption("[-/+owncmap]");
   printoption("[-/+perfect]");
   printoption("[-/+pkludge]");
@@ -1644,6 +1722,7 @@ static void cmdSyntax()
   printoption("[-slow24]");
   printoption("[-/+smooth]");
   printoption("[-/+stdcmap]");
+  printoption("[-stretch type]");
   printoption("[-tgeometry geom]");
   printoption("[-/+vflip]");
   printoption("[-/+viewonly]");
@@ -1724,9 +1803,9 @@ static int openPic(filenum)
    */
 
   PICINFO pinfo;
-  int   i,filetype,freename, frompipe, frompoll, fromint, killpage;
+  int   i,filetype,freename, frompipe, frompoll, fromint, killpage, rows;
   int   oldeWIDE, oldeHIGH, oldpWIDE, oldpHIGH;
-  int   oldCXOFF, oldCYOFF, oldCWIDE, oldCHIGH, wascropped;
+  int   oldCXOFF, oldCYOFF, oldCWIDE, oldCHIGH, wascropped, deepeq;
   char *tmp;
   char *fullname,       /* full name of the original file */
         filename[512],  /* full name of file to load (could be /tmp/xxx)*/
@@ -1747,6 +1826,7 @@ static int openPic(filenum)
   oldeWIDE = eWIDE;  oldeHIGH = eHIGH;
   fullname = NULL;
   killpage = 0;
+  rows = -1;
 
   WaitCursor();
 
@@ -1756,11 +1836,13 @@ static int openPic(filenum)
 
   /* if we're not loading next or prev page in a multi-page doc, kill off
      page files */
-  if (strlen(pageBaseName) && filenum!=OP_PAGEDN && filenum!=OP_PAGEUP) 
+  if ((strlen(pageBaseName) || pageSrc) && 
+      filenum!=OP_PAGEDN && filenum!=OP_PAGEUP) 
     killpage = 1;
 
 
-  if (strlen(pageBaseName) && (filenum==OP_PAGEDN || filenum==OP_PAGEUP)) {
+  if ((strlen(pageBaseName) || pageSrc) && 
+      (filenum==OP_PAGEDN || filenum==OP_PAGEUP)) {
     if      (filenum==OP_PAGEUP && curPage>0)          curPage--;
     else if (filenum==OP_PAGEDN && curPage<numPages-1) curPage++;
     else    {
@@ -1769,6 +1851,20 @@ static int openPic(filenum)
       return 0;
     }
 
+    if (pageSrc) {           /* no page files.  get page from the source */
+      strcpy(filename, fullfname);
+      fullname = filename;
+
+      SetISTR(ISTR_INFO,"Loading...");
+      if (!(pageSrc->load)(pageSrc, curPage, &pinfo)) {
+	SetISTR(ISTR_INFO,"Couldn't load page %d of '%s'.", curPage+1, 
+		basefname);
+	Warning();
+	goto FAILED;
+      }
+      goto GOTIMAGE;
+    }
+
     sprintf(filename, "%s%d", pageBaseName, curPage+1);
     fullname = filename;
     goto HAVE_FILENAME;
@@ -1781,12 +1877,7 @@ static int openPic(filenum)
     curname = -1;         /* ??? */
     LoadDfltPic(&pinfo);
 
-    if (killpage) {      /* kill old page files, if any */
-      KillPageFiles(pageBaseName, numPages);
-      pageBaseName[0] = '\0';
-      numPages = 1;
-      curPage = 0;
-    }
+    if (killpage) killPages();     /* kill old page files, if any */
 
     goto GOTIMAGE;
   }
@@ -1796,12 +1887,7 @@ static int openPic(filenum)
     i = LoadGrab(&pinfo);
     if (!i) goto FAILED;   /* shouldn't happen */
 
-    if (killpage) {      /* kill old page files, if any */
-      KillPageFiles(pageBaseName, numPages);
-      pageBaseName[0] = '\0';
-      numPages = 1;
-      curPage = 0;
-    }
+    if (killpage) killPages();     /* kill old page files, if any */
 
     goto GOTIMAGE;
   }
@@ -1818,12 +1904,7 @@ static int openPic(filenum)
 
     if (!i) goto FAILED;   /* shouldn't happen */
 
-    if (killpage) {      /* kill old page files, if any */
-      KillPageFiles(pageBaseName, numPages);
-      pageBaseName[0] = '\0';
-      numPages = 1;
-      curPage = 0;
-    }
+    if (killpage) killPages();     /* kill old page files, if any */
 
     goto GOTIMAGE;
   }
@@ -2051,17 +2132,19 @@ static int openPic(filenum)
   /****** AT THIS POINT: the filetype is a known, readable format */
 
   /* kill old page files, if any */
-  if (killpage) {
-    KillPageFiles(pageBaseName, numPages);
-    pageBaseName[0] = '\0';
-    numPages = 1;
-    curPage = 0;
-  }
+  if (killpage) killPages();
 
 
   SetISTR(ISTR_INFO,"Loading...");
 
-  i = ReadPicFile(filename, filetype, &pinfo, 0);
+  if (usePrep(filename, filetype, &pinfo)) i = 1;
+  else {
+    i = ReadPicFile(filename, filetype, &pinfo, 0);
+
+    /* can more rows be read in later, as they're written? */
+    if (i && polling && filetype == RFT_PBM && !pinfo.deep && !revvideo &&
+	!autorotate && !autohflip && !autovflip) rows = PBMRows();
+  }
 
   if (filetype == RFT_XBM && (!i || pinfo.w==0 || pinfo.h==0)) {
     /* probably just a '.h' file or something... */
@@ -2099,7 +2182,7 @@ static int openPic(filenum)
      (well, once the pic has been converted if we're locked in a mode) */
 
 
-  state824 = 0;
+  state824 = (prepGiven && prep824 == 1);  /* PrefetchNextPic() did it */
 
   /* if we're locked into a mode, do appropriate conversion */
   if (conv24MB.flags[CONV24_LOCK]) {  /* locked */
@@ -2138,6 +2221,14 @@ static int openPic(filenum)
   }
 
 
+  /* animations are only played as 8-bit images, in a window, as is */
+  if (pinfo.anim && (pinfo.type != PIC8 || useroot ||
+		     autorotate || autohflip || autovflip)) {
+    (pinfo.anim->free)(pinfo.anim);
+    pinfo.anim = (ANIMSRC *) NULL;
+  }
+
+
 
   /* ABSOLUTELY no failures from here on out... */
 
@@ -2147,6 +2238,11 @@ static int openPic(filenum)
     numPages = pinfo.numpages;
     curPage = 0;
   }
+  else if (pinfo.pages) {
+    pageSrc  = pinfo.pages;
+    numPages = pinfo.pages->npages;
+    curPage  = 0;
+  }
 
   ignoreConfigs = 1;
 
@@ -2162,6 +2258,7 @@ static int openPic(filenum)
   /* kill off OLD picture, now that we've succesfully loaded a new one */
   KillOldPics();
   SetInfoMode(INF_STR);
+  pollRows = rows;
 
 
   /* get info out of the PICINFO struct */
@@ -2182,6 +2279,12 @@ static int openPic(filenum)
     bMap[i] = pinfo.b[i];
   }
 
+  StretchInit(pinfo.deep, pinfo.r, pinfo.g, pinfo.b);  /* takes it over */
+
+  /* if there are more than 8 bits, do '-norm' and '-hist' with all of them */
+  deepeq = (autonorm || autohisteq) &&
+           StretchSet((autohisteq) ? STR_HISTEQ : STR_NORM, 0);
+
 
 
   AlgInit();
@@ -2458,14 +2561,17 @@ static int openPic(filenum)
   if (useroot) mainW = vrootW;
   if (eWIDE != cWIDE || eHIGH != cHIGH) epic = (byte *) NULL;
 
-  NewPicGetColors(autonorm, autohisteq); 
+  NewPicGetColors(autonorm && !deepeq, autohisteq && !deepeq); 
 
-  GenerateEpic(eWIDE, eHIGH);     /* want to dither *after* color allocs */
+  if (!usePrepEpic())
+    GenerateEpic(eWIDE, eHIGH);   /* want to dither *after* color allocs */
   CreateXImage();
 
   WaitCursor();
   HandleDispMode();   /* create root pic, or mainW, depending... */
 
+  if (pinfo.anim) AnimInit(pinfo.anim);   /* takes care of freeing it */
+
 
   if (LocalCmap) {
     XSetWindowAttributes xswa;
@@ -2511,6 +2617,10 @@ static int openPic(filenum)
  FAILED:
   SetCursors(-1);
   KillPageFiles(pinfo.pagebname, pinfo.numpages);
+  if (pinfo.anim)  (pinfo.anim->free)(pinfo.anim);
+  if (pinfo.pages) (pinfo.pages->free)(pinfo.pages);
+  DeepFree(pinfo.deep);
+  if (prepGiven) freePrep();
 
   if (fullname && strcmp(fullname,filename)!=0) 
     unlink(filename);   /* kill /tmp file */
@@ -2635,7 +2745,8 @@ int ReadFileType(fname)
 
 #ifdef GS_PATH
   else if (strncmp((char *) magicno, "%!",     (size_t) 2)==0 ||
-	   strncmp((char *) magicno, "\004%!", (size_t) 3)==0)   rv = RFT_PS;
+	   strncmp((char *) magicno, "\004%!", (size_t) 3)==0 ||
+	   strncmp((char *) magicno, "%PDF-",  (size_t) 5)==0)   rv = RFT_PS;
 #endif
 
   return rv;
@@ -2652,16 +2763,21 @@ int ReadPicFile(fname, ftype, pinfo, quick)
   /* if quick is set, we're being called to generate icons, or something
      like that.  We should load the image as quickly as possible.  Currently,
      this only affects the LoadPS routine, which, if quick is set, only
-     generates the page file for the first page of the document */
+     generates the page file for the first page of the document, and
+     LoadGIF, which won't bother to set up animations.  Deep data (see
+     xvstretch.c) isn't kept, either */
 
   int rv = 0;
 
-  /* by default, most formats aren't multi-page */
+  /* by default, most formats aren't multi-page, or animated */
   pinfo->numpages = 1;
   pinfo->pagebname[0] = '\0';
+  pinfo->anim  = (ANIMSRC *) NULL;
+  pinfo->pages = (PAGESRC *) NULL;
+  pinfo->deep  = (DEEPPIC *) NULL;
 
   switch (ftype) {
-  case RFT_GIF:     rv = LoadGIF   (fname, pinfo);         break;
+  case RFT_GIF:     rv = LoadGIF   (fname, pinfo, quick);  break;
   case RFT_PM:      rv = LoadPM    (fname, pinfo);         break;
   case RFT_PBM:     rv = LoadPBM   (fname, pinfo);         break;
   case RFT_XBM:     rv = LoadXBM   (fname, pinfo);         break;
@@ -2697,6 +2813,12 @@ int ReadPicFile(fname, ftype, pinfo, quick)
 #endif
 
   }
+
+  if ((!rv || quick) && pinfo->deep) {
+    DeepFree(pinfo->deep);
+    pinfo->deep = (DEEPPIC *) NULL;
+  }
+
   return rv;
 }
 
@@ -2791,6 +2913,22 @@ int UncompressFile(name, uncompname)
 }
 
 
+/********************************/
+static void killPages()
+{
+  /* forgets about the current multi-page document, deleting its page
+     files (or freeing its page source) */
+
+  KillPageFiles(pageBaseName, numPages);
+  if (pageSrc) (pageSrc->free)(pageSrc);
+
+  pageSrc = (PAGESRC *) NULL;
+  pageBaseName[0] = '\0';
+  numPages = 1;
+  curPage = 0;
+}
+
+
 /********************************/
 void KillPageFiles(bname, numpages)
   char *bname;
@@ -3014,7 +3152,7 @@ static void openNextQuit()
     if (i<numnames) return;    /* success */
   }
   else {
-    for (i=findRandomPic(); i>=0; i=findRandomPic())
+    for (i=nextRandomPic(); i>=0; i=findRandomPic())
       if (openPic(i)) return;
   }
 
@@ -3042,7 +3180,7 @@ static void openNextLoop()
       if (i<numnames) return;
     }
     else {
-      for (i=findRandomPic(); i>=0; i=findRandomPic())
+      for (i=nextRandomPic(); i>=0; i=findRandomPic())
 	if (openPic(i)) return;
     }
 
@@ -3121,6 +3259,371 @@ static int findRandomPic()
   return k;
 }
 
+/****************/
+static int nextRandomPic()
+{
+  /* findRandomPic(), unless PrefetchNextPic() has already picked one */
+
+  int i;
+
+  if (prepRandom == -2) return findRandomPic();
+
+  i = prepRandom;  prepRandom = -2;
+  return (i < numnames) ? i : findRandomPic();
+}
+
+
+/****************/
+void PrefetchNextPic()
+{
+  /* called from EventLoop() when a '-wait' slideshow starts waiting.
+     Reads in the file that openNextQuit() or openNextLoop() is going to
+     want next, does the 8/24-bit conversion that openPic() would do, and,
+     for a 24-bit picture that's going to be smoothed, the smoothing, so
+     that when the time is up, all that's left to do is pick colors and
+     put it on the screen.  Compressed files and stdin are left to
+     openPic(), as they need temp files */
+
+  int    i, ftype, w, h;
+  float  oldaspect;
+  char   name[512];
+  struct stat st;
+
+  freePrep();
+  if (numnames < 1) return;
+
+  if (randomShow) {
+    if (prepRandom == -2) prepRandom = findRandomPic();
+    i = prepRandom;
+  }
+  else {
+    if (curname>=0) i = curname+1;
+    else if (nList.selected >= 0 && nList.selected < numnames) 
+      i = nList.selected;
+    else i = 0;
+
+    if (i>=numnames && waitloop) i = 0;
+  }
+
+  if (i<0 || i>=numnames || strcmp(namelist[i], STDINSTR)==0) return;
+  if (strlen(namelist[i]) + strlen(initdir) + strlen(searchdir) + 2 >
+      sizeof(name)) return;
+
+  /* find it the same way openPic() does.  (lengths checked above) */
+#ifndef VMS
+  if (namelist[i][0] == '/') strcpy(name, namelist[i]);
+  else {
+    strcpy(name, initdir);  strcat(name, "/");  strcat(name, namelist[i]);
+    if (strlen(searchdir) && stat(name, &st) != 0) {
+      strcpy(name, searchdir);  strcat(name, "/");  strcat(name, namelist[i]);
+      if (stat(name, &st) != 0) strcpy(name, namelist[i]);
+    }
+  }
+#else
+  strcpy(name, namelist[i]);
+#endif
+
+  if (stat(name, &st) != 0 || !S_ISREG(st.st_mode)) return;
+
+  ftype = ReadFileType(name);
+  if (ftype <= RFT_UNKNOWN || ftype == RFT_COMPRESS) return;
+
+  /* some loaders set 'normaspect'.  It belongs to the picture being shown
+     until openPic() is called */
+  oldaspect  = normaspect;
+  normaspect = defaspect;
+  i = ReadPicFile(name, ftype, &prepInfo, 0);
+  prepAspect = normaspect;
+  normaspect = oldaspect;
+
+  if (i && prepInfo.pic && prepInfo.w > 0 && prepInfo.h > 0 &&
+      prepConvert()) {
+    strcpy(prepName, name);
+    prepType  = ftype;
+    prepMtime = st.st_mtime;
+    prepSize  = (long) st.st_size;
+
+    if (prepInfo.type == PIC24 && prepEpicOK() && prepAspect == 1.0 &&
+	prepESize(prepInfo.w, prepInfo.h, &w, &h) &&
+	(autosmooth || w != prepInfo.w || h != prepInfo.h)) {
+      prepEpic = Smooth24(prepInfo.pic, 1, prepInfo.w, prepInfo.h, w, h,
+			  NULL, NULL, NULL);
+      prepEW = w;  prepEH = h;
+    }
+  }
+  else freePrep();
+
+  SetCursors(-1);
+}
+
+
+/****************/
+static int prepConvert()
+{
+  /* if we're locked into a mode, converts prepInfo to it, as openPic() 
+     would.  Returns '0' if the conversion failed */
+
+  byte *newpic;
+
+  prep824 = 0;
+  if (!conv24MB.flags[CONV24_LOCK]) return 1;
+
+  if (prepInfo.type==PIC24 && picType==PIC8) {             /* 24 -> 8 bit */
+    newpic = Conv24to8(prepInfo.pic, prepInfo.w, prepInfo.h, ncols,
+		       prepInfo.r, prepInfo.g, prepInfo.b);
+    prepInfo.type = PIC8;
+    prep824 = 1;
+  }
+  else if (prepInfo.type!=PIC24 && picType==PIC24) {       /* 8 -> 24 bit */
+    newpic = Conv8to24(prepInfo.pic, prepInfo.w, prepInfo.h,
+		       prepInfo.r, prepInfo.g, prepInfo.b);
+    prepInfo.type = PIC24;
+    prep824 = 2;
+  }
+  else return 1;
+
+  free(prepInfo.pic);
+  prepInfo.pic = newpic;
+  prepConv24 = conv24;
+  prepNcols  = ncols;
+
+  return (newpic != NULL);
+}
+
+
+/****************/
+static int prepESize(pw, ph, wp, hp)
+     int pw, ph, *wp, *hp;
+{
+  /* works out the size openPic() is going to show a pw*ph picture at, for
+     the usual cases.  Returns '0' if it can't tell */
+
+  int    w, h;
+  float  xr, yr, curaspect, exp;
+  double r, wr, hr;
+
+  if (maingeom || (useroot && (rootMode==RM_TILE || rootMode==RM_IMIRROR)))
+    return 0;
+
+  if (hexpand < 0.0) w = (int) (pw / -hexpand);
+                else w = (int) (pw *  hexpand);
+  if (vexpand < 0.0) h = (int) (ph / -vexpand);
+                else h = (int) (ph *  vexpand);
+
+  if (automax) {
+    w = dispWIDE;  h = dispHIGH;
+
+    if (fixedaspect) {    /* as FixAspect(0, ...) would, with normaspect 1 */
+      xr = ((float) w) / pw;
+      yr = ((float) h) / ph;
+      curaspect = xr / yr;
+
+      if (curaspect < normaspect) {
+	exp = curaspect / normaspect;
+	h = (int) (dispHIGH * exp + .5);
+      }
+      else if (curaspect > normaspect) {
+	exp = normaspect / curaspect;
+	w = (int) (dispWIDE * exp + .5);
+      }
+    }
+  }
+
+  if (w>maxWIDE || h>maxHIGH) {
+    wr = ((double) w) / maxWIDE;
+    hr = ((double) h) / maxHIGH;
+
+    r = (wr>hr) ? wr : hr;
+    w = (int) ((w / r) + 0.5);
+    h = (int) ((h / r) + 0.5);
+  }
+
+  if (w < 1) w = 1;
+  if (h < 1) h = 1;
+
+  *wp = w;  *hp = h;
+  return 1;
+}
+
+
+/****************/
+static int prepEpicOK()
+{
+  /* returns '1' if none of the options that change the picture before 
+     it's expanded are in effect, so 'epic' can be made ahead of time */
+
+  return (!autonorm && !autohisteq && !revvideo && !autoraw && !auto4x3 &&
+	  !autocrop && !acrop && !autorotate && !autohflip && !autovflip);
+}
+
+
+/****************/
+static int usePrep(fname, ftype, pinfo)
+     char    *fname;
+     int      ftype;
+     PICINFO *pinfo;
+{
+  /* if PrefetchNextPic() has already read 'fname', the file hasn't
+     changed since, and neither has the 8/24-bit mode it was converted to,
+     hands it over in 'pinfo', and returns '1'.  Otherwise, throws it out */
+
+  struct stat st;
+
+  if (!prepName[0] || strcmp(fname, prepName)!=0 || ftype != prepType ||
+      stat(fname, &st) != 0 || st.st_mtime != prepMtime || 
+      (long) st.st_size != prepSize) {
+    freePrep();
+    return 0;
+  }
+
+  if (prep824 && (!conv24MB.flags[CONV24_LOCK] || conv24 != prepConv24 ||
+		  ncols != prepNcols ||
+		  picType != ((prep824 == 1) ? PIC8 : PIC24))) {
+    freePrep();
+    return 0;
+  }
+
+  xvbcopy((char *) &prepInfo, (char *) pinfo, sizeof(PICINFO));
+  xvbzero((char *) &prepInfo, sizeof(PICINFO));
+  prepName[0] = '\0';
+  normaspect  = prepAspect;
+  prepGiven   = 1;
+  return 1;
+}
+
+
+/****************/
+static int usePrepEpic()
+{
+  /* called by openPic() in place of GenerateEpic(), once the colors have
+     been picked.  If PrefetchNextPic() smoothed the picture to the size it's
+     being shown at, makes that the 'epic', and returns '1' */
+
+  byte *ep;
+
+  if (!prepGiven) return 0;   /* it's for a picture that's yet to come */
+
+  ep = prepEpic;  prepEpic = (byte *) NULL;
+  prepGiven = prep824 = 0;
+  if (!ep) return 0;
+
+  if (epicMode != EM_SMOOTH || picType != PIC24 || cpic != pic ||
+      cWIDE != pWIDE || cHIGH != pHIGH || eWIDE != prepEW ||
+      eHIGH != prepEH || normaspect != 1.0 || !prepEpicOK()) {
+    free(ep);
+    return 0;
+  }
+
+  FreeEpic();
+  epic = ep;
+
+  SetISTR(ISTR_EXPAND, "%.5g%% x %.5g%%  (%d x %d)",
+	  100.0 * ((float) eWIDE) / cWIDE, 
+	  100.0 * ((float) eHIGH) / cHIGH, eWIDE, eHIGH);
+  return 1;
+}
+
+
+/****************/
+static void freePrep()
+{
+  if (prepInfo.pic)     free(prepInfo.pic);
+  if (prepInfo.comment) free(prepInfo.comment);
+  if (prepInfo.anim)    (prepInfo.anim->free)(prepInfo.anim);
+  if (prepInfo.pages)   (prepInfo.pages->free)(prepInfo.pages);
+  DeepFree(prepInfo.deep);
+  KillPageFiles(prepInfo.pagebname, prepInfo.numpages);
+
+  if (prepEpic) free(prepEpic);
+  prepEpic = (byte *) NULL;
+  prep824  = prepGiven = 0;
+
+  xvbzero((char *) &prepInfo, sizeof(PICINFO));
+  prepName[0] = '\0';
+}
+
+/****************/
+static int reloadRows()
+{
+  /* called when '-poll' has noticed that the file being shown has changed.
+     If it's a raw PGM or PPM that's being written a row at a time, and all
+     that's happened is that more rows have been written, reads just those
+     rows into 'pic', and redraws it, leaving the cropping, expansion, and
+     colors alone.  Returns '0' if the file should be reloaded the usual way */
+
+  int   i, n, y, len, rowlen, inv[256];
+  byte *row, *pp;
+  char *fname;
+
+  if (pollRows < 0 || pollRows >= pHIGH || !pic || 
+      curname < 0 || curname >= numnames) return 0;
+
+  fname  = namelist[curname];
+  rowlen = pWIDE * ((picType == PIC8) ? 1 : 3);
+
+  /* SortColormap() has renumbered the grey levels in a PGM, so new rows
+     need to go through the inverse of its colormap */
+  if (picType == PIC8) {
+    for (i=0; i<256; i++) inv[i] = -1;
+    for (i=numcols-1; i>=0; i--) {
+      if (rorg[i] == gorg[i] && rorg[i] == borg[i]) inv[rorg[i]] = i;
+    }
+  }
+
+  /* make sure that what was read last time hasn't changed (in the file, or
+     in 'pic'), by checking the first row, and the last one that was read */
+  row = (byte *) malloc((size_t) rowlen);
+  if (!row) return 0;
+
+  for (y=0; y<pollRows; y = (y < pollRows-1) ? pollRows-1 : pollRows) {
+    n = LoadPBMRows(fname, row, picType, pWIDE, pHIGH, y, 1);
+    if (n <= pollRows) break;   /* gone, shrunk, or rewritten in place */
+
+    pp = pic + y * rowlen;
+    if (picType == PIC8) {
+      for (i=0; i<rowlen && inv[row[i]] == pp[i]; i++);
+    }
+    else {
+      for (i=0; i<rowlen && row[i] == pp[i]; i++);
+    }
+    if (i<rowlen) break;
+  }
+  free(row);
+  if (y < pollRows) return 0;
+
+
+  /* read in the new rows.  They go into a buffer of their own, and aren't
+     copied into 'pic' until they've all been read and checked, so 'pic'
+     is left alone if this doesn't work out */
+  WaitCursor();
+  row = (byte *) malloc((size_t) (pHIGH - pollRows) * rowlen);
+  if (!row) return 0;
+
+  n = LoadPBMRows(fname, row, picType, pWIDE, pHIGH, pollRows,
+		  pHIGH - pollRows);
+  if (n <= pollRows) { free(row);  return 0; }
+
+  len = (n - pollRows) * rowlen;
+  pp  = pic + pollRows * rowlen;
+
+  if (picType == PIC8) {
+    for (i=0; i<len && inv[row[i]] >= 0; i++);
+    if (i<len) { free(row);  return 0; }   /* a grey that isn't in colormap */
+    for (i=0; i<len; i++) pp[i] = (byte) inv[row[i]];
+  }
+  else xvbcopy((char *) row, (char *) pp, (size_t) len);
+
+  free(row);
+  pollRows = n;
+
+  GenerateCpic();
+  GenerateEpic(eWIDE, eHIGH);
+  DrawEpic();
+  SetCursors(-1);
+  return 1;
+}
+
+
 /****************/
 static void mainLoop()
 {
@@ -3174,6 +3677,8 @@ static void mainLoop()
       if (!pic) openPic(DFLTPIC);
     }
 
+    else if (i==POLLED && reloadRows());   /* just read the new rows */
+
     else if (i>=0 || i==GRABBED || i==POLLED || i==RELOAD ||
 	     i==OP_PAGEUP || i==OP_PAGEDN || i==DFLTPIC || i==PADDED) {
       openPic(i);
@@ -3759,7 +4264,7 @@ void HandleDispMode()
       strcpy(fnam, tmp);
 
       /* if we're viewing a multi-page doc, add page # to title */
-      if (strlen(pageBaseName) && numPages>1) {
+      if ((strlen(pageBaseName) || pageSrc) && numPages>1) {
 	char foo[64];
 	sprintf(foo, "  Page %d of %d", curPage+1, numPages);
 	strcat(fnam, foo);
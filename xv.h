@@ -637,12 +637,25 @@
 #define CONV24_FAST  5
 #define CONV24_SLOW  6
 #define CONV24_BEST  7
-#define CONV24_MAX   8
+#define CONV24_ORDER 8
+#define CONV24_MAX   9
 
 /* values 'picType' can take */
 #define PIC8  CONV24_8BIT
 #define PIC24 CONV24_24BIT
 
+/* intensity stretches, for turning deep (more than 8-bit) data into 'pic' */
+#define STR_LINEAR   0       /* lowest level to highest level */
+#define STR_CLIP     1       /* linear, ignoring the extreme 0.5% at each end */
+#define STR_LOG      2
+#define STR_SQRT     3
+#define STR_ASINH    4
+#define STR_NORM     5       /* linear, from lowest to highest level used */
+#define STR_HISTEQ   6       /* histogram equalization */
+#define STR_MAX      6
+
+#define DEEPLEVELS   65536   /* max # of levels in a DEEPPIC */
+
 /* indicies into algMB */
 #define ALG_NONE      0
 #define ALG_SEP1      1  /* separator */
@@ -860,8 +873,62 @@ typedef struct { Window win;            /* window */
 	       } LIST;
 
 
+/* a sequence of same-sized PIC8 frames (an animation), as returned by a
+   LoadXXX() routine in PICINFO.anim.  Frames are rendered on demand */
+typedef struct animsrc {
+		 int   nframes;              /* # of frames */
+		 int   w, h;                 /* size of every frame */
+		 byte  r[256],g[256],b[256]; /* colormap used by all frames */
+
+		 /* render frame #n into a w*h buffer.  returns '1' if ok */
+		 int  (*render) PARM((struct animsrc *, int, byte *));
+
+		 /* how long to show frame #n, in milliseconds */
+		 int  (*delay)  PARM((struct animsrc *, int));
+
+		 /* free the animation, and everything it uses */
+		 void (*free)   PARM((struct animsrc *));
+
+		 char *data;                 /* private to the LoadXXX() */
+	       } ANIMSRC;
+
+
+/* the pages of a multi-page file (or planes of a data cube), as returned
+   by a LoadXXX() routine in PICINFO.pages, in place of page files.  Pages
+   are loaded from the original file on demand */
+struct picinfo;                              /* (PICINFO, below) */
+
+typedef struct pagesrc {
+		 int   npages;               /* # of pages */
+
+		 /* load page #n (0..npages-1).  returns '1' if ok */
+		 int  (*load)   PARM((struct pagesrc *, int, struct picinfo *));
+
+		 /* free the page source, and everything it uses */
+		 void (*free)   PARM((struct pagesrc *));
+
+		 char *data;                 /* private to the LoadXXX() */
+	       } PAGESRC;
+
+
+/* the original samples of an image that has more than 8 bits of them, as
+   returned by a LoadXXX() routine in PICINFO.deep.  Kept around so that
+   the way they're turned into 'pic' values can be changed without
+   re-reading the file (see xvstretch.c) */
+typedef struct deeppic {
+		 int    w, h;                /* size of image */
+		 int    nchan;               /* 1 (grey) or 3 (RGB) */
+		 int    nlevels;             /* samples go from 0..nlevels-1,
+						where nlevels <= DEEPLEVELS */
+		 unsigned short *data;       /* w*h*nchan samples */
+		 long  *hist;                /* # of samples at each level */
+		 double min, max;            /* data values of the end levels */
+	       } DEEPPIC;
+
+
 /* info structure filled in by the LoadXXX() image reading routines */
-typedef struct { byte *pic;                  /* image data */
+typedef struct picinfo {
+                 byte *pic;                  /* image data */
 		 int   w, h;                 /* pic size */
 		 int   type;                 /* PIC8 or PIC24 */
 
@@ -880,6 +947,10 @@ typedef struct { byte *pic;                  /* image data */
 
 		 int   numpages;             /* # of page files, if >1 */
 		 char  pagebname[64];        /* basename of page files */
+
+		 ANIMSRC *anim;              /* frames, if an animation */
+		 PAGESRC *pages;             /* pages, if not in page files */
+		 DEEPPIC *deep;              /* original samples, if > 8 bits */
 	       } PICINFO;
 
 #define MAX_GHANDS 16   /* maximum # of GRAF handles */
@@ -975,6 +1046,8 @@ WHERE char          *picComments;           /* text comments on current pic */
 
 WHERE int            numPages, curPage;     /* for multi-page files */
 WHERE char           pageBaseName[64];      /* basename for multi-page files */
+WHERE PAGESRC       *pageSrc;               /* or where the pages come from */
+WHERE int            stretchMode;           /* STR_* for deep images */
 
 WHERE byte          *cpic;         /* cropped version of pic */
 WHERE int           cWIDE, cHIGH,  /* size of cropped region */
@@ -1056,11 +1129,16 @@ WHERE int           bwidth,        /* border width of created windows */
                     epicMode,      /* either SMOOTH, DITH, or RAW */
                     autoclose,     /* if true, autoclose when iconifying */
                     polling,       /* if true, reload if file changes */
+                    pollRows,      /* rows of a growing PGM/PPM read so far */
                     viewonly,      /* if true, ignore any user input */
                     noFreeCols,    /* don't free colors when loading new pic */
                     autoquit,      /* quit in '-root' or when click on win */
                     xerrcode,      /* errorcode of last X error */
-                    grabDelay;     /* # of seconds to sleep at start of Grab */
+                    grabDelay,     /* # of seconds to sleep at start of Grab */
+                    grabFrames,    /* # of frames kept by a 'Repeat' Grab */
+                    grabInterval;  /* ms between frames of a 'Repeat' Grab */
+
+WHERE char         *grabSave;      /* where 'Repeat' Grab frames get written */
 
 WHERE int           state824;      /* displays warning when going 8->24 */
 
@@ -1148,7 +1226,7 @@ WHERE int           clearR, clearG, clearB;  /* clear color in 24-bit mode */
 /* stuff used for 'ps' box */
 WHERE Window        psW;
 WHERE int           psUp;       /* is psW mapped, or what? */
-WHERE CBUTT         encapsCB, pscompCB;   
+WHERE CBUTT         encapsCB, pscompCB, pslevel2CB;   
 WHERE char         *gsDev, *gsGeomStr;
 WHERE int           gsRes;
 
@@ -1185,6 +1263,7 @@ int   ReadFileType      PARM((char *));
 int   ReadPicFile       PARM((char *, int, PICINFO *, int));
 int   UncompressFile    PARM((char *, char *));
 void  KillPageFiles     PARM((char *, int));
+void  PrefetchNextPic   PARM((void));
 
 void NewPicGetColors    PARM((int, int));
 void FixAspect          PARM((int, int *, int *));
@@ -1310,6 +1389,8 @@ XImage *Pic8ToXImage        PARM((byte *, u_int, u_int, u_long *,
 				  byte *, byte *, byte *));
 
 XImage *Pic24ToXImage       PARM((byte *, u_int, u_int));
+int  XImageFilled           PARM((void));
+void FillXImage             PARM((int, int, int, int));
 
 void Set824Menus            PARM((int));
 void Change824Mode          PARM((int));
@@ -1321,6 +1402,37 @@ byte *XVGetSubImage         PARM((byte *, int, int,int, int,int,int,int));
 int  DoPad                  PARM((int, char *, int, int, int, int));
 int  LoadPad                PARM((PICINFO *, char *));
 
+/*************************** XVANIM.C ***************************/
+void AnimInit               PARM((ANIMSRC *));
+void AnimKill               PARM((void));
+int  AnimActive             PARM((void));
+int  AnimPlaying            PARM((void));
+int  AnimNumFrames          PARM((void));
+int  AnimCurFrame           PARM((void));
+long AnimIdle               PARM((void));
+void AnimStep               PARM((int));
+void AnimGoto               PARM((int));
+void AnimToggle             PARM((void));
+void AnimFlush              PARM((void));
+void AnimSync               PARM((void));
+
+/*************************** XVSTRETCH.C ***************************/
+DEEPPIC *DeepAlloc          PARM((int, int, int));
+void DeepFree               PARM((DEEPPIC *));
+void DeepStretch            PARM((DEEPPIC *, int, byte *));
+int  StretchParse           PARM((char *));
+char *StretchName           PARM((int));
+void StretchInit            PARM((DEEPPIC *, byte *, byte *, byte *));
+void StretchKill            PARM((void));
+int  StretchActive          PARM((void));
+void StretchStep            PARM((int));
+int  StretchSet             PARM((int, int));
+void StretchRotate          PARM((int));
+void StretchFlip            PARM((int));
+
+/*************************** XVBATCH.C ***************************/
+int  BatchConvert           PARM((int, char **));
+
 /*************************** XVALG.C ***************************/
 void AlgInit                PARM((void));
 void DoAlg                  PARM((int));
@@ -1338,6 +1450,15 @@ byte *DoColorDither         PARM((byte *, byte *, int, int, byte *, byte *,
 byte *Do332ColorDither      PARM((byte *, byte *, int, int, byte *, byte *, 
 				  byte *, byte *, byte *, byte *, int));
 
+byte *Do332OrderDither      PARM((byte *, byte *, int, int, 
+				  byte *, byte *, byte *));
+
+void  Do332OrderRect        PARM((byte *, int, int, int, int, int, 
+				  byte *, int));
+
+byte *OrderDither           PARM((byte *, int, int, int, 
+				  byte *, byte *, byte *, int, int));
+
 /*************************** XV24TO8.C **************************/
 void Init24to8             PARM((void));
 byte *Conv24to8            PARM((byte *, int, int, int, 
@@ -1410,6 +1531,11 @@ void GetSaveSize           PARM((int *, int *));
 
 void InitPoll              PARM((void));
 int  CheckPoll             PARM((int));
+int  PollWatched           PARM((void));
+int  WatchDir              PARM((char *));
+void UnwatchDir            PARM((int));
+int  WatchFd               PARM((void));
+int  CheckWatches          PARM((void));
 void DIRDeletedFile        PARM((char *));
 void DIRCreatedFile        PARM((char *));
 
@@ -1427,6 +1553,7 @@ void SetBrowStr            PARM((char *));
 void RegenBrowseIcons      PARM((void));
 void BRDeletedFile         PARM((char *));
 void BRCreatedFile         PARM((char *));
+void BRDirChanged          PARM((int));
 
 
 /*************************** XVTEXT.C ************************/
@@ -1556,7 +1683,7 @@ double EvalSpline          PARM((int *, int *, double *, int, double));
 
 
 /**************************** XVGIF.C ***************************/
-int LoadGIF                PARM((char *, PICINFO *));
+int LoadGIF                PARM((char *, PICINFO *, int));
 
 /*************************** XVGIFWR.C **************************/
 int WriteGIF               PARM((FILE *, byte *, int, int, int, 
@@ -1569,6 +1696,9 @@ int WritePM                PARM((FILE *, byte *, int, int, int, byte *,
 
 /**************************** XVPBM.C ***************************/
 int LoadPBM                PARM((char *, PICINFO *));
+int LoadPBMStream          PARM((FILE *, char *, PICINFO *));
+int PBMRows                PARM((void));
+int LoadPBMRows            PARM((char *, byte *, int, int, int, int, int));
 int WritePBM               PARM((FILE *, byte *, int, int, int, byte *, 
 				 byte *, byte *, int, int, int, char *));
 
@@ -1657,7 +1787,7 @@ int   PopUp                PARM((char *, char **, int));
 void  ErrPopUp             PARM((char *, char *));
 int   GetStrPopUp          PARM((char *, char **, int, char *, int, 
 				 char *, int));
-int   GrabPopUp            PARM((int *, int *));
+int   GrabPopUp            PARM((int *, int *, int *));
 int   PadPopUp             PARM((int *, char **, int *, int *, int *, int *));
 void  ClosePopUp           PARM((void));
 void  OpenAlert            PARM((char *));
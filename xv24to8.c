@@ -45,6 +45,7 @@
 
 static int    quick_check PARM((byte*, int,int, byte*, byte*,byte*,byte*,int));
 static int    quick_quant PARM((byte*, int,int, byte*, byte*,byte*,byte*,int));
+static int    order_quant PARM((byte*, int,int, byte*, byte*,byte*,byte*,int));
 static int    ppm_quant   PARM((byte *,int,int, byte*, byte*,byte*,byte*,int));
 
 static int    slow_quant  PARM((byte*, int,int, byte*, byte*,byte*,byte*,int));
@@ -90,6 +91,11 @@ byte *Conv24to8(pic24,w,h,nc,rm,gm,bm)
     i = quick_quant(pic24, w, h, pic8, rm, gm, bm, nc);
     break;
     
+  case CONV24_ORDER:
+    SetISTR(ISTR_INFO,"Doing 'ordered' 24-bit to 8-bit conversion.");
+    i = order_quant(pic24, w, h, pic8, rm, gm, bm, nc);
+    break;
+    
   case CONV24_BEST:
     SetISTR(ISTR_INFO,"Doing 'best' 24-bit to 8-bit conversion.");
     i = ppm_quant(pic24, w, h, pic8, rm, gm, bm, nc);
@@ -224,6 +230,16 @@ static int quick_quant(p24,w,h, p8, rmap,gmap,bmap, nc)
 {
   /* called after 'pic8' has been alloced, pWIDE,pHIGH set up, mono/1-bit
      checked already */
+
+  /* Only the *error* is kept for the next line, in one line of shorts.  The
+     error going right is carried along in r/g/bright, and the three bits of
+     error going down (to the lower-left, lower, and lower-right pixels) are
+     summed in registers and stored once, into the slot that's just been
+     used up.  The clamping and the 7/16, 5/16, 3/16, 1/16 splits come out
+     of tables.  The result is exactly the same as doing it the plain way.
+
+     No pixel can be more than 63 away from its palette color, so the
+     pixel+error values stay within -63..318 */
   
 /* up to 256 colors:     3 bits R, 3 bits G, 2 bits B  (RRRGGGBB) */
 #define RMASK      0xe0
@@ -233,13 +249,17 @@ static int quick_quant(p24,w,h, p8, rmap,gmap,bmap, nc)
 #define BMASK      0xc0
 #define BSHIFT        6
 
-  byte *pp;
-  int  r1, g1, b1;
-  int  *thisline, *nextline, *thisptr, *nextptr, *tmpptr;
-  int  i, j, val, pwide3;
-  int  imax, jmax;
+#define QQ_CLIP     384     /* offset of 0 in cliptab */
+#define QQ_ERR      255     /* offset of 0 in the e? tables */
+
+  byte  *pp, *clip, cliptab[1024];
+  short *errline, *ep;
+  short  e7[511], e5[511], e3[511], e1[511];
+  int    r1, g1, b1, rright, gright, bright;
+  int    rdl, gdl, bdl, rdn, gdn, bdn;
+  int    i, j, val, pwide3;
 
-  pp = p8;  pwide3 = w * 3;  imax = h-1;  jmax = w-1;
+  pp = p8;  pwide3 = w * 3;
 
 
   /* load up colormap:
@@ -252,73 +272,61 @@ static int quick_quant(p24,w,h, p8, rmap,gmap,bmap, nc)
     gmap[i] = (((i<<GSHIFT) & GMASK) * 255 + GMASK/2) / GMASK;
     bmap[i] = (((i<<BSHIFT) & BMASK) * 255 + BMASK/2) / BMASK;
   }
+
+  for (i=0; i<1024; i++) {
+    j = i - QQ_CLIP;  RANGE(j,0,255);  cliptab[i] = (byte) j;
+  }
+  clip = cliptab + QQ_CLIP;
+
+  for (i = -255; i<=255; i++) {
+    e7[i+QQ_ERR] = (i*7) / 16;    e5[i+QQ_ERR] = (i*5) / 16;
+    e3[i+QQ_ERR] = (i*3) / 16;    e1[i+QQ_ERR] = i / 16;
+  }
   
 
-  thisline = (int *) malloc(pwide3 * sizeof(int));
-  nextline = (int *) malloc(pwide3 * sizeof(int));
-  if (!thisline || !nextline) {
-    if (thisline) free(thisline);
-    if (nextline) free(nextline);
+  /* one pixel of padding on the left, for the lower-left error of pixel 0 */
+  errline = (short *) malloc((pwide3 + 3) * sizeof(short));
+  if (!errline) {
     fprintf(stderr,"%s: unable to allocate memory in quick_quant()\n", cmd);
     return(1);
   }
-  
-  /* get first line of picture */
-  for (j=pwide3, tmpptr=nextline; j; j--) *tmpptr++ = (int) *p24++;
+  for (j=0; j<pwide3+3; j++) errline[j] = 0;
   
   for (i=0; i<h; i++) {
-    tmpptr = thisline;  thisline = nextline;  nextline = tmpptr;   /* swap */
-    
     if ((i&0x3f) == 0) WaitCursor();
 
-    if (i!=imax)   /* get next line */
-      for (j=pwide3, tmpptr=nextline; j; j--)
-	*tmpptr++ = (int) *p24++;
-    
-    for (j=0, thisptr=thisline, nextptr=nextline; j<w; j++,pp++) {
-      r1 = *thisptr++;  g1 = *thisptr++;  b1 = *thisptr++;
-      RANGE(r1,0,255);  RANGE(g1,0,255);  RANGE(b1,0,255);  
+    rright = gright = bright = 0;    /* error coming from the left */
+    rdl = gdl = bdl = 0;             /* error for below the previous pixel */
+    rdn = gdn = bdn = 0;             /* error for below this pixel */
+
+    for (j=w, ep=errline+3; j; j--, pp++, ep+=3, p24+=3) {
+      r1 = clip[p24[0] + ep[0] + rright];
+      g1 = clip[p24[1] + ep[1] + gright];
+      b1 = clip[p24[2] + ep[2] + bright];
       
       /* choose actual pixel value */
       val = (((r1&RMASK)>>RSHIFT) | ((g1&GMASK)>>GSHIFT) | 
 	     ((b1&BMASK)>>BSHIFT));
       *pp = val;
       
-      /* compute color errors */
-      r1 -= rmap[val];
-      g1 -= gmap[val];
-      b1 -= bmap[val];
+      /* compute color errors (as e? table indices) */
+      r1 += QQ_ERR - rmap[val];
+      g1 += QQ_ERR - gmap[val];
+      b1 += QQ_ERR - bmap[val];
       
-      /* Add fractions of errors to adjacent pixels */
-      if (j!=jmax) {  /* adjust RIGHT pixel */
-	thisptr[0] += (r1*7) / 16;
-	thisptr[1] += (g1*7) / 16;
-	thisptr[2] += (b1*7) / 16;
-      }
-      
-      if (i!=imax) {	/* do BOTTOM pixel */
-	nextptr[0] += (r1*5) / 16;
-	nextptr[1] += (g1*5) / 16;
-	nextptr[2] += (b1*5) / 16;
-
-	if (j>0) {  /* do BOTTOM LEFT pixel */
-	  nextptr[-3] += (r1*3) / 16;
-	  nextptr[-2] += (g1*3) / 16;
-	  nextptr[-1] += (b1*3) / 16;
-	}
+      /* Add fractions of errors to adjacent pixels.  The pixel below-left
+	 is finished now, as this is the last pixel that gives it any */
+      rright = e7[r1];  gright = e7[g1];  bright = e7[b1];
 
-	if (j!=jmax) {  /* do BOTTOM RIGHT pixel */
-	  nextptr[3] += (r1)/16;
-	  nextptr[4] += (g1)/16;
-	  nextptr[5] += (b1)/16;
-	}
-	nextptr += 3;
-      }
+      ep[-3] = rdl + e3[r1];  ep[-2] = gdl + e3[g1];  ep[-1] = bdl + e3[b1];
+      rdl = rdn + e5[r1];     gdl = gdn + e5[g1];     bdl = bdn + e5[b1];
+      rdn = e1[r1];           gdn = e1[g1];           bdn = e1[b1];
     }
+
+    ep[-3] = rdl;  ep[-2] = gdl;  ep[-1] = bdl;
   }
   
-  free(thisline);
-  free(nextline);
+  free(errline);
   return 0;
 
 
@@ -328,6 +336,39 @@ static int quick_quant(p24,w,h, p8, rmap,gmap,bmap, nc)
 #undef GSHIFT
 #undef BMASK
 #undef BSHIFT
+#undef QQ_CLIP
+#undef QQ_ERR
+}
+
+
+
+/************************************/
+static int order_quant(p24,w,h, p8, rmap,gmap,bmap, nc)
+     byte *p24, *p8, *rmap, *gmap, *bmap;
+     int   w,h,nc;
+{
+  /* same 3-3-2 colormap as quick_quant(), but an ordered dither, so each
+     pixel is done on its own (see Do332OrderDither()) */
+
+  byte *pic;
+  int   i;
+
+  for (i=0; i<256; i++) {
+    rmap[i] = ((i & 0xe0) * 255 + 0xe0/2) / 0xe0;
+    gmap[i] = (((i<<3) & 0xe0) * 255 + 0xe0/2) / 0xe0;
+    bmap[i] = (((i<<6) & 0xc0) * 255 + 0xc0/2) / 0xc0;
+  }
+
+  pic = Do332OrderDither(p24, (byte *) NULL, w, h, 
+			 (byte *) NULL, (byte *) NULL, (byte *) NULL);
+  if (!pic) {
+    fprintf(stderr,"%s: unable to allocate memory in order_quant()\n", cmd);
+    return(1);
+  }
+
+  xvbcopy((char *) pic, (char *) p8, (size_t) (w * h));
+  free(pic);
+  return 0;
 }
       
 
@@ -397,13 +438,6 @@ struct chist_item { pixel color;
 			int value;
 		      };
 
-typedef struct chist_list_item* chist_list;
-struct chist_list_item { struct chist_item ch;
-			     chist_list next;
-			   };
-
-typedef chist_list* chash_table;
-
 typedef struct box* box_vector;
 struct box {
   int index;
@@ -420,28 +454,37 @@ struct box {
 
 #define FS_SCALE 1024
 
-#define HASH_SIZE 6553
 
-#define ppm_hashpixel(p) ((((int) PPM_GETR(p) * 33023 +    \
-			    (int) PPM_GETG(p) * 30013 +    \
-			    (int) PPM_GETB(p) * 27011) & 0x7fffffff)   \
-			  % HASH_SIZE)
+/* The histogram is kept 'densely':  there's one bit for every possible
+ * color (at the current maxval) in 'cbits', which says whether the color
+ * is in the image, and 'crank' holds the number of colors in use before
+ * each word of cbits.  The colors that are in use are numbered in order,
+ * and PPM_RANK() turns a color into its number (its index in the chist_vec)
+ * without any searching.  At maxval 255, that's 16M bits (2MB).
+ */
+
+#define PPM_KEY(r,g,b,s)  ((((long) (r)) << (2*(s))) | ((long) (g) << (s)) | (b))
+
+#define PPM_BITCOUNT(w) (cbitcnt[(w) & 0xff] + cbitcnt[((w)>>8) & 0xff] + \
+			 cbitcnt[((w)>>16) & 0xff] + cbitcnt[((w)>>24) & 0xff])
+
+#define PPM_RANK(key) \
+  (crank[(key)>>5] + PPM_BITCOUNT(cbits[(key)>>5] & \
+				  ((((CARD32) 1) << ((key)&31)) - 1)))
 
+static CARD32 *cbits;              /* one bit per possible color */
+static int    *crank;              /* # of colors before each word of cbits */
+static byte    cbitcnt[256];       /* # of bits set in each byte value */
 
 
 /*** function defs ***/
 
 static chist_vec   mediancut        PARM((chist_vec, int, int, int, int));
-static int         redcompare       PARM((const void *, const void *));
-static int         greencompare     PARM((const void *, const void *));
-static int         bluecompare      PARM((const void *, const void *));
+static void        sortbox          PARM((chist_vec, chist_vec, int, int, int));
 static int         sumcompare       PARM((const void *, const void *));
-static chist_vec   ppm_computechist PARM((pixel **, int,int,int,int *));
-static chash_table ppm_computechash PARM((pixel **, int,int,int,int *));
-static chist_vec   ppm_chashtochist PARM((chash_table, int));
-static chash_table ppm_allocchash   PARM((void));
+static chist_vec   ppm_computechist PARM((byte *, int, byte *, int, int,
+					  int *));
 static void        ppm_freechist    PARM((chist_vec));
-static void        ppm_freechash    PARM((chash_table));
 
 
 /****************************************************************************/
@@ -449,59 +492,35 @@ static int ppm_quant(pic24, cols, rows, pic8, rmap, gmap, bmap, newcolors)
      byte *pic24, *pic8, *rmap, *gmap, *bmap;
      int  cols, rows, newcolors;
 {
-  pixel**          pixels;
-  register pixel*  pP;
-  int              row;
-  register int     col, limitcol;
-  pixval           maxval, newmaxval;
-  int              colors;
-  register int     index;
-  chist_vec chv, colormap;
-  chash_table  cht;
+  byte             lut[256], *pp, *picptr;
+  int              row, col, maxval, newmaxval, shift;
+  int              colors, nwords, *cmapidx;
+  long             key;
+  chist_vec        chv, colormap;
   int              i;
-  unsigned char    *picptr;
   static char      *fn = "ppmquant()";
 
-  index = 0;
   maxval = 255;
-
-  /*
-   *  reformat 24-bit pic24 image (3 bytes per pixel) into 2-dimensional
-   *  array of pixel structures
-   */
-
-  if (DEBUG) fprintf(stderr,"%s: remapping to ppm-style internal fmt\n", fn);
-  WaitCursor();
-  
-  pixels = (pixel **) malloc(rows * sizeof(pixel *));
-  if (!pixels) FatalError("couldn't allocate 'pixels' array");
-  for (row=0; row<rows; row++) {
-    pixels[row] = (pixel *) malloc(cols * sizeof(pixel));
-    if (!pixels[row]) FatalError("couldn't allocate a row of pixels array");
-
-    for (col=0, pP=pixels[row]; col<cols; col++, pP++) {
-      pP->r = *pic24++;
-      pP->g = *pic24++;
-      pP->b = *pic24++;
-    }
+  for (i=0; i<256; i++) {
+    cbitcnt[i] = (i&1) + ((i>>1)&1) + ((i>>2)&1) + ((i>>3)&1) + 
+                 ((i>>4)&1) + ((i>>5)&1) + ((i>>6)&1) + ((i>>7)&1);
+    lut[i] = i;
   }
-  if (DEBUG) fprintf(stderr,"%s: done format remapping\n", fn);
-
-
-    
 
   /*
    *  attempt to make a histogram of the colors, unclustered.
    *  If at first we don't succeed, lower maxval to increase color
    *  coherence and try again.  This will eventually terminate, with
    *  maxval at worst 15, since 32^3 is approximately MAXCOLORS.
+   *  The pixels aren't touched:  'lut' maps a component to its value at
+   *  the current maxval.
    */
 
   WaitCursor();
-  for ( ; ; ) {
+  for (shift = 8 ; ; shift--) {
     if (DEBUG) fprintf(stderr, "%s:  making histogram\n", fn);
 
-    chv = ppm_computechist(pixels, cols, rows, MAXCOLORS, &colors);
+    chv = ppm_computechist(pic24, cols*rows, lut, shift, MAXCOLORS, &colors);
     if (chv != (chist_vec) 0) break;
     
     if (DEBUG) fprintf(stderr, "%s: too many colors!\n", fn);
@@ -509,9 +528,7 @@ static int ppm_quant(pic24, cols, rows, pic8, rmap, gmap, bmap, newcolors)
     if (DEBUG) fprintf(stderr, "%s: rescaling colors (maxval=%d) %s\n",
 		       fn, newmaxval, "to improve clustering");
 
-    for (row=0; row<rows; ++row)
-      for (col=0, pP=pixels[row]; col<cols; ++col, ++pP)
-	PPM_DEPTH( *pP, *pP, maxval, newmaxval );
+    for (i=0; i<256; i++) lut[i] = ((int) lut[i]) * newmaxval / maxval;
     maxval = newmaxval;
   }
 
@@ -526,72 +543,61 @@ static int ppm_quant(pic24, cols, rows, pic8, rmap, gmap, bmap, newcolors)
   WaitCursor();
   if (DEBUG) fprintf(stderr, "%s: choosing %d colors\n", fn, newcolors);
   colormap = mediancut(chv, colors, rows * cols, maxval, newcolors);
-  ppm_freechist(chv);
 
 
 
   /*
    *  Step 4: map the colors in the image to their closest match in the
-   *  new colormap, and write 'em out.
+   *  new colormap, and write 'em out.  Each color in the histogram is
+   *  matched once (they're numbered in the order of the bits in cbits;
+   *  mediancut() has shuffled chv), and the pixels are mapped through
+   *  that, by PPM_RANK.
    */
 
   if (DEBUG) fprintf(stderr,"%s: mapping image to new colors\n", fn);
-  cht = ppm_allocchash();
-
-  picptr = pic8;
-  for (row = 0;  row < rows;  ++row) {
-    col = 0;  limitcol = cols;  pP = pixels[row];
-
-    ProgressMeter(0, rows-1, row, "24 -> 8");
-
-    if ((row & 0x1f) == 0) WaitCursor();
-    do {
-      int hash;
-      chist_list chl;
-
-      /* Check hash table to see if we have already matched this color. */
+  ppm_freechist(chv);
 
-      hash = ppm_hashpixel(*pP);
-      for (chl = cht[hash];  chl;  chl = chl->next)
-	if (PPM_EQUAL(chl->ch.color, *pP)) {index = chl->ch.value; break;}
+  cmapidx = (int *) malloc(colors * sizeof(int));
+  if (!cmapidx) FatalError("ran out of memory mapping colors");
 
-      if (!chl /*index = -1*/) {/* No; search colormap for closest match. */
-	register int i, r1, g1, b1, r2, g2, b2;
-	register long dist, newdist;
+  nwords = ((1L << (3*shift)) + 31) / 32;
+  for (key=0, col=0; key < nwords*32L; key++) {
+    register int i, index, r1, g1, b1, r2, g2, b2;
+    register long dist, newdist;
 
-	r1 = PPM_GETR( *pP );
-	g1 = PPM_GETG( *pP );
-	b1 = PPM_GETB( *pP );
-	dist = 2000000000;
+    if (!cbits[key>>5]) { key += 31;  continue; }    /* skip empty words */
+    if (!(cbits[key>>5] & (((CARD32) 1) << (key&31)))) continue;
+    if ((col & 0xfff) == 0) WaitCursor();
 
-	for (i=0; i<newcolors; i++) {
-	  r2 = PPM_GETR( colormap[i].color );
-	  g2 = PPM_GETG( colormap[i].color );
-	  b2 = PPM_GETB( colormap[i].color );
+    r1 = key >> (2*shift);
+    g1 = (key >> shift) & ((1<<shift)-1);
+    b1 = key & ((1<<shift)-1);
+    dist = 2000000000;  index = 0;
 
-	  newdist = ( r1 - r2 ) * ( r1 - r2 ) +
-	            ( g1 - g2 ) * ( g1 - g2 ) +
-	            ( b1 - b2 ) * ( b1 - b2 );
+    for (i=0; i<newcolors; i++) {
+      r2 = PPM_GETR( colormap[i].color );
+      g2 = PPM_GETG( colormap[i].color );
+      b2 = PPM_GETB( colormap[i].color );
 
-	  if (newdist<dist) { index = i;  dist = newdist; }
-	}
+      newdist = ( r1 - r2 ) * ( r1 - r2 ) +
+	        ( g1 - g2 ) * ( g1 - g2 ) +
+	        ( b1 - b2 ) * ( b1 - b2 );
 
-	hash = ppm_hashpixel(*pP);
-	chl = (chist_list) malloc(sizeof(struct chist_list_item));
-	if (!chl) FatalError("ran out of memory adding to hash table");
+      if (newdist<dist) { index = i;  dist = newdist; }
+    }
 
-	chl->ch.color = *pP;
-	chl->ch.value = index;
-	chl->next = cht[hash];
-	cht[hash] = chl;
-      }
+    cmapidx[col++] = index;
+  }
 
-      *picptr++ = index;
+  picptr = pic8;  pp = pic24;
+  for (row = 0;  row < rows;  ++row) {
+    ProgressMeter(0, rows-1, row, "24 -> 8");
+    if ((row & 0x1f) == 0) WaitCursor();
 
-      ++col;
-      ++pP;
+    for (col=0; col<cols; col++, pp+=3) {
+      key = PPM_KEY(lut[pp[0]], lut[pp[1]], lut[pp[2]], shift);
+      *picptr++ = cmapidx[PPM_RANK(key)];
     }
-    while (col != limitcol);
   }
 
   /* rescale the colormap and load the XV colormap */
@@ -602,13 +608,10 @@ static int ppm_quant(pic24, cols, rows, pic8, rmap, gmap, bmap, newcolors)
     bmap[i] = PPM_GETB( colormap[i].color );
   }
 
-  /* free the pixels array */
-  for (i=0; i<rows; i++) free(pixels[i]);
-  free(pixels);
-
-  /* free cht and colormap */
+  /* free cmapidx, the histogram bits, and colormap */
+  free(cmapidx);
+  free(cbits);  free(crank);
   ppm_freechist(colormap);
-  ppm_freechash(cht);
 
   return 0;
 }
@@ -629,7 +632,7 @@ static chist_vec mediancut( chv, colors, sum, maxval, newcolors )
      int colors, sum, newcolors;
      int maxval;
 {
-  chist_vec colormap;
+  chist_vec colormap, tmp;
   box_vector bv;
   register int bi, i;
   int boxes;
@@ -637,8 +640,9 @@ static chist_vec mediancut( chv, colors, sum, maxval, newcolors )
   bv = (box_vector) malloc(sizeof(struct box) * newcolors);
   colormap = (chist_vec) 
              malloc(sizeof(struct chist_item) * newcolors );
+  tmp = (chist_vec) malloc(sizeof(struct chist_item) * colors);
 
-  if (!bv || !colormap) FatalError("unable to malloc in mediancut()");
+  if (!bv || !colormap || !tmp) FatalError("unable to malloc in mediancut()");
 
   for (i=0; i<newcolors; i++)
     PPM_ASSIGN(colormap[i].color, 0, 0, 0);
@@ -717,15 +721,9 @@ static chist_vec mediancut( chv, colors, sum, maxval, newcolors )
       PPM_ASSIGN(p, 0, 0, maxb - minb);
       bl = PPM_LUMIN(p);
 
-      if (rl >= gl && rl >= bl)
-	qsort((char*) &(chv[indx]), (size_t) clrs, sizeof(struct chist_item),
-	      redcompare );
-      else if (gl >= bl)
-	qsort((char*) &(chv[indx]), (size_t) clrs, sizeof(struct chist_item),
-	      greencompare );
-      else 
-	qsort((char*) &(chv[indx]), (size_t) clrs, sizeof(struct chist_item),
-	      bluecompare );
+      if (rl >= gl && rl >= bl) sortbox(&(chv[indx]), tmp, clrs, 0, maxval);
+      else if (gl >= bl)        sortbox(&(chv[indx]), tmp, clrs, 1, maxval);
+      else                      sortbox(&(chv[indx]), tmp, clrs, 2, maxval);
     }
 
     /*
@@ -783,145 +781,112 @@ static chist_vec mediancut( chv, colors, sum, maxval, newcolors )
   }
 
   free(bv);
+  free(tmp);
   return colormap;
 }
 
 
 /**********************************/
-static int redcompare(p1, p2)
-     const void *p1, *p2;
+static void sortbox(chv, tmp, clrs, comp, maxval)
+     chist_vec chv, tmp;
+     int       clrs, comp, maxval;
 {
-  return (int) PPM_GETR( ((chist_vec)p1)->color ) - 
-         (int) PPM_GETR( ((chist_vec)p2)->color );
-}
+  /* sorts the 'clrs' colors in chv by their red (comp=0), green (1), or
+     blue (2) component, using a counting sort (the components only go from
+     0 to maxval), instead of qsort() */
 
-/**********************************/
-static int greencompare(p1, p2)
-     const void *p1, *p2;
-{
-  return (int) PPM_GETG( ((chist_vec)p1)->color ) - 
-         (int) PPM_GETG( ((chist_vec)p2)->color );
-}
-
-/**********************************/
-static int bluecompare(p1, p2)
-     const void *p1, *p2;
-{
-  return (int) PPM_GETB( ((chist_vec)p1)->color ) - 
-         (int) PPM_GETB( ((chist_vec)p2)->color );
-}
-
-/**********************************/
-static int sumcompare(p1, p2)
-     const void *p1, *p2;
-{
-  return ((box_vector) p2)->sum - ((box_vector) p1)->sum;
-}
+  int count[PPM_MAXMAXVAL+2], i, v;
 
+  for (i=0; i<=maxval+1; i++) count[i] = 0;
 
+  for (i=0; i<clrs; i++) {
+    v = (comp==0) ? PPM_GETR(chv[i].color) :
+        (comp==1) ? PPM_GETG(chv[i].color) : PPM_GETB(chv[i].color);
+    count[v+1]++;
+  }
 
-/****************************************************************************/
-static chist_vec 
-  ppm_computechist(pixels, cols, rows, maxcolors, colorsP)
-     pixel** pixels;
-     int cols, rows, maxcolors;
-     int* colorsP;
-{
-  chash_table cht;
-  chist_vec chv;
+  for (i=1; i<=maxval; i++) count[i] += count[i-1];
 
-  cht = ppm_computechash(pixels, cols, rows, maxcolors, colorsP);
-  if (!cht) return (chist_vec) 0;
+  for (i=0; i<clrs; i++) {
+    v = (comp==0) ? PPM_GETR(chv[i].color) :
+        (comp==1) ? PPM_GETG(chv[i].color) : PPM_GETB(chv[i].color);
+    tmp[count[v]++] = chv[i];
+  }
 
-  chv = ppm_chashtochist(cht, maxcolors);
-  ppm_freechash(cht);
-  return chv;
+  xvbcopy((char *) tmp, (char *) chv, clrs * sizeof(struct chist_item));
 }
 
 
-/****************************************************************************/
-static chash_table ppm_computechash(pixels, cols, rows, 
-					    maxcolors, colorsP )
-     pixel** pixels;
-     int cols, rows, maxcolors;
-     int* colorsP;
+/**********************************/
+static int sumcompare(p1, p2)
+     const void *p1, *p2;
 {
-  chash_table cht;
-  register pixel* pP;
-  chist_list chl;
-  int col, row, hash;
-
-  cht = ppm_allocchash( );
-  *colorsP = 0;
-
-  /* Go through the entire image, building a hash table of colors. */
-  for (row=0; row<rows; row++)
-    for (col=0, pP=pixels[row];  col<cols;  col++, pP++) {
-      hash = ppm_hashpixel(*pP);
-
-      for (chl = cht[hash]; chl != (chist_list) 0; chl = chl->next)
-	if (PPM_EQUAL(chl->ch.color, *pP)) break;
-      
-      if (chl != (chist_list) 0) ++(chl->ch.value);
-      else {
-	if ((*colorsP)++ > maxcolors) {
-	  ppm_freechash(cht);
-	  return (chash_table) 0;
-	}
-	
-	chl = (chist_list) malloc(sizeof(struct chist_list_item));
-	if (!chl) FatalError("ran out of memory computing hash table");
-
-	chl->ch.color = *pP;
-	chl->ch.value = 1;
-	chl->next = cht[hash];
-	cht[hash] = chl;
-      }
-    }
-  
-  return cht;
+  return ((box_vector) p2)->sum - ((box_vector) p1)->sum;
 }
 
 
-/****************************************************************************/
-static chash_table ppm_allocchash()
-{
-  chash_table cht;
-  int i;
-
-  cht = (chash_table) malloc( HASH_SIZE * sizeof(chist_list) );
-  if (!cht) FatalError("ran out of memory allocating hash table");
-
-  for (i=0; i<HASH_SIZE; i++ )
-    cht[i] = (chist_list) 0;
-
-  return cht;
-}
-
 
 /****************************************************************************/
-static chist_vec ppm_chashtochist( cht, maxcolors )
-     chash_table cht;
-     int maxcolors;
+static chist_vec ppm_computechist(pic24, npixels, lut, shift, maxcolors, 
+				  colorsP)
+     byte *pic24, *lut;
+     int   npixels, shift, maxcolors;
+     int  *colorsP;
 {
+  /* builds the histogram of the colors in pic24 (mapped through 'lut',
+     which leaves 'shift' bits per component).  Returns NULL if there are
+     more than 'maxcolors' of them.  Otherwise, leaves cbits and crank set
+     up for PPM_RANK(), and returns the colors, in order of their keys */
+
   chist_vec chv;
-  chist_list chl;
-  int i, j;
+  byte     *pp;
+  CARD32    w;
+  long      key, nkeys;
+  int       i, j, nwords, colors;
+
+  nkeys  = 1L << (3*shift);
+  nwords = (nkeys + 31) / 32;
+
+  cbits = (CARD32 *) calloc((size_t) nwords, sizeof(CARD32));
+  crank = (int *)    malloc((size_t) nwords * sizeof(int));
+  if (!cbits || !crank) FatalError("ran out of memory computing histogram");
+
+  /* Go through the entire image, marking the colors that are used. */
+  for (i=npixels, pp=pic24; i>0; i--, pp+=3) {
+    key = PPM_KEY(lut[pp[0]], lut[pp[1]], lut[pp[2]], shift);
+    cbits[key>>5] |= ((CARD32) 1) << (key&31);
+  }
+
+  for (i=0, colors=0; i<nwords; i++) {
+    crank[i] = colors;
+    colors += PPM_BITCOUNT(cbits[i]);
+  }
 
-  /* Now collate the hash table into a simple chist array. */
-  chv = (chist_vec) malloc( maxcolors * sizeof(struct chist_item) );
+  *colorsP = colors;
+  if (colors > maxcolors) {
+    free(cbits);  free(crank);
+    return (chist_vec) 0;
+  }
 
-  /* (Leave room for expansion by caller.) */
+  chv = (chist_vec) malloc( colors * sizeof(struct chist_item) );
   if (!chv) FatalError("ran out of memory generating histogram");
 
-  /* Loop through the hash table. */
-  j = 0;
-  for (i=0; i<HASH_SIZE; i++)
-    for (chl = cht[i];  chl != (chist_list) 0;  chl = chl->next) {
-      /* Add the new entry. */
-      chv[j] = chl->ch;
-      ++j;
+  /* the colors are numbered in order of their keys */
+  for (i=0, colors=0; i<nwords; i++) {
+    for (j=0, w=cbits[i]; w; j++, w>>=1) {
+      if (!(w&1)) continue;
+      key = ((long) i << 5) + j;
+      PPM_ASSIGN(chv[colors].color, key >> (2*shift),
+		 (key >> shift) & ((1<<shift)-1), key & ((1<<shift)-1));
+      chv[colors].value = 0;
+      colors++;
     }
+  }
+
+  for (i=npixels, pp=pic24; i>0; i--, pp+=3) {
+    key = PPM_KEY(lut[pp[0]], lut[pp[1]], lut[pp[2]], shift);
+    chv[PPM_RANK(key)].value++;
+  }
 
   return chv;
 }
@@ -935,23 +900,6 @@ static void ppm_freechist( chv )
 }
 
 
-/****************************************************************************/
-static void ppm_freechash( cht )
-     chash_table cht;
-{
-  int i;
-  chist_list chl, chlnext;
-
-  for (i=0; i<HASH_SIZE; i++)
-    for (chl = cht[i];  chl != (chist_list) 0; chl = chlnext) {
-      chlnext = chl->next;
-      free( (char*) chl );
-    }
-
-  free( (char*) cht );
-}
-
-
 
 
 
@@ -1639,6 +1639,8 @@ static void saveOrigPic()
 
   int i;
 
+  AnimKill();   /* algorithms work on a still picture */
+  StretchKill();   /* ... which can't be re-stretched once they're done */
   FreeEpic();
   if (cpic && cpic != pic) free(cpic);
   xvDestroyImage(theImage);
@@ -0,0 +1,370 @@
+/*
+ * xvanim.c - plays animations (see ANIMSRC in xv.h) in mainW
+ *
+ *  Contains:
+ *     void AnimInit(as)      - starts playing 'as', whose frame #0 is in pic
+ *     void AnimKill()        - stops playing, and frees the animation
+ *     int  AnimActive()      - is there an animation?
+ *     int  AnimPlaying()     - is it running, and wanting AnimIdle() calls?
+ *     int  AnimNumFrames()   - # of frames in the animation
+ *     int  AnimCurFrame()    - # of frame being shown (0..n-1)
+ *     long AnimIdle()        - shows the next frame, if it's due
+ *     void AnimStep(dir)     - shows next (dir>0) or previous frame
+ *     void AnimGoto(n)       - shows frame #n
+ *     void AnimToggle()      - pauses or resumes playing
+ *     void AnimFlush()       - throws away cached frames
+ *     void AnimSync()        - makes pic/cpic/epic match what's shown
+ *
+ *  Frames are rendered into 'pic', and run through the usual cpic/epic/
+ *  theImage machinery.  The XImage data for each frame is kept in a ring
+ *  of ANIM_SLOTS buffers (no more than ANIM_CACHE bytes, in total), so
+ *  after the first time through, frames that fit in the ring are just
+ *  copied into theImage and drawn.  The ring is flushed whenever anything
+ *  else builds a new theImage (different size, colors, dithering, etc.)
+ *
+ *  When a frame is shown out of the ring, pic, cpic, and epic are *not*
+ *  updated until something needs them (see AnimSync()).
+ */
+
+#include "copyright.h"
+
+#define NEEDSTIME
+#include "xv.h"
+
+#define ANIM_CACHE  (32L * 1024L * 1024L)  /* max bytes of XImage data kept */
+#define ANIM_SLOTS  64                     /* max # of frames kept */
+
+static ANIMSRC *anim = (ANIMSRC *) NULL;
+static int      curFrame;          /* frame being shown */
+static int      playing;           /* not paused */
+static int      stale;             /* pic/cpic/epic aren't of curFrame */
+static int      building;          /* we're the one calling CreateXImage() */
+static byte     amap[256];         /* frame colors -> 'pic' colors */
+static struct timeval due;         /* when the next frame should go up */
+
+static char    *slotData[ANIM_SLOTS];   /* XImage data for cached frames */
+static int      slotFrame[ANIM_SLOTS];  /* which frame is in each slot */
+static int      nslots;                 /* # of slots in use */
+static long     slotSize;               /* size of each slot */
+
+static void  showFrame    PARM((int));
+static void  renderFrame  PARM((int));
+static long  imageSize    PARM((XImage *));
+static void  freeSlots    PARM((void));
+static void  setDue       PARM((int));
+
+
+
+/***********************************/
+void AnimInit(as)
+     ANIMSRC *as;
+{
+  /* called by openPic() once the first frame of 'as' has been installed
+     as 'pic', and the colors have been allocated */
+
+  byte *tmp, *pp, *tp, used[256];
+  int   i, j, d, mind, best;
+
+  AnimKill();
+
+  if (!pic || picType != PIC8 || pWIDE != as->w || pHIGH != as->h ||
+      as->nframes < 2) {
+    (as->free)(as);
+    return;
+  }
+
+  /* SortColormap() has renumbered the colors in 'pic', so build a table
+     that maps the frame colors to 'pic' colors, by comparing frame #0 to
+     'pic'.  Colors that aren't used in frame #0 get the nearest one that is */
+
+  tmp = (byte *) malloc((size_t) pWIDE * pHIGH);
+  if (!tmp || !(as->render)(as, 0, tmp)) {
+    if (tmp) free(tmp);
+    (as->free)(as);
+    return;
+  }
+
+  for (i=0; i<256; i++) used[i] = 0;
+  for (i=pWIDE*pHIGH, pp=pic, tp=tmp; i; i--, pp++, tp++) {
+    amap[*tp] = *pp;  used[*tp] = 1;
+  }
+  free(tmp);
+
+  for (i=0; i<256; i++) {
+    if (used[i]) continue;
+    mind = 1000000;  best = 0;
+    for (j=0; j<256 && mind; j++) {
+      if (!used[j]) continue;
+      d = abs(as->r[i] - as->r[j]) + abs(as->g[i] - as->g[j]) +
+	  abs(as->b[i] - as->b[j]);
+      if (d < mind) { mind = d;  best = j; }
+    }
+    amap[i] = amap[best];
+  }
+
+  anim     = as;
+  curFrame = 0;
+  playing  = 1;
+  stale    = 0;
+  nslots   = 0;
+  setDue(0);
+}
+
+
+/***********************************/
+void AnimKill()
+{
+  if (!anim) return;
+
+  AnimSync();
+  freeSlots();
+  (anim->free)(anim);
+  anim = (ANIMSRC *) NULL;
+  playing = stale = 0;
+}
+
+
+/***********************************/
+int AnimActive()
+{
+  return (anim != NULL);
+}
+
+
+/***********************************/
+int AnimPlaying()
+{
+  return (anim && playing && !useroot && mainW);
+}
+
+
+/***********************************/
+int AnimNumFrames()
+{
+  return (anim) ? anim->nframes : 0;
+}
+
+
+/***********************************/
+int AnimCurFrame()
+{
+  return (anim) ? curFrame : 0;
+}
+
+
+/***********************************/
+long AnimIdle()
+{
+  /* called from EventLoop() when there are no X events to deal with.
+     Shows the next frame if it's time.  Returns the # of milliseconds
+     until the next frame is due, which is how long EventLoop() can wait
+     for an X event, or -1 if the animation isn't playing */
+
+  struct timeval now;
+  long   ms;
+
+  if (!AnimPlaying()) return -1;
+
+  gettimeofday(&now, (struct timezone *) NULL);
+  ms = (due.tv_sec - now.tv_sec) * 1000L + (due.tv_usec - now.tv_usec) / 1000L;
+  if (ms > 0) return ms;
+
+  showFrame((curFrame + 1) % anim->nframes);
+  XFlush(theDisp);
+
+  /* keep to the schedule, unless we've fallen way behind it */
+  ms += (anim->delay)(anim, curFrame);
+  if (ms <= 0) {
+    setDue(curFrame);
+    ms = (anim->delay)(anim, curFrame);
+  }
+  else {
+    due.tv_sec  = now.tv_sec  + ms / 1000L;
+    due.tv_usec = now.tv_usec + (ms % 1000L) * 1000L;
+    if (due.tv_usec >= 1000000L) { due.tv_sec++;  due.tv_usec -= 1000000L; }
+  }
+
+  return ms;
+}
+
+
+/***********************************/
+void AnimStep(dir)
+     int dir;
+{
+  if (!anim) return;
+  playing = 0;
+  AnimGoto((curFrame + anim->nframes + ((dir>0) ? 1 : -1)) % anim->nframes);
+}
+
+
+/***********************************/
+void AnimGoto(n)
+     int n;
+{
+  if (!anim || n < 0 || n >= anim->nframes) return;
+
+  showFrame(n);
+  setDue(n);
+  SetISTR(ISTR_INFO, "Frame %d of %d.", curFrame+1, anim->nframes);
+}
+
+
+/***********************************/
+void AnimToggle()
+{
+  if (!anim) return;
+
+  playing = !playing;
+  if (playing) setDue(curFrame);
+  SetISTR(ISTR_INFO, "Animation %s at frame %d of %d.",
+	  (playing) ? "playing" : "paused", curFrame+1, anim->nframes);
+}
+
+
+/***********************************/
+void AnimFlush()
+{
+  /* called by CreateXImage().  If it wasn't us calling it, theImage is
+     going to be different from now on, so the cached frames are no good */
+
+  int i;
+
+  if (building) return;
+  for (i=0; i<nslots; i++) slotFrame[i] = -1;
+}
+
+
+/***********************************/
+void AnimSync()
+{
+  /* make pic, cpic, and epic hold the frame that's being shown, before
+     anybody does anything with them */
+
+  if (!anim || !stale) return;
+
+  stale = 0;
+  renderFrame(curFrame);
+  if (epic != cpic) {
+    building = 1;
+    GenerateEpic(eWIDE, eHIGH);
+    building = 0;
+  }
+  SetCursors(-1);
+}
+
+
+
+/***********************************/
+static void showFrame(n)
+     int n;
+{
+  int   slot;
+  long  size;
+
+  if (!anim || !pic || picType != PIC8 || !theImage) return;
+
+  curFrame = n;
+  size = imageSize(theImage);
+
+  if (size != slotSize) {      /* theImage changed shape.  start over */
+    freeSlots();
+    slotSize = size;
+    nslots = ANIM_CACHE / size;
+    if (nslots > ANIM_SLOTS)     nslots = ANIM_SLOTS;
+    if (nslots > anim->nframes)  nslots = anim->nframes;
+    for (slot=0; slot<nslots; slot++) slotFrame[slot] = -1;
+  }
+
+  slot = (nslots) ? n % nslots : -1;
+
+  if (slot >= 0 && slotFrame[slot] == n) {   /* got it.  just draw it */
+    xvbcopy(slotData[slot], theImage->data, (size_t) size);
+    stale = 1;
+  }
+
+  else {
+    /* build it the hard way */
+    renderFrame(n);
+    building = 1;
+    if (epic != cpic) GenerateEpic(eWIDE, eHIGH);
+    CreateXImage();
+    building = 0;
+    stale = 0;
+
+    if (slot >= 0 && theImage && imageSize(theImage) == size) {
+      if (!slotData[slot]) slotData[slot] = (char *) malloc((size_t) size);
+      if (slotData[slot]) {
+	xvbcopy(theImage->data, slotData[slot], (size_t) size);
+	slotFrame[slot] = n;
+      }
+    }
+    SetCursors(-1);
+  }
+
+  DrawWindow(0, 0, eWIDE, eHIGH);
+  if (HaveSelection()) DrawSelection(0);
+}
+
+
+/***********************************/
+static void renderFrame(n)
+     int n;
+{
+  /* renders frame #n into pic (using pic's colors), and regenerates cpic */
+
+  byte *pp;
+  int   i;
+
+  if (!(anim->render)(anim, n, pic)) return;
+  for (i=pWIDE*pHIGH, pp=pic; i; i--, pp++) *pp = amap[*pp];
+
+  if (cpic != pic) {
+    byte *cp;
+    for (i=0, cp=cpic; i<cHIGH; i++, cp += cWIDE)
+      xvbcopy((char *) pic + (i+cYOFF) * pWIDE + cXOFF, (char *) cp,
+	      (size_t) cWIDE);
+  }
+}
+
+
+/***********************************/
+static long imageSize(xim)
+     XImage *xim;
+{
+  long size;
+
+  size = (long) xim->bytes_per_line * xim->height;
+  if (xim->format != ZPixmap) size *= xim->depth;
+  return size;
+}
+
+
+/***********************************/
+static void freeSlots()
+{
+  int i;
+
+  for (i=0; i<ANIM_SLOTS; i++) {
+    if (slotData[i]) free(slotData[i]);
+    slotData[i] = (char *) NULL;
+    slotFrame[i] = -1;
+  }
+  nslots = 0;  slotSize = 0;
+}
+
+
+/***********************************/
+static void setDue(n)
+     int n;
+{
+  /* frame #n has just gone up.  figure out when the next one is due */
+
+  long ms;
+
+  gettimeofday(&due, (struct timezone *) NULL);
+  ms = (anim->delay)(anim, n);
+  due.tv_sec  += ms / 1000L;
+  due.tv_usec += (ms % 1000L) * 1000L;
+  if (due.tv_usec >= 1000000L) { due.tv_sec++;  due.tv_usec -= 1000000L; }
+}
@@ -0,0 +1,454 @@
+/*
+ * xvbatch.c - converts image files without a display (the '-convert' option)
+ *
+ *  Contains:
+ *     int BatchConvert(argc, argv)  - converts the files named in argv
+ *
+ *  xv -convert fmt [-resize WxH] [-ncols #] [-grey | -dither] [-jobs #]
+ *                  [-odir dir] [-best24 | -quick24 | -slow24 | -ordered24]
+ *                  [-stretch type] file ...
+ *
+ *  Each file is read with ReadPicFile(), optionally smooth-resized with
+ *  Smooth24(), quantized with Conv24to8(), and written out with the same
+ *  Write*() function that the 'Save' box would have used.  The output file
+ *  gets the name of the input file, with the suffix changed, and goes in
+ *  the same directory as the input file (or 'dir', if -odir is given).
+ *
+ *  Files are converted by up to '-jobs' child processes at once (by default,
+ *  one per CPU, where that can be found out).  The exit status is '0' if
+ *  every file was converted.
+ */
+
+#include "copyright.h"
+
+#define NEEDSDIR
+#include "xv.h"
+
+#ifndef VMS
+#  include <sys/wait.h>
+#endif
+
+
+#define OUTBUFSIZE 65536          /* stdio buffer for the output file */
+
+
+static struct { char *name, *suffix;  int fmt, col; } fmtTab[] = {
+  { "gif",    "gif",  F_GIF,    -1 },
+  { "pm",     "pm",   F_PM,     -1 },
+  { "ppm",    "ppm",  F_PBMRAW, F_FULLCOLOR },
+  { "pgm",    "pgm",  F_PBMRAW, F_GREYSCALE },
+  { "pbm",    "pbm",  F_PBMRAW, F_BWDITHER  },
+  { "xbm",    "xbm",  F_XBM,    F_BWDITHER  },
+  { "xpm",    "xpm",  F_XPM,    -1 },
+  { "bmp",    "bmp",  F_BMP,    -1 },
+  { "sunras", "ras",  F_SUNRAS, -1 },
+  { "iris",   "rgb",  F_IRIS,   -1 },
+  { "targa",  "tga",  F_TARGA,  -1 },
+  { "fits",   "fits", F_FITS,   F_GREYSCALE }
+};
+#define NFMTS (sizeof(fmtTab) / sizeof(fmtTab[0]))
+
+
+static int   outFmt;              /* index into fmtTab[] */
+static int   outCol;              /* F_FULLCOLOR, F_GREYSCALE, F_BWDITHER */
+static int   outWide, outHigh;    /* -resize size (0 = keep aspect ratio) */
+static int   outCols;             /* -ncols (0 = leave colors alone) */
+static char *outDir;              /* -odir (NULL = next to input file) */
+static char  outbuf[OUTBUFSIZE];
+
+static int   convertFile  PARM((char *));
+static int   processPic   PARM((PICINFO *));
+static int   writeFile    PARM((char *, PICINFO *));
+static void  makeOutName  PARM((char *, char *));
+static int   numColors    PARM((PICINFO *));
+static int   batchError   PARM((char *, const char *));
+static void  batchSyntax  PARM((void));
+
+
+
+/*******************************************/
+int BatchConvert(argc, argv)
+     int    argc;
+     char **argv;
+{
+  int    i, nfiles, njobs, nfail;
+  char **files;
+
+  outFmt = -1;  outCol = F_FULLCOLOR;  outWide = outHigh = outCols = 0;
+  outDir = (char *) NULL;
+
+  njobs = 1;
+#if !defined(VMS) && defined(_SC_NPROCESSORS_ONLN)
+  njobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+  files = (char **) malloc(argc * sizeof(char *));
+  if (!files) FatalError("can't malloc file list in BatchConvert()");
+  nfiles = 0;
+
+  for (i=1; i<argc; i++) {
+    if (argv[i][0] != '-') files[nfiles++] = argv[i];
+
+    else if (!strcmp(argv[i], "-convert") && i+1<argc) {
+      for (outFmt=0; outFmt<NFMTS; outFmt++)
+	if (!strcmp(argv[i+1], fmtTab[outFmt].name)) break;
+      if (outFmt == NFMTS) {
+	fprintf(stderr, "%s: unknown output format '%s'\n", cmd, argv[i+1]);
+	batchSyntax();
+      }
+      i++;
+    }
+
+    else if (!strcmp(argv[i], "-resize") && i+1<argc) {
+      if (sscanf(argv[++i], "%dx%d", &outWide, &outHigh) != 2 ||
+	  outWide < 0 || outHigh < 0 || (outWide == 0 && outHigh == 0))
+	batchSyntax();
+    }
+
+    else if (!strcmp(argv[i], "-ncols") && i+1<argc) {
+      outCols = atoi(argv[++i]);
+      if (outCols < 2 || outCols > 256) batchSyntax();
+    }
+
+    else if (!strcmp(argv[i], "-jobs") && i+1<argc) {
+      njobs = atoi(argv[++i]);
+    }
+
+    else if (!strcmp(argv[i], "-odir") && i+1<argc) outDir = argv[++i];
+
+    else if (!strcmp(argv[i], "-stretch") && i+1<argc) {
+      stretchMode = StretchParse(argv[++i]);
+      if (stretchMode < 0) {
+	fprintf(stderr, "%s: unknown stretch '%s'\n", cmd, argv[i]);
+	batchSyntax();
+      }
+    }
+
+    else if (!strcmp(argv[i], "-grey") || !strcmp(argv[i], "-gray"))
+      outCol = F_GREYSCALE;
+    else if (!strcmp(argv[i], "-dither"))  outCol = F_BWDITHER;
+    else if (!strcmp(argv[i], "-best24"))  conv24 = CONV24_BEST;
+    else if (!strcmp(argv[i], "-quick24")) conv24 = CONV24_FAST;
+    else if (!strcmp(argv[i], "-slow24"))  conv24 = CONV24_SLOW;
+    else if (!strcmp(argv[i], "-ordered24")) conv24 = CONV24_ORDER;
+    else batchSyntax();
+  }
+
+  if (outFmt < 0 || nfiles == 0) batchSyntax();
+  if (fmtTab[outFmt].col >= 0) outCol = fmtTab[outFmt].col;
+  if (njobs < 1) njobs = 1;
+
+  /* main() hasn't set up fsgamcr[] yet, and without it, the B/W dithers
+     turn everything black */
+  if (outCol == F_BWDITHER) GenerateFSGamma();
+
+  nfail = 0;
+
+#ifndef VMS
+  if (njobs > 1 && nfiles > 1) {
+    /* keep up to 'njobs' children busy, one file apiece */
+    int running, status, pid;
+
+    fflush(stdout);  fflush(stderr);
+
+    for (i=0, running=0; i<nfiles || running; ) {
+      if (i<nfiles && running<njobs) {
+	pid = fork();
+	if (pid == 0) exit(convertFile(files[i]));
+	else if (pid < 0) { if (convertFile(files[i])) nfail++; }
+	else running++;
+	i++;
+      }
+
+      else {
+	if (wait(&status) < 0) break;
+	running--;
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) nfail++;
+      }
+    }
+  }
+  else
+#endif
+
+  for (i=0; i<nfiles; i++)
+    if (convertFile(files[i])) nfail++;
+
+  free(files);
+
+  if (nfail)
+    fprintf(stderr, "%s: %d of %d file%s not converted.\n",
+	    cmd, nfail, nfiles, (nfiles==1) ? "" : "s");
+
+  return (nfail) ? 1 : 0;
+}
+
+
+
+/*******************************************/
+static int convertFile(fname)
+     char *fname;
+{
+  /* converts one file.  Returns '0' if successful */
+
+  PICINFO pinfo;
+  char    loadname[MAXPATHLEN+1], outname[MAXPATHLEN+1];
+  int     ftype, rv, uncomp;
+
+  strcpy(loadname, fname);
+  uncomp = 0;
+
+  ftype = ReadFileType(loadname);
+  if (ftype == RFT_COMPRESS) {
+    if (UncompressFile(fname, loadname)) {
+      ftype = ReadFileType(loadname);
+      uncomp = 1;
+    }
+    else ftype = RFT_ERROR;
+  }
+
+  if (ftype == RFT_ERROR)
+    return batchError(fname, ERRSTR(errno));
+
+  if (ftype == RFT_UNKNOWN || ftype < RFT_ERROR) {
+    if (uncomp) unlink(loadname);
+    return batchError(fname, "not in a readable format");
+  }
+
+  xvbzero((char *) &pinfo, sizeof(PICINFO));
+  SetISTR(ISTR_WARNING, "");
+
+  rv = ReadPicFile(loadname, ftype, &pinfo, 0);
+  if (uncomp) unlink(loadname);
+
+  if (rv) {
+    /* only the first page (or frame) gets converted */
+    if (pinfo.anim)  (pinfo.anim->free)(pinfo.anim);
+    if (pinfo.pages) (pinfo.pages->free)(pinfo.pages);
+    DeepFree(pinfo.deep);
+    if (pinfo.numpages > 1) KillPageFiles(pinfo.pagebname, pinfo.numpages);
+  }
+
+  if (!rv || !pinfo.pic) {
+    if (pinfo.comment) free(pinfo.comment);
+    return batchError(fname, (strlen(GetISTR(ISTR_WARNING))) ?
+		      GetISTR(ISTR_WARNING) : "couldn't load file");
+  }
+
+  makeOutName(fname, outname);
+  if (!strcmp(outname, fname)) rv = batchError(fname, "would overwrite itself");
+  else if (processPic(&pinfo))  rv = batchError(fname, "out of memory");
+  else                          rv = writeFile(outname, &pinfo);
+
+  if (pinfo.pic)     free(pinfo.pic);
+  if (pinfo.comment) free(pinfo.comment);
+
+  return rv;
+}
+
+
+
+/*******************************************/
+static int processPic(pinfo)
+     PICINFO *pinfo;
+{
+  /* resizes, quantizes, and/or dithers pinfo->pic, as asked for.  Returns
+     '0' if successful */
+
+  byte *np;
+  int   w, h;
+
+  if (outWide || outHigh) {
+    w = outWide;  h = outHigh;
+    if (!w) w = (pinfo->w * h + pinfo->h/2) / pinfo->h;
+    if (!h) h = (pinfo->h * w + pinfo->w/2) / pinfo->w;
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+
+    if (w != pinfo->w || h != pinfo->h) {
+      np = Smooth24(pinfo->pic, pinfo->type == PIC24, pinfo->w, pinfo->h,
+		    w, h, pinfo->r, pinfo->g, pinfo->b);
+      if (!np) return 1;
+      free(pinfo->pic);
+      pinfo->pic  = np;    pinfo->type = PIC24;
+      pinfo->w    = w;     pinfo->h    = h;
+    }
+  }
+
+
+  if (outCol == F_BWDITHER) {
+    if (conv24 == CONV24_ORDER)
+      np = OrderDither(pinfo->pic, pinfo->type, pinfo->w, pinfo->h,
+		       pinfo->r, pinfo->g, pinfo->b, 0, 1);
+    else
+      np = FSDither(pinfo->pic, pinfo->type, pinfo->w, pinfo->h,
+		    pinfo->r, pinfo->g, pinfo->b, 0, 1);
+    if (!np) return 1;
+    free(pinfo->pic);
+    pinfo->pic  = np;   pinfo->type = PIC8;
+    pinfo->r[0] = pinfo->g[0] = pinfo->b[0] = 0;
+    pinfo->r[1] = pinfo->g[1] = pinfo->b[1] = 255;
+  }
+
+  else if (outCols && outCol == F_FULLCOLOR) {
+    if (pinfo->type == PIC8 && numColors(pinfo) > outCols) {
+      np = Conv8to24(pinfo->pic, pinfo->w, pinfo->h,
+		     pinfo->r, pinfo->g, pinfo->b);
+      if (!np) return 1;
+      free(pinfo->pic);
+      pinfo->pic = np;   pinfo->type = PIC24;
+    }
+
+    if (pinfo->type == PIC24) {
+      np = Conv24to8(pinfo->pic, pinfo->w, pinfo->h, outCols,
+		     pinfo->r, pinfo->g, pinfo->b);
+      if (!np) return 1;
+      free(pinfo->pic);
+      pinfo->pic = np;   pinfo->type = PIC8;
+    }
+  }
+
+  return 0;
+}
+
+
+
+/*******************************************/
+static int writeFile(fname, pinfo)
+     char    *fname;
+     PICINFO *pinfo;
+{
+  FILE *fp;
+  byte *pic, *rp, *gp, *bp;
+  int   w, h, ptype, nc, col, rv;
+
+  fp = fopen(fname, "w");
+  if (!fp) return batchError(fname, ERRSTR(errno));
+  setvbuf(fp, outbuf, _IOFBF, (size_t) OUTBUFSIZE);
+
+  pic = pinfo->pic;  ptype = pinfo->type;  w = pinfo->w;  h = pinfo->h;
+  rp  = pinfo->r;    gp    = pinfo->g;     bp = pinfo->b;
+  nc  = (ptype == PIC8) ? numColors(pinfo) : 0;
+  col = outCol;
+  rv  = 0;
+
+  switch (fmtTab[outFmt].fmt) {
+  case F_GIF:
+    rv = WriteGIF   (fp, pic, ptype, w, h, rp,gp,bp, nc,col,pinfo->comment);
+    break;
+
+  case F_PM:
+    rv = WritePM    (fp, pic, ptype, w, h, rp,gp,bp, nc,col,pinfo->comment);
+    break;
+
+  case F_PBMRAW:
+    rv = WritePBM   (fp, pic, ptype, w, h, rp,gp,bp, nc,col,1,pinfo->comment);
+    break;
+
+  case F_XBM:
+    rv = WriteXBM   (fp, pic, w, h, rp, gp, bp, fname);                 break;
+
+  case F_SUNRAS:
+    rv = WriteSunRas(fp, pic, ptype, w, h, rp, gp, bp, nc, col,0);      break;
+
+  case F_BMP:
+    rv = WriteBMP   (fp, pic, ptype, w, h, rp, gp, bp, nc, col);        break;
+
+  case F_IRIS:
+    rv = WriteIRIS  (fp, pic, ptype, w, h, rp, gp, bp, nc, col);        break;
+
+  case F_TARGA:
+    rv = WriteTarga (fp, pic, ptype, w, h, rp, gp, bp, nc, col);        break;
+
+  case F_XPM:
+    rv = WriteXPM   (fp, pic, ptype, w, h, rp, gp, bp, nc, col,
+		     fname, pinfo->comment);
+    break;
+
+  case F_FITS:
+    rv = WriteFITS  (fp, pic, ptype, w, h, rp, gp, bp, nc, col,
+		     pinfo->comment);
+    break;
+  }
+
+  if (fclose(fp) == EOF) rv = 1;
+
+  if (rv) {
+    unlink(fname);
+    return batchError(fname, "couldn't write file");
+  }
+
+  return 0;
+}
+
+
+
+/*******************************************/
+static void makeOutName(fname, outname)
+     char *fname, *outname;
+{
+  /* builds the name of the output file for 'fname' */
+
+  char *sp, *dp;
+
+  if (outDir) sprintf(outname, "%s/%s", outDir, BaseName(fname));
+         else strcpy(outname, fname);
+
+  /* lose '.Z', '.gz', etc. then the real suffix */
+  sp = (char *) rindex(BaseName(outname), '.');
+  if (sp && (!strcmp(sp, ".Z") || !strcmp(sp, ".z") || !strcmp(sp, ".gz")))
+    *sp = '\0';
+
+  sp = (char *) rindex(BaseName(outname), '.');
+  if (sp && sp != BaseName(outname)) *sp = '\0';
+
+  dp = outname + strlen(outname);
+  sprintf(dp, ".%s", fmtTab[outFmt].suffix);
+}
+
+
+
+/*******************************************/
+static int numColors(pinfo)
+     PICINFO *pinfo;
+{
+  /* returns # of colormap entries used by 8-bit image in pinfo */
+
+  byte *pp;
+  int   i, max;
+
+  for (i=pinfo->w * pinfo->h, pp=pinfo->pic, max=0; i; i--, pp++)
+    if (*pp > max) max = *pp;
+
+  return max+1;
+}
+
+
+
+/*******************************************/
+static int batchError(fname, st)
+     char       *fname;
+     const char *st;
+{
+  fprintf(stderr, "%s: %s:  %s\n", cmd, fname, st);
+  return 1;
+}
+
+
+
+/*******************************************/
+static void batchSyntax()
+{
+  int i;
+
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "   %s -convert fmt [-resize WxH] [-ncols #] [-grey | -dither]\n",
+	  cmd);
+  fprintf(stderr, "      [-jobs #] [-odir dir] [-stretch type]\n");
+  fprintf(stderr, "      [-best24 | -quick24 | -slow24 | -ordered24] file ...\n\n");
+  fprintf(stderr, "   where 'fmt' is one of:  ");
+  for (i=0; i<NFMTS; i++) fprintf(stderr, "%s ", fmtTab[i].name);
+  fprintf(stderr, "\n   and 'type' is one of:  ");
+  for (i=0; i<=STR_MAX; i++) fprintf(stderr, "%s ", StretchName(i));
+  fprintf(stderr, "\n\n");
+  Quit(1);
+}
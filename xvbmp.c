@@ -37,10 +37,10 @@ static u_int getshort   PARM((FILE *));
 static u_int getint     PARM((FILE *));
 static void  putshort   PARM((FILE *, int));
 static void  putint     PARM((FILE *, int));
-static void  writeBMP1  PARM((FILE *, byte *, int, int));
-static void  writeBMP4  PARM((FILE *, byte *, int, int));
-static void  writeBMP8  PARM((FILE *, byte *, int, int));
-static void  writeBMP24 PARM((FILE *, byte *, int, int));
+static void  writeBMP1  PARM((FILE *, byte *, int, int, byte *, int));
+static void  writeBMP4  PARM((FILE *, byte *, int, int, byte *, int));
+static void  writeBMP8  PARM((FILE *, byte *, int, int, byte *, int));
+static void  writeBMP24 PARM((FILE *, byte *, int, int, byte *, int));
 static int   bmpError   PARM((char *, char *));
 
 
@@ -567,7 +567,7 @@ int WriteBMP(fp,pic824,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle)
    */
 
   int i,j, nc, nbits, bperlin, cmaplen;
-  byte *graypic, *sp, *dp, graymap[256];
+  byte *graypic, *sp, *dp, *line, graymap[256];
 
   nc = nbits = cmaplen = 0;
   graypic = NULL;
@@ -676,12 +676,16 @@ int WriteBMP(fp,pic824,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle)
     }
   }
 
-  /* write out the image */
-  if      (nbits ==  1) writeBMP1 (fp, pic824, w, h);
-  else if (nbits ==  4) writeBMP4 (fp, pic824, w, h);
-  else if (nbits ==  8) writeBMP8 (fp, pic824, w, h);
-  else if (nbits == 24) writeBMP24(fp, pic824, w, h);
+  /* write out the image, a line at a time */
+  line = (byte *) calloc((size_t) bperlin, (size_t) 1);
+  if (!line) FatalError("unable to malloc in WriteBMP()");
 
+  if      (nbits ==  1) writeBMP1 (fp, pic824, w, h, line, bperlin);
+  else if (nbits ==  4) writeBMP4 (fp, pic824, w, h, line, bperlin);
+  else if (nbits ==  8) writeBMP8 (fp, pic824, w, h, line, bperlin);
+  else if (nbits == 24) writeBMP24(fp, pic824, w, h, line, bperlin);
+
+  free(line);
   if (graypic) free(graypic);
 
 #ifndef VMS
@@ -697,115 +701,99 @@ int WriteBMP(fp,pic824,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle)
 	  
 	  
 /*******************************************/
-static void writeBMP1(fp, pic8, w, h)
+static void writeBMP1(fp, pic8, w, h, line, bperlin)
      FILE *fp;
-     byte *pic8;
-     int  w,h;
+     byte *pic8, *line;
+     int  w,h,bperlin;
 {
-  int   i,j,c,bitnum,padw;
-  byte *pp;
+  /* each of the writeBMP*() functions builds a line of output in 'line'
+     (which is 'bperlin' bytes long, zeroed, and big enough to hold the 
+     padding at the end of the line), and writes it with a single fwrite() */
 
-  padw = ((w + 31)/32) * 32;  /* 'w', padded to be a multiple of 32 */
+  int   i,j,c,bitnum;
+  byte *pp, *lp;
 
   for (i=h-1; i>=0; i--) {
     pp = pic8 + (i * w);  
     if ((i&0x3f)==0) WaitCursor();
 
-    for (j=bitnum=c=0; j<=padw; j++,bitnum++) {
-      if (bitnum == 8) { /* write the next byte */
-	putc(c,fp);
-	bitnum = c = 0;
-      }
-      
-      c <<= 1;
-
-      if (j<w) {
-	c |= (pc2nc[*pp++] & 0x01);
-      }
+    for (j=bitnum=c=0, lp=line; j<w; j++) {
+      c = (c << 1) | (pc2nc[*pp++] & 0x01);
+      if (++bitnum == 8) { *lp++ = c;  bitnum = c = 0; }
     }
+    if (bitnum) *lp++ = c << (8 - bitnum);
+
+    if (fwrite((char *) line, (size_t) 1, (size_t) bperlin, fp) != bperlin)
+      return;
   }
 }  
 
 
 
 /*******************************************/
-static void writeBMP4(fp, pic8, w, h)
+static void writeBMP4(fp, pic8, w, h, line, bperlin)
      FILE *fp;
-     byte *pic8;
-     int  w,h;
+     byte *pic8, *line;
+     int  w,h,bperlin;
 {
-  int   i,j,c,nybnum,padw;
-  byte *pp;
-
-
-  padw = ((w + 7)/8) * 8; /* 'w' padded to a multiple of 8pix (32 bits) */
+  int   i,j;
+  byte *pp, *lp;
 
   for (i=h-1; i>=0; i--) {
     pp = pic8 + (i * w);
     if ((i&0x3f)==0) WaitCursor();
 
-    for (j=nybnum=c=0; j<=padw; j++,nybnum++) {
-      if (nybnum == 2) { /* write next byte */
-	putc((c&0xff), fp);
-	nybnum = c = 0;
-      }
-
-      c <<= 4;
+    for (j=0, lp=line; j<w-1; j+=2, pp+=2)
+      *lp++ = ((pc2nc[pp[0]] & 0x0f) << 4) | (pc2nc[pp[1]] & 0x0f);
+    if (j<w) *lp++ = (pc2nc[pp[0]] & 0x0f) << 4;
 
-      if (j<w) {
-	c |= (pc2nc[*pp] & 0x0f);
-	pp++;
-      }
-    }
+    if (fwrite((char *) line, (size_t) 1, (size_t) bperlin, fp) != bperlin)
+      return;
   }
 }  
 
 
 
 /*******************************************/
-static void writeBMP8(fp, pic8, w, h)
+static void writeBMP8(fp, pic8, w, h, line, bperlin)
      FILE *fp;
-     byte *pic8;
-     int  w,h;
+     byte *pic8, *line;
+     int  w,h,bperlin;
 {
-  int   i,j,c,padw;
-  byte *pp;
-
-  padw = ((w + 3)/4) * 4; /* 'w' padded to a multiple of 4pix (32 bits) */
+  int   i,j;
+  byte *pp, *lp;
 
   for (i=h-1; i>=0; i--) {
     pp = pic8 + (i * w);
     if ((i&0x3f)==0) WaitCursor();
 
-    for (j=0; j<w; j++) putc(pc2nc[*pp++], fp);
-    for ( ; j<padw; j++) putc(0, fp);
+    for (j=0, lp=line; j<w; j++) *lp++ = pc2nc[*pp++];
+
+    if (fwrite((char *) line, (size_t) 1, (size_t) bperlin, fp) != bperlin)
+      return;
   }
 }  
 
 
 /*******************************************/
-static void writeBMP24(fp, pic24, w, h)
+static void writeBMP24(fp, pic24, w, h, line, bperlin)
      FILE *fp;
-     byte *pic24;
-     int  w,h;
+     byte *pic24, *line;
+     int  w,h,bperlin;
 {
-  int   i,j,c,padb;
-  byte *pp;
-
-  padb = (4 - ((w*3) % 4)) & 0x03;  /* # of pad bytes to write at EOscanline */
+  int   i,j;
+  byte *pp, *lp;
 
   for (i=h-1; i>=0; i--) {
     pp = pic24 + (i * w * 3);
     if ((i&0x3f)==0) WaitCursor();
 
-    for (j=0; j<w; j++) {
-      putc(pp[2], fp);
-      putc(pp[1], fp);
-      putc(pp[0], fp);
-      pp += 3;
+    for (j=0, lp=line; j<w; j++, pp+=3, lp+=3) {
+      lp[0] = pp[2];  lp[1] = pp[1];  lp[2] = pp[0];
     }
 
-    for (j=0; j<padb; j++) putc(0, fp);
+    if (fwrite((char *) line, (size_t) 1, (size_t) bperlin, fp) != bperlin)
+      return;
   }
 }  
 
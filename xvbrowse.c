@@ -12,6 +12,7 @@
  *      int  BrowseDelWin(Window);
  *      void SetBrowStr(char *);
  *      void RegenBrowseIcons();
+ *      void BRDirChanged(int);
  *
  */
 
@@ -208,6 +209,7 @@ typedef struct {  Window win, iconW;
 		  int    ndirs;
 		  char  *mblist[MAXDEEP];
 		  char   path[MAXPATHLEN+2];   /* '/' terminated */
+		  int    watch;                /* WatchDir() of path, or -1 */
 		} BROWINFO;
 
 
@@ -257,6 +259,7 @@ static int  bfnamCmp         PARM((const void *, const void *));
 static void rescanDir        PARM((BROWINFO *));
 static int  namcmp           PARM((const void *, const void *));
 static void freeBfList       PARM((BROWINFO *br));
+static void watchPath        PARM((BROWINFO *br));
 static char **getDirEntries  PARM((char *, int *, int));
 static void computeScrlVals  PARM((BROWINFO *, int *, int *));
 static void genSelectedIcons PARM((BROWINFO *));
@@ -358,7 +361,10 @@ void CreateBrowse(geom, fgstr, bgstr, histr, lostr)
 
   /* creates *all* schnauzer windows at once */
 
-  for (i=0; i<MAXBRWIN; i++) binfo[i].win = (Window) NULL;
+  for (i=0; i<MAXBRWIN; i++) {
+    binfo[i].win   = (Window) NULL;
+    binfo[i].watch = -1;
+  }
 
   for (i=0; i<MAXBRWIN; i++) {
     char wname[64];
@@ -648,6 +654,8 @@ static void closeBrowse(br)
   /* free all info for this browse window */
   freeBfList(br);
   sprintf(br->path, BOGUSPATH);
+  UnwatchDir(br->watch);
+  br->watch = -1;
   
   /* turn on 'open new window' command doodads */
   windowMB.dim[WMB_BROWSE] = 0;
@@ -1036,6 +1044,28 @@ void BRCreatedFile(name)
 }
 
 
+/***************************************************************/
+void BRDirChanged(wd)
+     int wd;
+{
+  /* called by CheckWatches() when files have come or gone in a watched
+     directory.  Rescans any browsers that are showing it */
+
+  int  i;
+  char cwd[MAXPATHLEN+1];
+
+  if (wd < 0) return;
+
+  xv_getwd(cwd, sizeof(cwd));     /* rescanDir() does a chdir() */
+
+  for (i=0; i<MAXBRWIN; i++) {
+    if (binfo[i].vis && binfo[i].watch == wd) rescanDir(&binfo[i]);
+  }
+
+  chdir(cwd);
+}
+
+
 /**************************************************************/
 /***                    INTERNAL FUNCTIONS                  ***/
 /**************************************************************/
@@ -2707,6 +2737,7 @@ static void copyDirInfo(srcbr, dstbr)
   XClearArea(theDisp, dstbr->iconW, 0, 0, (u_int) dstbr->iwWide, 
 	     (u_int) dstbr->iwHigh, True);
   SCSetRange(&dstbr->scrl, 0, maxv, dstbr->scrl.val, page);
+  watchPath(dstbr);
 
   SetCursors(-1);
 }
@@ -2947,11 +2978,27 @@ static void endScan(br, oldnum)
 	     (u_int) w, (u_int) h, False);
 
   SCSetRange(&br->scrl, 0, maxv, br->scrl.val, page);
+  watchPath(br);
   
   SetCursors(-1);
 }
 
 
+/***************************************************************/
+static void watchPath(br)
+     BROWINFO *br;
+{
+  /* called whenever br->path has been (re)read.  Makes sure that it's the
+     directory being watched for changes */
+
+  int wd;
+
+  wd = WatchDir(br->path);    /* (before UnwatchDir(), so it's not dropped) */
+  UnwatchDir(br->watch);
+  br->watch = wd;
+}
+
+
 /***************************************************************/
 static void scanFile(br, bf, name)
      BROWINFO *br;
@@ -28,11 +28,38 @@ static void putECfirst     PARM((void));
 static void diverseOrder   PARM((byte *, byte *, byte *, int, byte *));
 static void freeStdCmaps   PARM((void));
 static int  highbit        PARM((unsigned long));
+static int  getColor       PARM((Colormap, XColor *));
+static int  reuseColor     PARM((Colormap, XColor *));
+static void freeOldColors  PARM((void));
 
 
 static char stdCmapSuccess[80];
 
 
+/* FreeColors() doesn't give read-only colors in the shared colormap back
+   right away.  It moves them into the 'old' list, along with the colors
+   they actually are, and the next allocROColors() takes any of them that
+   are within 'reuseTol' of a color it wants, without asking the server.
+   Whatever isn't reused gets freed once the new colors are in.  So going
+   from one image to a similar one (a slideshow, or editing the colors)
+   doesn't free and reallocate cells that haven't changed, and the image
+   on the screen keeps its colors until the new one is ready.
+
+   Only a newly loaded picture gets to use colors that are merely close
+   (REUSE_TOL).  When the colors of the same picture are redone (color
+   editor, gamma, 'perfect' mode), they have to match exactly, or a small
+   change wouldn't show up at all */
+
+#define REUSE_TOL 3     /* max |dr|+|dg|+|db|, in 0..255 units */
+
+static byte          fcr[256], fcg[256], fcb[256];  /* colors of freecols[] */
+static unsigned long oldcols[256];
+static byte          oldr[256], oldg[256], oldb[256];
+static int           noldcols = 0;
+static Colormap      oldcmap;
+static int           reuseTol = 0;
+
+
 /************************************************/
 /* structure and routine used in SortColormap() */
 /************************************************/
@@ -222,6 +249,7 @@ void AllocColors()
     SetISTR(ISTR_COLOR2,"");
     rwthistime = 0;
 
+    freeOldColors();
     RedrawCMap();
     return;
   }
@@ -265,6 +293,7 @@ void AllocColors()
   else if (allocMode == AM_READWRITE) allocRWColors();
   else allocROColors();
 
+  freeOldColors();    /* whatever wasn't reused */
   RedrawCMap();
 }
 
@@ -290,6 +319,21 @@ void FreeColors()
     nfcols = 0;
   }
 
+  else if (!rwthistime && CMAPVIS(theVisual)) {
+    /* keep them around, in case the next colors are much the same */
+    if (noldcols && oldcmap != theCmap) freeOldColors();
+
+    for (i=0; i<nfcols && noldcols<256; i++, noldcols++) {
+      oldcols[noldcols] = freecols[i];
+      oldr[noldcols] = fcr[i];  oldg[noldcols] = fcg[i];  oldb[noldcols] = fcb[i];
+    }
+    for ( ; i<nfcols; i++)
+      xvFreeColors(theDisp, theCmap, &freecols[i], 1, 0L);
+
+    oldcmap = theCmap;
+    nfcols = 0;
+  }
+
   else {
     for (i=0; i<nfcols; i++) 
       xvFreeColors(theDisp, theCmap, &freecols[i], 1, 0L);
@@ -300,6 +344,71 @@ void FreeColors()
 }
 
 
+/********************************/
+static int getColor(cmap, cdef)
+     Colormap cmap;
+     XColor  *cdef;
+{
+  /* xvAllocColor(), for allocROColors(), but takes an old color if there's
+     one close enough.  If the colormap is full, the old colors may be what's
+     in the way, so they're given up at that point, and it tries again */
+
+  if (reuseColor(cmap, cdef)) return 1;
+  if (xvAllocColor(theDisp, cmap, cdef)) return 1;
+  if (!noldcols || cmap != oldcmap) return 0;
+
+  freeOldColors();
+  return xvAllocColor(theDisp, cmap, cdef);
+}
+
+
+/********************************/
+static int reuseColor(cmap, cdef)
+     Colormap cmap;
+     XColor  *cdef;
+{
+  /* looks for a color within reuseTol of 'cdef' in the old colors.  If
+     there is one, takes it out of the list, fills in cdef's pixel and
+     (actual) color, and returns '1'.  The cell is already allocated, so
+     nothing needs to be said to the server */
+
+  int  i, d, r, g, b, best, mind;
+
+  if (!noldcols || cmap != oldcmap) return 0;
+
+  r = cdef->red >> 8;  g = cdef->green >> 8;  b = cdef->blue >> 8;
+  best = -1;  mind = reuseTol + 1;
+  for (i=0; i<noldcols && mind; i++) {
+    d = abs(r - oldr[i]) + abs(g - oldg[i]) + abs(b - oldb[i]);
+    if (d < mind) { mind = d;  best = i; }
+  }
+  if (best < 0) return 0;
+
+  cdef->pixel = oldcols[best];
+  cdef->red   = oldr[best] << 8;
+  cdef->green = oldg[best] << 8;
+  cdef->blue  = oldb[best] << 8;
+
+  noldcols--;
+  oldcols[best] = oldcols[noldcols];
+  oldr[best] = oldr[noldcols];  oldg[best] = oldg[noldcols];
+  oldb[best] = oldb[noldcols];
+  return 1;
+}
+
+
+/********************************/
+static void freeOldColors()
+{
+  /* gives back the old colors that weren't reused */
+
+  if (!noldcols) return;
+  xvFreeColors(theDisp, oldcmap, oldcols, noldcols, 0L);
+  noldcols = 0;
+  XFlush(theDisp);
+}
+
+
 /***********************************/
 static void allocROColors()
 {
@@ -347,7 +456,7 @@ static void allocROColors()
     defs[c].flags = DoRed | DoGreen | DoBlue;
 
     if (!(colorMapMode==CM_OWNCMAP && cmap==theCmap && CMAPVIS(theVisual)) 
-	&& xvAllocColor(theDisp,cmap,&defs[c])) { 
+	&& getColor(cmap, &defs[c])) { 
       unsigned long pixel, *fcptr;
 
       pixel = cols[c] = defs[c].pixel;
@@ -360,6 +469,7 @@ static void allocROColors()
       for (j=0, fcptr=freecols; j<nfcols && *fcptr!=pixel; j++,fcptr++);
       if (j==nfcols) unique++;
 
+      fcr[nfcols] = rdisp[c];  fcg[nfcols] = gdisp[c];  fcb[nfcols] = bdisp[c];
       fc2pcol[nfcols] = c;
       freecols[nfcols++] = pixel;
     }
@@ -464,6 +574,7 @@ static void allocROColors()
 	  rdisp[c] = ctab[close].red   >> 8;
 	  gdisp[c] = ctab[close].green >> 8;
 	  bdisp[c] = ctab[close].blue  >> 8;
+	  fcr[nfcols] = rdisp[c];  fcg[nfcols] = gdisp[c];  fcb[nfcols] = bdisp[c];
 	  fc2pcol[nfcols] = c;
 	  freecols[nfcols++] = cols[c];
 	  p2alloc++;
@@ -526,6 +637,7 @@ static void allocRWColors()
   XColor   defs[256];
 
   rwthistime = 1;
+  freeOldColors();     /* r/w cells can't be shared, so no use for them */
 
   cmap = (LocalCmap) ? LocalCmap : theCmap;
 
@@ -814,6 +926,7 @@ int regroup;
   /* if regroup is set, we *must* do a full realloc, as the cols[] array 
      isn't correct anymore.  (cell groupings changed) */
 
+  AnimSync();
   ApplyECctrls();  /* set {r,g,b}cmap[editColor] based on dial settings */
   Gammify1(editColor);
 
@@ -1490,10 +1603,16 @@ void ChangeCmapMode(cmode, genepic, freeKludge)
 
   if (useroot && (cmode==CM_PERFECT || cmode==CM_OWNCMAP)) cmode=CM_NORMAL;
 
+  AnimSync();
+
   /* free all normal allocated colors, if any */
   if ((pic && freeKludge==1 && noFreeCols==0) ||
       (pic && freeKludge==0)) FreeColors();
 
+  /* if the allocation strategy is changing, the stdcmap code will want
+     the cells, and the new colors aren't going to match the old ones */
+  if (cmode != colorMapMode) freeOldColors();
+
   oldmode = colorMapMode;
   colorMapMode = cmode;
 
@@ -1533,7 +1652,11 @@ void ChangeCmapMode(cmode, genepic, freeKludge)
 
   if (!pic) return;   /* no pic, so don't alloc any colors or anything */
 
+  /* freeKludge==1 is a new picture (see NewPicGetColors()).  It can make
+     do with old colors that are close enough */
+  reuseTol = (freeKludge == 1 && cmode != CM_PERFECT) ? REUSE_TOL : 0;
   AllocColors();
+  reuseTol = 0;
 
   if (cmode == CM_STDCMAP && epicMode == EM_RAW) {  /* turn on dithering */
     epicMode = EM_DITH;
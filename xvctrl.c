@@ -110,7 +110,8 @@ static char *conv24MList[] = { "8-bit mode\t\2448",
 			       MBSEP,
                                "Quick 24->8",
 			       "Slow 24->8",
-			       "Best 24->8" };
+			       "Best 24->8",
+			       "Ordered 24->8" };
 
 static char *algMList[]    = { "Undo All\t\244u",
 			       MBSEP,
@@ -338,6 +338,8 @@ static void doPaste(cimg)
    *   pic is PIC8:   clip is 8, or clip is 24 but has 256 or fewer colors
    */
 
+  StretchKill();     /* pic won't match its deep data (if any) any more */
+
 
 
   if (picType == PIC8) {
@@ -937,6 +939,8 @@ static void clearSelectedArea()
   GetSelRCoords(&x,&y,&w,&h);
   CropRect2Rect(&x,&y,&w,&h, 0,0,pWIDE,pHIGH);
 
+  StretchKill();     /* pic won't match its deep data (if any) any more */
+
   if (picType == PIC24) {
     for (i=y; i<y+h && i<pHIGH; i++) {
       pp = pic + i*pWIDE*3 + x*3;
@@ -16,6 +16,18 @@
  *
  *   InitPoll()             -  called whenever a file is first loaded
  *   CheckPoll(int)         -  checks to see whether we should reload
+ *   PollWatched()          -  is the polled file being watched (inotify)?
+ *
+ *   WatchDir(dir)          -  asks to be told when files in 'dir' change
+ *   UnwatchDir(wd)         -  stops watching it
+ *   WatchFd()              -  fd to select() on, or -1 if nothing's watched
+ *   CheckWatches()         -  handles whatever changes have come in
+ *
+ * If DOINOTIFY is defined, the file being polled and the directories
+ * shown in the schnauzer windows are watched with inotify, and CheckPoll()
+ * only has to stat() the file every so often, in case it's on something
+ * (like NFS) that inotify can't see.  Otherwise, WatchDir() returns -1, and
+ * polling is done with stat() alone, as it always was.
  */
 
 #include "copyright.h"
@@ -31,6 +43,11 @@
 #include <pwd.h>       /* for getpwnam() prototype and passwd struct */
 #endif
 
+#ifdef DOINOTIFY
+#include <sys/inotify.h>
+#include <fcntl.h>
+#endif
+
 
 #define DIRWIDE  350               /* (fixed) size of directory window */
 #define DIRHIGH  400
@@ -48,6 +65,7 @@
 #define COLLABEL "Colors:"         /* label shown next to colMB */
 #define FMTWIDE  150               /* width of fmtMB */
 #define COLWIDE  150               /* width of colMB */
+#define OUTBUFSIZE 65536           /* stdio buffer used by OpenOutFile() */
 
 /* NOTE: make sure these match up with F_* definitions in xv.h */
 static char *saveColors[] = { "Full Color", 
@@ -106,6 +124,7 @@ static char   savepath[MAXPATHLEN+1];   /* '/' terminated */
 static char  *dirs[MAXDEEP];            /* list of directory names */
 static char  *dirMBlist[MAXDEEP];       /* list of dir names in right order */
 static char  *lastdir;                  /* name of the directory we're in */
+static char   outbuf[OUTBUFSIZE];       /* buffer for the output file */
 static char   filename[MAXFNLEN+100];   /* filename being entered */
 static char   deffname[MAXFNLEN+100];   /* default filename */
 
@@ -1055,6 +1074,8 @@ int DoSave()
 
   dbut[S_BOK].lit = 1;  BTRedraw(&dbut[S_BOK]);
 
+  AnimSync();   /* save the frame that's being shown */
+
   fullname = GetDirFullName();
 
   fmt = MBWhich(&fmtMB);
@@ -1644,6 +1665,10 @@ FILE *OpenOutFile(filename)
     return NULL;
   }
 
+  /* the writers mostly do a line or less at a time.  Give them a big 
+     buffer, so the file gets written in large chunks */
+  setvbuf(fp, outbuf, _IOFBF, (size_t) OUTBUFSIZE);
+
   return fp;
 }
   
@@ -1991,6 +2016,19 @@ static struct stat origStat, lastStat;
 static int haveStat = 0, haveLastStat = 0;
 static time_t lastchgtime;
 
+static int  pollWd = -1;             /* watch on the polled file's dir */
+static int  pollHit = 0;             /* it was written or moved into place */
+static char pollName[MAXPATHLEN+1];  /* basename of the polled file */
+
+#ifdef DOINOTIFY
+#define MAXWATCH  (MAXBRWIN + 1)     /* the polled file, and the browsers */
+#define WATCHMASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)
+
+static int inotFd = -1;
+static int nwatch = 0;
+static int watchWd[MAXWATCH], watchRefs[MAXWATCH];
+#endif
+
 /****************************/
 void InitPoll()
 {
@@ -2010,6 +2048,35 @@ void InitPoll()
 			 origStat.st_size, origStat.st_mtime);
     }
   }
+
+  /* watch the directory, rather than the file, so that we hear about
+     files that get replaced by a rename() */
+  if (haveStat) {
+    char  dir[MAXPATHLEN+2], *tmp;
+    int   wd;
+
+    if (namelist[curname][0] == '/' || 
+	strlen(initdir) + strlen(namelist[curname]) + 2 > sizeof(dir))
+      strcpy(dir, "");
+    else sprintf(dir, "%s/", initdir);
+
+    if (strlen(dir) + strlen(namelist[curname]) < sizeof(dir)) {
+      strcat(dir, namelist[curname]);
+      tmp = BaseName(dir);
+      strcpy(pollName, tmp);
+      *tmp = '\0';
+      if (!dir[0]) strcpy(dir, ".");
+
+      wd = WatchDir(dir);
+      UnwatchDir(pollWd);
+      pollWd = wd;
+      pollHit = 0;
+      return;
+    }
+  }
+
+  UnwatchDir(pollWd);
+  pollWd = -1;
 }
 
 
@@ -2024,8 +2091,10 @@ int CheckPoll(del)
 
   struct stat st;
   time_t nowT;
+  int    hit;
 
   time(&nowT);
+  hit = pollHit;  pollHit = 0;
 
   if (haveStat && curname>=0 && curname<numnames &&
       (strcmp(namelist[curname], STDINSTR)!=0)) {
@@ -2037,6 +2106,14 @@ int CheckPoll(del)
       if ((st.st_size  == origStat.st_size) &&
 	  (st.st_mtime == origStat.st_mtime)) return 0;  /* no change */
 
+      /* if whoever wrote it has closed it (or renamed it into place),
+	 it's done.  no need to wait for it to settle down */
+      if (hit && st.st_size > 0) {
+	xvbcopy((char *) &st, (char *) &origStat, sizeof(struct stat));
+	haveLastStat = 0;  lastchgtime = 0;
+	return 1;
+      }
+
       /* if it's changed since last looked ... */
       if (!haveLastStat || 
 	  st.st_size  != lastStat.st_size  ||
@@ -2044,6 +2121,14 @@ int CheckPoll(del)
 	xvbcopy((char *) &st, (char *) &lastStat, sizeof(struct stat));
 	haveLastStat = 1;
 	lastchgtime = nowT;
+
+	/* if it's a PGM/PPM that's still being written, the rows that have
+	   been added can be read in as they arrive.  (see reloadRows()) */
+	if (pollRows >= 0 && st.st_size > origStat.st_size) {
+	  xvbcopy((char *) &st, (char *) &origStat, sizeof(struct stat));
+	  haveLastStat = 0;  lastchgtime = 0;
+	  return 1;
+	}
 	return 0;
       }
 
@@ -2060,6 +2145,134 @@ int CheckPoll(del)
 }
 
 
+/****************************/
+int PollWatched()
+{
+  /* returns '1' if inotify is keeping an eye on the polled file, in which
+     case CheckPoll() needn't be called nearly so often */
+
+  return (pollWd >= 0);
+}
+
+
+/****************************/
+int WatchDir(dir)
+     char *dir;
+{
+  /* starts watching directory 'dir' (if it isn't already being watched)
+     for files being written, renamed, or deleted.  Returns a watch
+     descriptor, or '-1' if it can't be (or isn't being) done */
+
+#ifdef DOINOTIFY
+  int i, wd;
+
+  if (inotFd < 0) {
+    inotFd = inotify_init();
+    if (inotFd < 0) return -1;
+    fcntl(inotFd, F_SETFL, O_NONBLOCK);
+    fcntl(inotFd, F_SETFD, FD_CLOEXEC);
+  }
+
+  wd = inotify_add_watch(inotFd, dir, (unsigned int) WATCHMASK);
+  if (wd < 0) return -1;
+
+  for (i=0; i<nwatch && watchWd[i]!=wd; i++);
+  if (i<nwatch) { watchRefs[i]++;  return wd; }
+
+  if (nwatch == MAXWATCH) {        /* shouldn't happen */
+    inotify_rm_watch(inotFd, wd);
+    return -1;
+  }
+
+  watchWd[nwatch] = wd;  watchRefs[nwatch] = 1;  nwatch++;
+  return wd;
+#else
+  return -1;
+#endif
+}
+
+
+/****************************/
+void UnwatchDir(wd)
+     int wd;
+{
+  /* undoes one WatchDir() call */
+
+#ifdef DOINOTIFY
+  int i;
+
+  if (wd < 0) return;
+
+  for (i=0; i<nwatch && watchWd[i]!=wd; i++);
+  if (i==nwatch || --watchRefs[i] > 0) return;
+
+  inotify_rm_watch(inotFd, wd);
+  for (nwatch--; i<nwatch; i++) {
+    watchWd[i] = watchWd[i+1];  watchRefs[i] = watchRefs[i+1];
+  }
+#endif
+}
+
+
+/****************************/
+int WatchFd()
+{
+  /* returns the fd that becomes readable when a watched directory changes,
+     or '-1' if there's nothing being watched */
+
+#ifdef DOINOTIFY
+  return (nwatch > 0) ? inotFd : -1;
+#else
+  return -1;
+#endif
+}
+
+
+/****************************/
+int CheckWatches()
+{
+  /* reads whatever changes have been reported, and tells the schnauzer
+     about the directories they were in.  Returns '1' if the polled file
+     was one of them, in which case CheckPoll() should be called */
+
+#ifdef DOINOTIFY
+  long    buf[1024];          /* (long, so the events are aligned) */
+  char   *bp;
+  int     i, n, nhit, hits[MAXWATCH];
+  struct inotify_event *ev;
+
+  if (nwatch == 0) return 0;
+
+  nhit = 0;
+  while ((n = read(inotFd, (char *) buf, sizeof(buf))) > 0) {
+    for (bp = (char *) buf;  bp < (char *) buf + n;
+	 bp += sizeof(struct inotify_event) + ev->len) {
+      ev = (struct inotify_event *) bp;
+
+      if (ev->mask & IN_Q_OVERFLOW) {      /* lost some.  assume the worst */
+	pollHit = (pollWd >= 0);
+	for (i=0; i<nwatch; i++) hits[i] = watchWd[i];
+	nhit = nwatch;
+	continue;
+      }
+
+      if (ev->wd == pollWd && ev->len && !strcmp(ev->name, pollName) &&
+	  (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))) pollHit = 1;
+
+      for (i=0; i<nhit && hits[i]!=ev->wd; i++);
+      if (i==nhit && nhit<MAXWATCH) hits[nhit++] = ev->wd;
+    }
+  }
+
+  for (i=0; i<nhit; i++) BRDirChanged(hits[i]);
+
+  return pollHit;
+#else
+  return 0;
+#endif
+}
+
+
 /***************************************************************/
 void DIRDeletedFile(name)
      char *name;
@@ -30,6 +30,10 @@
 #include "bits/blur"
 #include "bits/blurm"
 
+#define FLASH_MS  200      /* how often the selection rectangle 'marches' */
+#define POLL_MS   1000     /* how often CheckPoll() looks at the file */
+#define POLL_SLOW_MS 10000 /* ditto, when inotify is watching it for us */
+
 static int   rotatesLeft = 0;
 static int   origcropx, origcropy, origcropvalid=0;
 static int   canstartwait;
@@ -52,6 +56,10 @@ static void TrackPicValues     PARM((int, int));
 static int  CheckForConfig     PARM((void));
 static Bool IsConfig           PARM((Display *, XEvent *, char *));
 static void onInterrupt        PARM((int));
+static void setDue             PARM((struct timeval *, long));
+static long msUntil            PARM((struct timeval *));
+static long sooner             PARM((long, long));
+static void waitForEvent       PARM((long));
 
 static void   Paint            PARM((void));
 static void   paintPixel       PARM((int, int));
@@ -70,8 +78,10 @@ int EventLoop()
 /****************/
 {
   XEvent event;
-  int    retval,done,waiting;
-  time_t orgtime, curtime;
+  int    retval,done,waiting,watched;
+  long   ms;
+  struct timeval waitdue;
+  static struct timeval flashdue, polldue;
 
 
 #ifndef NOSIGNAL
@@ -104,39 +114,60 @@ int EventLoop()
       /* we wanna wait, we can wait, we haven't started waiting yet, and 
 	 all pending events (ie, drawing the image the first time) 
 	 have been dealt with:  START WAITING */
-      time((time_t *) &orgtime);
+      setDue(&waitdue, waitsec * 1000L);
       waiting = 1;
+
+      /* read in the next picture now, rather than when it's due */
+      PrefetchNextPic();
     }
 
 
     /* if there's an XEvent pending *or* we're not doing anything 
-       in real-time (polling, flashing the selection, etc.) get next event */
-    if ((waitsec==-1 && !polling && !HaveSelection()) || XPending(theDisp)>0) {
+       in real-time (polling, flashing the selection, playing an animation,
+       watching directories, etc.) get next event */
+    if ((waitsec==-1 && !polling && !HaveSelection() && !AnimPlaying() &&
+	 WatchFd()<0) || XPending(theDisp)>0) {
       XNextEvent(theDisp, &event);
       retval = HandleEvent(&event,&done);
     }
 
-    else {                      /* no events.  check wait status */
+    else {
+      /* no events.  do whatever's due, and figure out how long we can
+	 wait for an X event before something else is due.  (-1 = forever) */
+
+      ms = AnimIdle();
+
+      /* see if inotify (if it's being used) has noticed any changes */
+      watched = CheckWatches();
+
       if (HaveSelection()) {
-	DrawSelection(0);
-	DrawSelection(1);
-	XFlush(theDisp);
-	Timer(200);
+	if (msUntil(&flashdue) <= 0) {
+	  DrawSelection(0);
+	  DrawSelection(1);
+	  XFlush(theDisp);
+	  setDue(&flashdue, (long) FLASH_MS);
+	}
+	ms = sooner(ms, msUntil(&flashdue));
       }
 
       if (polling) {
-	if (CheckPoll(2)) return POLLED;
-	else if (!XPending(theDisp)) sleep(1);
+	if (watched || msUntil(&polldue) <= 0) {
+	  if (CheckPoll(2)) return POLLED;
+	  setDue(&polldue, (long) ((PollWatched() && pollRows < 0)
+				    ? POLL_SLOW_MS : POLL_MS));
+	}
+	ms = sooner(ms, msUntil(&polldue));
       }
 
       if (waitsec>-1 && waiting) {
-	time((time_t *) &curtime);
-	if (curtime - orgtime < waitsec) sleep(1);
-	else {
+	if (msUntil(&waitdue) <= 0) {
 	  if (waitloop) return NEXTLOOP;
 	  else return NEXTQUIT;
 	}
+	ms = sooner(ms, msUntil(&waitdue));
       }
+
+      if (ms) waitForEvent(ms);
     }
   }  /* while (!done) */
 
@@ -148,6 +179,78 @@ int EventLoop()
 
 
 
+/****************/
+static void setDue(tv, ms)
+     struct timeval *tv;
+     long   ms;
+{
+  /* sets 'tv' to 'ms' milliseconds from now */
+
+  gettimeofday(tv, (struct timezone *) NULL);
+  tv->tv_sec  += ms / 1000L;
+  tv->tv_usec += (ms % 1000L) * 1000L;
+  if (tv->tv_usec >= 1000000L) { tv->tv_sec++;  tv->tv_usec -= 1000000L; }
+}
+
+
+/****************/
+static long msUntil(tv)
+     struct timeval *tv;
+{
+  /* returns # of milliseconds (rounded up) until 'tv', or <= 0 if it's
+     already gone by */
+
+  struct timeval now;
+  long   us;
+
+  gettimeofday(&now, (struct timezone *) NULL);
+  us = (tv->tv_sec - now.tv_sec) * 1000000L + (tv->tv_usec - now.tv_usec);
+  return (us > 0) ? (us + 999L) / 1000L : 0L;
+}
+
+
+/****************/
+static long sooner(ms1, ms2)
+     long ms1, ms2;
+{
+  /* the shorter of two waits, where -1 means 'forever' */
+
+  if (ms1 < 0) return ms2;
+  if (ms2 < 0) return ms1;
+  return (ms1 < ms2) ? ms1 : ms2;
+}
+
+
+/****************/
+static void waitForEvent(ms)
+     long ms;
+{
+  /* waits until an X event arrives, a watched directory changes, or 'ms'
+     milliseconds have gone by (forever, if 'ms' is -1) */
+
+#ifdef VMS
+  Timer((ms < 0 || ms > 50) ? 50 : (int) ms);
+#else
+  struct timeval tv;
+  fd_set fds;
+  int    fd, wfd;
+
+  fd  = ConnectionNumber(theDisp);
+  wfd = WatchFd();
+  FD_ZERO(&fds);
+  FD_SET(fd, &fds);
+  if (wfd >= 0) FD_SET(wfd, &fds);
+  if (wfd > fd) fd = wfd;
+
+  tv.tv_sec  = ms / 1000L;
+  tv.tv_usec = (ms % 1000L) * 1000L;
+  select(fd+1, XV_FDTYPE &fds, XV_FDTYPE NULL, XV_FDTYPE NULL,
+	 (ms < 0) ? (struct timeval *) NULL : &tv);
+#endif
+}
+
+
+
 /****************/
 int HandleEvent(event, donep)
      XEvent *event;
@@ -853,9 +956,9 @@ void Select24to8MB(i)
     conv24MB.flags[i] = !conv24MB.flags[i];
   }
   
-  else if (i>=CONV24_FAST && i<=CONV24_BEST) {
+  else if (i>=CONV24_FAST && i<=CONV24_ORDER) {
     conv24 = i;
-    for (i=CONV24_FAST; i<=CONV24_BEST; i++) {
+    for (i=CONV24_FAST; i<=CONV24_ORDER; i++) {
       conv24MB.flags[i] = (i==conv24);
     }
   }
@@ -1148,6 +1251,10 @@ static void handleButtonEvent(event, donep, retvalp)
     
     if (viewonly) break;     /* ignore all other button presses */
     
+    /* clicks in the image and control windows work on 'pic'.  If an
+       animation frame came out of the cache, 'pic' doesn't have it yet */
+    if (win == mainW || win == ctrlW) AnimSync();
+
     if (win == mainW && !useroot && showzoomcursor) {
       DoZoom(x, y, but_event->button);
       break;
@@ -1397,29 +1504,62 @@ static void handleKeyEvent(event, donep, retvalp)
 
     /* check for pageup/pagedown, 'p' in main window 
        (you can use shift-up or shift-down if no crop rectangle drawn)
-       (for viewing multipage docs) */
+       (for viewing multipage docs, and stepping through animations.
+       'l' pauses/resumes animations) */
 
     if (key_event->window == mainW) {
       dealt = 1;
 
       ck = CursorKey(ks, shift, 0);
       if (ck==CK_PAGEUP || (ck==CK_UP && shift && !but[BCROP].active)) {
-	if (strlen(pageBaseName) && numPages>1) {
+	if ((strlen(pageBaseName) || pageSrc) && numPages>1) {
 	  done = 1;  retval = OP_PAGEUP;
 	}
+	else if (AnimActive()) AnimStep(-1);
 	else XBell(theDisp,0);
       }
 
       else if (ck==CK_PAGEDOWN || 
 	       (ck==CK_DOWN && shift && !but[BCROP].active)) {
-	if (strlen(pageBaseName) && numPages>1) {
+	if ((strlen(pageBaseName) || pageSrc) && numPages>1) {
 	  done = 1;  retval = OP_PAGEDN;
 	}
+	else if (AnimActive()) AnimStep(1);
 	else XBell(theDisp,0);
       }
 
+      else if (buf[0] == 'l' && stlen>0) {
+	if (AnimActive()) AnimToggle();
+	else XBell(theDisp, 0);
+      }
+
+      else if (buf[0] == 'p' && stlen>0 && AnimActive() &&
+	       !((strlen(pageBaseName) || pageSrc) && numPages>1)) {
+	int  i,j, okay;
+	char buf[64], txt[512];
+	static char *labels[] = { "\nOk", "\033Cancel" };
+
+	/* ask what frame to go to */
+	sprintf(txt, "Go to frame number...   (1-%d)", AnimNumFrames());
+	sprintf(buf, "%d", AnimCurFrame() + 1);
+
+	okay = 0;
+	do {
+	  i = GetStrPopUp(txt, labels, 2, buf, 64, "0123456789", 1);
+	  if (!i && strlen(buf) > (size_t) 0) {
+	    j = atoi(buf);
+	    if (j>=1 && j<=AnimNumFrames()) {
+	      AnimGoto(j-1);
+	      okay=1;
+	    }
+	    else XBell(theDisp, 0);
+	  }
+	  else okay = 1;
+	} while (!okay);
+      }
+
       else if (buf[0] == 'p' && stlen>0) {
-	if (strlen(pageBaseName) && numPages>1) {
+	if ((strlen(pageBaseName) || pageSrc) && numPages>1) {
 	  int  i,j, okay;
 	  char buf[64], txt[512];
 	  static char *labels[] = { "\nOk", "\033Cancel" };
@@ -1456,6 +1596,11 @@ static void handleKeyEvent(event, donep, retvalp)
 	
 
 
+    /* the rest of the keys (crop rect, algorithms, etc.) work on 'pic',
+       so it had better hold the frame being shown */
+    if (key_event->window == mainW || key_event->window == ctrlW) AnimSync();
+
+
     /* check for crop rect keys */
     if (key_event->window == mainW) {
       dealt = 1;
@@ -1640,6 +1785,12 @@ static void handleKeyEvent(event, donep, retvalp)
       case 'R':    FakeButtonPress(&gbut[G_BRESET]);   break;
       case 'H':    FakeButtonPress(&gbut[G_BHISTEQ]);  break;
       case 'N':    FakeButtonPress(&gbut[G_BMAXCONT]); break;
+
+	/* stretch of deep (FITS, PDS) data.  See xvstretch.c */
+      case 'k':
+      case 'K':    if (StretchActive()) StretchStep((buf[0]=='k') ? 1 : -1);
+	           else XBell(theDisp, 0);
+	           break;
 	
       default:     break;
       }
@@ -1847,6 +1998,23 @@ void DrawWindow(x,y,w,h)
   if (x+w < eWIDE) w++;  /* add one for broken servers (?) */
   if (y+h < eHIGH) h++;
 
+  if (theImage && !XImageFilled()) {
+    /* theImage gets dithered as it's drawn.  Only bother with the part of
+       the window that's on the screen.  The rest will get Expose events if
+       it's ever moved into view */
+    int    rx, ry;
+    Window child;
+
+    XTranslateCoordinates(theDisp, mainW, rootW, 0, 0, &rx, &ry, &child);
+    if (x < -rx) { w -= -rx - x;  x = -rx; }
+    if (y < -ry) { h -= -ry - y;  y = -ry; }
+    if (x+w > dispWIDE-rx) w = dispWIDE-rx - x;
+    if (y+h > dispHIGH-ry) h = dispHIGH-ry - y;
+    if (w<1 || h<1) return;
+
+    FillXImage(x,y,w,h);
+  }
+
   if (theImage)
     XPutImage(theDisp,mainW,theGC,theImage,x,y,x,y, (u_int) w, (u_int) h);
   else 
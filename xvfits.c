@@ -38,17 +38,21 @@ typedef struct {
 /* block workspace of BLOCKSIZE bytes */
 static char *fits_block=NULL;
 
+static int   dblHi;     /* which half of a double is the high-order one */
 
-static int   splitfits  PARM((byte *, char *, int, int, int, char *));
-static char *ftopen3d   PARM((FITS *, char *, int *, int *, int *, int *));
-static void  ftclose    PARM((FITS *));
-static int   ftgbyte    PARM((FITS *, byte *, int));
+
+static int   loadPlane  PARM((FILE *, PICINFO *, int, int *));
+static int   fitsPage   PARM((PAGESRC *, int, PICINFO *));
+static void  fitsFree   PARM((PAGESRC *));
+static char *ftinit     PARM((FITS *, FILE *, int *, int *, int *, int *));
+static int   ftgdeep    PARM((FITS *, DEEPPIC *, int));
 static char *rdheader   PARM((FITS *));
 static char *wrheader   PARM((FILE *, int, int, char *));
 static char *rdcard     PARM((char *, char *, DATTYPE, long int *));
 static void  wrcard     PARM((char *, char *, DATTYPE, int, char *));
 static int   ftgdata    PARM((FITS *, void *, int));
 static void  ftfixdata  PARM((FITS *, void *, int));
+static int   hostIEEE   PARM((void));
 static void  flip       PARM((byte *, int, int));
 
 
@@ -62,37 +66,100 @@ int LoadFITS(fname, pinfo, quick)
 {
   /* returns '1' on success */
 
-  FITS  fs;
-  int   i, nx, ny, nz, bitpix, np, nrd, ioerror;
-  byte *image;
-  char *error;
-  char  basename[64];
+  FILE    *fp;
+  PAGESRC *ps;
+  int      nz;
 
   if (fits_block == NULL) {
     fits_block = (char *) malloc((size_t) BLOCKSIZE);
     if (!fits_block) FatalError("Insufficient memory for FITS block buffer");
   }
   
-  error = ftopen3d(&fs, fname, &nx, &ny, &nz, &bitpix);
+  fp = xv_fopen(fname, "r");
+  if (!fp) {
+    SetISTR(ISTR_WARNING, "%s", "Unable to open FITS file");
+    return 0;
+  }
+
+  if (!loadPlane(fp, pinfo, 0, &nz)) {
+    fclose(fp);
+    return 0;
+  }
+
+  /* For three dimensional images, the other planes are read straight out
+   * of the file when they're asked for (see fitsPage()).  The file is kept
+   * open, as 'fname' may well be a temporary file that's about to be
+   * deleted.
+   */
+
+  if (nz > 1 && !quick) {
+    ps = (PAGESRC *) malloc(sizeof(PAGESRC));
+    if (!ps) FatalError("Insufficient memory for FITS page source");
+
+    ps->npages = nz;
+    ps->load   = fitsPage;
+    ps->free   = fitsFree;
+    ps->data   = (char *) fp;
+    pinfo->pages = ps;
+  }
+  else fclose(fp);
+  
+  return 1;
+}  
+
+
+/*******************************************/
+static int loadPlane(fp, pinfo, plane, nzp)
+     FILE    *fp;
+     PICINFO *pinfo;
+     int      plane, *nzp;
+{
+  /* loads plane #plane of the FITS file open on 'fp' into pinfo.  
+     Returns '1' on success, and the # of planes in the file in nzp */
+
+  FITS     fs;
+  DEEPPIC *dp;
+  int      i, nx, ny, nz, bitpix, np, nrd, ioerror;
+  long     dataoff, planesize, nhave;
+  byte    *image;
+  char    *error;
+
+  error = ftinit(&fs, fp, &nx, &ny, &nz, &bitpix);
   if (error) {
     SetISTR(ISTR_WARNING, "%s", error);
     return 0;
   }
 
-  if (quick) nz = 1;             /* only load first plane */
-  np = nx * ny * nz;
+  /* how many planes do we actually have? */
+  np        = nx * ny;
+  planesize = (long) np * fs.size;
+  dataoff   = ftell(fp);
+  fseek(fp, 0L, 2);
+  nhave = (ftell(fp) - dataoff + planesize - 1) / planesize;
+  if (nhave < nz) nz = (nhave > 0) ? nhave : 1;
+  if (plane >= nz) plane = nz - 1;
+
+  fseek(fp, dataoff + plane * planesize, 0);
+  fs.cpos = (long) plane * np;
 
   image = (byte *) malloc((size_t) np);
   if (!image) FatalError("Insufficient memory for image");
 
-  /*
-   * Read in image. For three dimensional images, read it in in one go
-   * to ensure that we get that same scaling for all planes.
+  /* Byte data is loaded as stored in the file.  Anything deeper is read
+   * into a DEEPPIC, which is then stretched (see xvstretch.c) to make the
+   * image.  Each plane is stretched on its own, rather than reading the
+   * whole cube in first, to get the same stretch for all planes.
    */
 
-  nrd     = ftgbyte(&fs, image, np);
-  ioerror = ferror(fs.fp);
-  ftclose(&fs);
+  dp = (DEEPPIC *) NULL;
+  if (bitpix == 8) 
+    nrd = ftgdata(&fs, image, np);
+  else {
+    dp = DeepAlloc(nx, ny, 1);
+    if (!dp) FatalError("Insufficient memory for image");
+    nrd = ftgdeep(&fs, dp, np);
+  }
+  ioerror = ferror(fp);
 
   if (nrd == 0) {  /* didn't read any data at all */
     if (ioerror)
@@ -101,6 +168,8 @@ int LoadFITS(fname, pinfo, quick)
       SetISTR(ISTR_WARNING, "%s", "Unexpected EOF reading FITS file");
 
     free(image);
+    DeepFree(dp);
+    if (fs.comment) free(fs.comment);
     return 0;
   }
 
@@ -110,48 +179,68 @@ int LoadFITS(fname, pinfo, quick)
     else
       SetISTR(ISTR_WARNING, "%s", "Truncated FITS file");
     
-    { byte *foo;
-      for (foo=image+nrd; foo<image+np; foo++) *foo=0x80;  /* pad with grey */
+    /* pad with grey */
+    for (i=nrd; i<np; i++) {
+      if (dp) dp->data[i] = dp->nlevels / 2;
+         else image[i] = 0x80;
     }
   }
 
-  if (nz > 1) {
-    /* how many planes do we actually have? */
-    nz = (nrd-1)/(nx*ny) + 1;
-
-    /* returns how many sub-files created */
-    nz = splitfits(image, fs.comment, nx, ny, nz, basename);
-    np = nx * ny;
-    image = (byte *)realloc(image, (size_t) np);  /* toss all but first */
-  }
-  
   /* There seems to be a convention that fits files be displayed using
    * a cartesian coordinate system. Thus the first pixel is in the lower left
    * corner. Fix this by reflecting in the line y=ny/2.
    */
-  flip(image, nx, ny);
+  if (dp) {
+    flip((byte *) dp->data, nx * (int) sizeof(unsigned short), ny);
+    DeepStretch(dp, stretchMode, image);
+  }
+  else flip(image, nx, ny);
   
   /* Success! */
   pinfo->pic  = image;
   pinfo->type = PIC8;
   pinfo->w    = pinfo->normw = nx;
   pinfo->h    = pinfo->normh = ny;
+  pinfo->deep = dp;
 
   for (i=0; i < 256; i++) pinfo->r[i] = pinfo->g[i] = pinfo->b[i] = i;
   pinfo->frmType = F_FITS;
   pinfo->colType = F_GREYSCALE;
 
   sprintf(pinfo->fullInfo, "FITS, bitpix: %d", bitpix);
+  if (dp) sprintf(pinfo->fullInfo + strlen(pinfo->fullInfo),
+		  ", data %.6g to %.6g", dp->min, dp->max);
+  if (nz > 1) sprintf(pinfo->fullInfo + strlen(pinfo->fullInfo), 
+		      ", plane %d of %d", plane+1, nz);
   sprintf(pinfo->shrtInfo, "%dx%d FITS.", nx, ny);
   pinfo->comment = fs.comment;
 
-  if (nz > 1) {
-    pinfo->numpages = nz;
-    strcpy(pinfo->pagebname, basename);
-  }
-  
+  *nzp = nz;
   return 1;
-}  
+}
+
+
+/*******************************************/
+static int fitsPage(ps, n, pinfo)
+     PAGESRC *ps;
+     int      n;
+     PICINFO *pinfo;
+{
+  /* the PAGESRC 'load' function:  loads plane #n */
+
+  int nz;
+
+  return loadPlane((FILE *) ps->data, pinfo, n, &nz);
+}
+
+
+/*******************************************/
+static void fitsFree(ps)
+     PAGESRC *ps;
+{
+  fclose((FILE *) ps->data);
+  free(ps);
+}
 
 
 	  
@@ -180,110 +269,45 @@ int WriteFITS(fp,pic,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle,comment)
     return -1;
   }
 
+  /* the pixels are packed into fits_block, which is written out each time 
+     it fills up.  The last block is padded out with zeros */
+
   if (ptype == PIC8) {
     /* If ptype is PIC8, we need to calculate the greyscale colourmap */
     for (i=0; i < numcols; i++) rgb[i] = MONO(rmap[i], gmap[i], bmap[i]);
-
-    for (i=h-1; i >= 0; i--) {     /* flip line ordering when writing out */
-      ptr = &pic[i*w];
-      for (j=0; j < w; j++, ptr++) putc(rgb[*ptr], fp);
-    }
   }
 
-  else {  /* PIC24 */
-    for (i=h-1; i >= 0; i--) {     /* flip line ordering when writing out */
-      ptr = &pic[i*w*3];
-      for (j=0; j < w; j++, ptr += 3) putc(MONO(ptr[0], ptr[1], ptr[2]), fp);
-    }
-  }
-
-  np = w*h;
-
-  /* nend is the number of padding characters at the end of the last block */
-  nend = ((np+BLOCKSIZE-1)/BLOCKSIZE)*BLOCKSIZE - np;
-  if (nend) for (i=0; i<nend; i++) putc('\0', fp);
-  
-  return 0;
-}
-
+  for (i=h-1, np=0; i >= 0; i--) {     /* flip line ordering when writing out */
+    if ((i&63)==0) WaitCursor();
 
+    if (ptype == PIC8) ptr = &pic[i*w];
+                  else ptr = &pic[i*w*3];
 
-/************************************/
-static int splitfits(image, comment, nx, ny, nz, basename)
-     byte *image;
-     char *comment;
-     int   nx, ny, nz;
-     char *basename;
-{
-  /*
-   * Given a 3 dimensional FITS image, this splits it up into nz 2-d files.
-   * It returns the number of files actually stored.
-   * If only one file could be written, then no split files are created.
-   * It returns the basename of the split files in bname.
-   * If there was a problem writing files, then a error message will be set.
-   */
-  
-  int   i, np=nx * ny, ioerror, nwrt;
-  FILE *fp;
-  char *error;
-  byte *work;
-  char  filename[70];
-
-#ifndef VMS
-  sprintf(basename, "%s/xvpgXXXXXX", tmpdir);
-#else
-  sprintf(basename, "Sys$Disk:[]xvpgXXXXXX");
-#endif
-  
-  mktemp(basename);
-  if (basename[0] == '\0') {
-    SetISTR(ISTR_WARNING, "%s", "Unable to build temporary filename");
-    return 1;
-  }
-
-  strcat(basename, ".");
-  error = NULL;
+    for (j=0; j < w; j++) {
+      if (ptype == PIC8) { fits_block[np++] = rgb[*ptr];  ptr++; }
+      else { fits_block[np++] = MONO(ptr[0], ptr[1], ptr[2]);  ptr += 3; }
 
-  for (i=0; i < nz && !error; i++) {
-    sprintf(filename, "%s%d", basename, i+1);
-    fp = xv_fopen(filename, "w");
-    if (!fp) {
-      error = "Unable to open temporary file";
-      break;
-    }
-    
-    if (wrheader(fp, nx, ny, comment)) {
-      error = "I/O error writing temporary file";
-      fclose(fp);
-      unlink(filename);
-      break;
+      if (np == BLOCKSIZE) {
+	if (fwrite(fits_block, (size_t) 1, (size_t) BLOCKSIZE, fp) != BLOCKSIZE)
+	  return -1;
+	np = 0;
+      }
     }
-
-    nwrt = fwrite(image+i*np, sizeof(byte), (size_t) np, fp);
-    fclose(fp);
-
-    if (nwrt == 0) {  /* failed to write any data */
-      error = "I/O error writing temporary file";
-      unlink(filename);
-      break;
-    } 
-    else if (nwrt < np)
-      error = "I/O error writing temporary file";
   }
 
-
-  /* at this point, i is the number of files created */
-  if (i == 0) return 1;
-  if (i == 1) {
-    sprintf(filename, "%s1", basename);
-    unlink(filename);
+  /* nend is the number of padding characters at the end of the last block */
+  if (np) {
+    nend = BLOCKSIZE - np;
+    xvbzero(fits_block + np, (size_t) nend);
+    if (fwrite(fits_block, (size_t) 1, (size_t) BLOCKSIZE, fp) != BLOCKSIZE)
+      return -1;
   }
-
-  if (error) SetISTR(ISTR_WARNING, "%s", error);
-  return i;
+  
+  return 0;
 }
 
 
+
 /************************************/
 static char *wrheader(fp, nx, ny, comment)
      FILE *fp;
@@ -346,37 +370,31 @@ static char *wrheader(fp, nx, ny, comment)
 
 
 /************************************/
-static char *ftopen3d(fs, file, nx, ny, nz, bitpix)
+static char *ftinit(fs, fp, nx, ny, nz, bitpix)
      FITS *fs;
-     char *file;
+     FILE *fp;
      int  *nx, *ny, *nz, *bitpix;
 {
-  /* open a 2 or 3-dimensional fits file.
+  /* reads the header of the 2 or 3-dimensional fits file open on 'fp'.
    * Stores the dimensions of the file in nx, ny and nz, and updates the FITS
-   * structure passed in fs.
+   * structure passed in fs.  On return, fp is at the start of the data.
    * If successful, returns NULL otherwise returns an error message.
    * Will return an error message if the primary data unit is not a
    * 2 or 3-dimensional array.
    */
   
-  FILE *fp;
   int naxis, i;
   char *error;
   
-  fp = xv_fopen(file, "r");
-  if (!fp) return "Unable to open FITS file";
-  
   fs->fp     = fp;
   fs->bitpix = 0;
   fs->naxis  = 0;
   fs->cpos   = 0;
   
   /* read header */
+  rewind(fp);
   error = rdheader(fs);
-  if (error) {
-    ftclose(fs);
-    return error;
-  }
+  if (error) return error;
   
   naxis = fs->naxis;
   
@@ -396,15 +414,6 @@ static char *ftopen3d(fs, file, nx, ny, nz, bitpix)
 }
 
 
-/************************************/
-static void ftclose(fs)
-     FITS *fs;
-{
-  if (fs == NULL) return;
-  if (fs->fp != NULL) fclose(fs->fp);
-}
-
-
 /************************************/
 static char *rdheader(fs)
      FITS *fs;
@@ -742,11 +751,23 @@ static void ftfixdata(fs, buffer, nelem)
 	      ((unsigned int)ptr[3]);
   }
   
-  /* convert from IEE 754 single precision to native form */
+  /* convert from IEE 754 single precision to native form.  If the host's
+     floats are IEEE too, it's just a matter of putting the bytes in the
+     right order */
   else if (fs->bitpix == -32) {
     int j, k, expo;
     static float *exps=NULL;
-    
+    union { float f;  unsigned int i; } fu;
+
+    if (hostIEEE()) {
+      for (i=0; i < n; i++, ptr+=4) {
+	fu.i = ((unsigned int)ptr[0] << 24) | ((unsigned int)ptr[1] << 16) |
+	       ((unsigned int)ptr[2] << 8)  |  (unsigned int)ptr[3];
+	*(float *)ptr = fu.f;
+      }
+      return;
+    }
+
     if (exps == NULL) {
       exps = (float *)malloc(256 * sizeof(float));
       if (exps == NULL) FatalError("Insufficient memory for exps store");
@@ -771,7 +792,21 @@ static void ftfixdata(fs, buffer, nelem)
     int expo, k, l;
     unsigned int j;
     static double *exps=NULL;
-    
+    union { double d;  unsigned int i[2]; } du;
+
+    if (hostIEEE()) {
+      for (i=0; i < n; i++, ptr+=8) {
+	du.i[dblHi]   = ((unsigned int)ptr[0] << 24) |
+	                ((unsigned int)ptr[1] << 16) |
+	                ((unsigned int)ptr[2] << 8)  |  (unsigned int)ptr[3];
+	du.i[1-dblHi] = ((unsigned int)ptr[4] << 24) |
+	                ((unsigned int)ptr[5] << 16) |
+	                ((unsigned int)ptr[6] << 8)  |  (unsigned int)ptr[7];
+	*(double *)ptr = du.d;
+      }
+      return;
+    }
+
     if (exps == NULL) {
       exps = (double *)malloc(2048 * sizeof(double));
       if (exps == NULL) FatalError("Insufficient memory for exps store");
@@ -794,122 +829,185 @@ static void ftfixdata(fs, buffer, nelem)
   }
 }
 
-#define maxmin(x, max, min) {\
-  maxmin_t=(x);  if(maxmin_t > max) max=maxmin_t; \
-  if (maxmin_t<min) min=maxmin_t;}
-
 
 /************************************/
-static int ftgbyte(fs, cbuff, nelem)
-     FITS *fs;
-     byte *cbuff;
-     int nelem;
+static int hostIEEE()
+{
+  /* returns '1' if this machine's floats and doubles are IEEE 754 ones,
+     in which case dblHi is set to the index of the high-order half of a
+     double, when it's looked at as a pair of unsigned ints */
+
+  static int ieee = -1;
+  union { float f;  unsigned int i; }    fu;
+  union { double d; unsigned int i[2]; } du;
+
+  if (ieee >= 0) return ieee;
+
+  ieee = 0;
+  if (sizeof(float) != 4 || sizeof(double) != 8 || sizeof(unsigned int) != 4)
+    return ieee;
+
+  fu.f = 1.5;   du.d = 1.5;
+  if (fu.i == 0x3fc00000) {
+    if      (du.i[0] == 0x3ff80000 && du.i[1] == 0) { ieee = 1;  dblHi = 0; }
+    else if (du.i[1] == 0x3ff80000 && du.i[0] == 0) { ieee = 1;  dblHi = 1; }
+  }
+
+  return ieee;
+}
+
+
+/* is x a number?  (as opposed to a NaN, or an infinity) */
+#define FINITE(x) ((x) == (x) && (x) - (x) == 0)
+
+
+static int ftgdeep(fs, dp, nelem)
+     FITS    *fs;
+     DEEPPIC *dp;
+     int      nelem;
 {
-  /* Reads a byte image from the FITS file fs. The image contains nelem pixels.
-   * If bitpix = 8, then the image is loaded as stored in the file.
-   * Otherwise, it is rescaled so that the minimum value is stored as 0, and
-   * the maximum is stored as 255.
+  /* Reads an image of nelem pixels from the FITS file fs into dp, which must
+   * have room for them.  Used when bitpix isn't 8.  The values are turned
+   * into levels, from 0 for the minimum value, to at most DEEPLEVELS-1 for
+   * the maximum, and counted in dp's histogram as they go.  Floating point
+   * NaNs and infinities are given level 0, but don't count towards the
+   * minimum and maximum, nor go in the histogram.
    * Returns the number of pixels read.
    */
 
   void *voidbuff;
-  int i, n, nrd;
+  unsigned short *lev;
+  long *hist;
+  int i, n;
 
-  /* if the data is byte, then read it directly */
-  if (fs->bitpix == 8)
-    return ftgdata(fs, cbuff, nelem);
-  
-  /* allocate a buffer to store the image */
+  lev  = dp->data;
+  hist = dp->hist;
+
+  /* 16 bit data is read straight into dp, and converted in place */
   if (fs->bitpix == 16)
-    voidbuff = (void *)malloc(nelem * sizeof(short int));
-  else if (fs->bitpix == 32)
-    voidbuff = (void *)malloc(nelem * sizeof(int));
-  else
-    voidbuff = (void *)malloc(nelem * (size_t) fs->size);  /* float, double */
-
-  if (voidbuff == NULL) {
-    char emess[60];
-    sprintf(emess, "Insufficient memory for raw image of %d bytes", 
-	    nelem*fs->size);
-    FatalError(emess);
+    voidbuff = (void *) dp->data;
+  else {
+    voidbuff = (void *)malloc(nelem * (size_t) fs->size);
+    if (voidbuff == NULL) {
+      char emess[60];
+      sprintf(emess, "Insufficient memory for raw image of %d bytes", 
+	      nelem*fs->size);
+      FatalError(emess);
+    }
   }
 
-  nrd = ftgdata(fs, voidbuff, nelem);
-  if (nrd == 0) return 0;
-  n = nrd;
+  n = ftgdata(fs, voidbuff, nelem);
+  if (n == 0) {
+    if (voidbuff != (void *) dp->data) free(voidbuff);
+    return 0;
+  }
 
-  /* convert short int to byte */
+  /* short int: one level per value between min and max */
   if (fs->bitpix == 16) {
     short int *buffer=voidbuff;
-    int max, min, maxmin_t;
-    float scale;
+    int max, min;
     
     min = max = buffer[0];
-    for (i=1; i < n; i++, buffer++) maxmin(*buffer, max, min);
-    scale = (max == min) ? 0. : 255./(float)(max-min);
-    
-    /* rescale and convert */
-    for (i=0, buffer=voidbuff; i < n; i++)
-      cbuff[i] = (byte)(scale*(float)((int)buffer[i]-min));
-    
-    /* convert long int to byte */
+    for (i=1; i < n; i++) {
+      if (buffer[i] > max) max = buffer[i];
+      if (buffer[i] < min) min = buffer[i];
+    }
+
+    for (i=0; i < n; i++) {
+      lev[i] = (int) buffer[i] - min;
+      hist[lev[i]]++;
+    }
+    dp->nlevels = max - min + 1;
+    dp->min = min;  dp->max = max;
   } 
 
+  /* long int: the same, unless there are too many values */
   else if (fs->bitpix == 32) {
     int *buffer=voidbuff;
-    int max, min, maxmin_t;
-    float scale, fmin;
+    int max, min;
+    double range, scale;
     
     min = max = buffer[0];
-    for (i=1; i < n; i++, buffer++) maxmin(*buffer, max, min);
-    scale = (max == min) ? 1. : 255./((double)max-(double)min);
-    fmin = (float)min;
-    
-    /* rescale and convert */
-    if (scale < 255./2.1e9) /* is max-min too big for an int ? */
-      for (i=0, buffer=voidbuff; i < n; i++)
-	cbuff[i] = (byte)(scale*((float)buffer[i]-fmin));
-    else /* use integer subtraction */
-      for (i=0, buffer=voidbuff; i < n; i++)
-	cbuff[i] = (byte)(scale*(float)(buffer[i]-min));
-    
-   
+    for (i=1; i < n; i++) {
+      if (buffer[i] > max) max = buffer[i];
+      if (buffer[i] < min) min = buffer[i];
+    }
+    range = (double) max - (double) min;
+
+    if (range < DEEPLEVELS) {
+      for (i=0; i < n; i++) {
+	lev[i] = buffer[i] - min;
+	hist[lev[i]]++;
+      }
+      dp->nlevels = (int) range + 1;
+    }
+    else {
+      scale = (DEEPLEVELS - 1) / range;
+      for (i=0; i < n; i++) {
+	lev[i] = (int) (scale * ((double) buffer[i] - (double) min));
+	hist[lev[i]]++;
+      }
+      dp->nlevels = DEEPLEVELS;
+    }
+    dp->min = min;  dp->max = max;
   } 
 
-  /* convert float to byte */
+  /* float */
   else if (fs->bitpix == -32) {
     float *buffer=voidbuff;
-    float max, min, maxmin_t, scale;
+    float max, min;
+    double scale;
     
-    min = max = buffer[0];
-    for (i=1; i < n; i++, buffer++) maxmin(*buffer, max, min);
-    scale = (max == min) ? 0. : 255./(max-min);
-    
-    /* rescale and convert */
-    for (i=0, buffer=voidbuff; i < n; i++)
-      cbuff[i] = (byte)(scale*(buffer[i]-min));
+    for (i=0; i < n && !FINITE(buffer[i]); i++);
+    min = max = (i < n) ? buffer[i] : 0.;
+    for ( ; i < n; i++) {
+      if (!FINITE(buffer[i])) continue;
+      if (buffer[i] > max) max = buffer[i];
+      if (buffer[i] < min) min = buffer[i];
+    }
+    dp->nlevels = (max > min) ? DEEPLEVELS : 1;
+    scale = (max > min) ? (DEEPLEVELS - 1) / ((double) max - min) : 0.;
     
+    for (i=0; i < n; i++) {
+      if (!FINITE(buffer[i])) lev[i] = 0;
+      else {
+	lev[i] = (int) (scale * ((double) buffer[i] - min));
+	hist[lev[i]]++;
+      }
+    }
+    dp->min = min;  dp->max = max;
   } 
 
-  /* convert double to byte */
+  /* double */
   else if (fs->bitpix == -64) {
     double *buffer=voidbuff;
-    double max, min, maxmin_t, scale;
+    double max, min, scale;
     
-    min = max = buffer[0];
-    for (i=1; i < n; i++, buffer++) maxmin(*buffer, max, min);
-    scale = (max == min) ? 0. : 255./(max-min);
+    for (i=0; i < n && !FINITE(buffer[i]); i++);
+    min = max = (i < n) ? buffer[i] : 0.;
+    for ( ; i < n; i++) {
+      if (!FINITE(buffer[i])) continue;
+      if (buffer[i] > max) max = buffer[i];
+      if (buffer[i] < min) min = buffer[i];
+    }
+    dp->nlevels = (max > min) ? DEEPLEVELS : 1;
+    scale = (max > min) ? (DEEPLEVELS - 1) / (max - min) : 0.;
     
-    /* rescale and convert */
-    for (i=0, buffer=voidbuff; i < n; i++)
-      cbuff[i] = (byte)(scale*(buffer[i]-min));
+    for (i=0; i < n; i++) {
+      if (!FINITE(buffer[i])) lev[i] = 0;
+      else {
+	lev[i] = (int) (scale * (buffer[i] - min));
+	hist[lev[i]]++;
+      }
+    }
+    dp->min = min;  dp->max = max;
   }
 
-  free(voidbuff);
+  if (voidbuff != (void *) dp->data) free(voidbuff);
   return n;
 }
 
-#undef maxmin
+#undef FINITE
 
 
 /************************************/
@@ -918,7 +1016,7 @@ static void flip(buffer, nx, ny)
      int nx;
      int ny;
 {
-  /* reverse order of lines in image */
+  /* reverse order of lines in image (of ny lines of nx bytes each) */
 
   int i;
   int j, v;
@@ -1605,6 +1605,8 @@ static void applyGamma(cmapchange)
 
   if (!pic || !epic) return;   /* called before image exists.  ignore */
 
+  AnimSync();
+
   if (picType == PIC8) {
     /* save current 'desired' colormap */
     xvbcopy((char *) rMap, (char *) oldr, (size_t) numcols);
@@ -1762,7 +1764,10 @@ void DoHistEq()
 {
   int i, histeq[256], minv, maxv;
 
-  calcHistEQ(histeq, &minv, &maxv);  /* ignore minv,maxv */
+  if (StretchSet(STR_HISTEQ, 1))     /* done with all the bits.  no curve */
+    for (i=0; i<256; i++) histeq[i] = i;
+  else
+    calcHistEQ(histeq, &minv, &maxv);  /* ignore minv,maxv */
     
   for (i=0; i<256; i++) 
     intGraf.func[i] = histeq[i];
@@ -1789,7 +1794,10 @@ void DoNorm()
 
   minv = 255;  maxv = 0;
 
-  if (picType == PIC8) {
+  if (StretchSet(STR_NORM, 1)) {     /* done with all the bits.  no curve */
+    minv = 0;  maxv = 255;
+  }
+  else if (picType == PIC8) {
     for (i=0; i<numcols; i++) {
       v = MONO(rcmap[i],gcmap[i],bcmap[i]);
       if (v<minv) minv = v;
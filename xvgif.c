@@ -38,27 +38,23 @@ typedef int boolean;
 
 FILE *fp;
 
-int BitOffset = 0,		/* Bit Offset of next code */
-    XC = 0, YC = 0,		/* Output X and Y coords of current pixel */
+int YC = 0,			/* Output Y coord of current line */
     Pass = 0,			/* Used by output routine if interlaced pic */
-    OutCount = 0,		/* Decompressor output 'stack count' */
     RWidth, RHeight,		/* screen dimensions */
     Width, Height,		/* image dimensions */
     LeftOfs, TopOfs,		/* image offset */
     BitsPerPixel,		/* Bits per pixel, read from GIF header */
-    BytesPerScanline,		/* bytes per scanline in output raster */
     ColorMapSize,		/* number of colors */
     Background,			/* background color */
     CodeSize,			/* Code size, read from GIF header */
     InitCodeSize,		/* Starting code size, used during Clear */
-    Code,			/* Value returned by ReadCode */
+    Code,			/* Current code from the raster data */
     MaxCode,			/* limiting value for current code size */
     ClearCode,			/* GIF clear code */
     EOFCode,			/* GIF end-of-information code */
-    CurCode, OldCode, InCode,	/* Decompressor variables */
+    OldCode,			/* Decompressor variables */
     FirstFree,			/* First free code, generated per GIF spec */
     FreeCode,			/* Decompressor,next free slot in hash table */
-    FinChar,			/* Decompressor variable */
     BitMask,			/* AND mask for data size */
     ReadMask,			/* Code AND mask for current code size */
     Misc;                       /* miscellaneous bits (interlace, local cmap)*/
@@ -67,15 +63,62 @@ int BitOffset = 0,		/* Bit Offset of next code */
 boolean Interlace, HasColormap;
 
 byte *RawGIF;			/* The heap array to hold it, raw */
-byte *Raster;			/* The raster data stream, unblocked */
 byte *pic8;
 
-    /* The hash table used by the decompressor */
-int Prefix[4096];
-int Suffix[4096];
-
-    /* An output array used by the decompressor */
-int OutCode[4097];
+    /* The string table used by the decompressor.  Each code is stored as
+       (prefix code, last byte), along with the first byte and the length
+       of the string it represents, so that a string can be written
+       directly into its final position, back to front, without stacking */
+static short Prefix[4096];
+static byte  Suffix[4096];
+static byte  FirstCh[4096];
+static short StrLen[4096];
+
+    /* bit buffer used to read codes from the raster data sub-blocks */
+static unsigned long BitBuf;	/* buffered bits, LSB first */
+static int           BitCnt;	/* # of valid bits in BitBuf */
+static int           BlkLeft;	/* bytes left in current data sub-block */
+static int           RasterEnd;	/* hit block terminator (or end of file) */
+static byte         *EndGIF;	/* end of the data read from the file */
+
+#define BITBUFSIZE ((int) (sizeof(unsigned long) * 8))
+
+    /* current output position (see putString()) */
+static byte *OutPtr;		/* where the next pixel goes */
+static int   OutLeft;		/* pixels left on current output line */
+
+    /* one image in a multi-image (animated) GIF file */
+typedef struct { byte *desc;           /* its image descriptor, in RawGIF */
+		 int   left, top;      /* where it goes */
+		 int   w, h;           /* its size */
+		 int   disposal;       /* what to do with it when it's done */
+		 int   delay;          /* how long to show it (1/100 secs) */
+		 int   transp;         /* transparent color index, or -1 */
+	       } GIFFRAME;
+
+#define DISPOSE_NONE  1        /* leave frame in place */
+#define DISPOSE_BG    2        /* restore frame's area to background */
+#define DISPOSE_PREV  3        /* restore frame's area to what was there */
+
+    /* the private state of an animated GIF's ANIMSRC */
+typedef struct { byte     *raw;        /* the whole file (was RawGIF) */
+		 int       rawsize;
+		 int       nframes;
+		 GIFFRAME *frames;
+		 byte     *gcmap;      /* global colormap (in raw), or NULL */
+		 int       gsize;      /* # of colors in global colormap */
+		 int       bg;         /* background color */
+		 int       ncols;      /* size of colormap in ANIMSRC */
+		 int       w, h;       /* size of the animation */
+		 byte     *comp;       /* frames composited so far */
+		 byte     *save;       /* 'comp' saved for DISPOSE_PREV */
+		 byte     *frame;      /* a single decoded frame */
+		 int       framesize;  /* size of 'frame' buffer */
+		 int       last;       /* last frame composited in comp */
+	       } GIFANIM;
+
+static GIFFRAME *Frames = NULL;     /* images found by LoadGIF() */
+static int       NFrames, MaxFrames;
 
 int   gif89 = 0;
 char *id87 = "GIF87a";
@@ -89,8 +132,17 @@ static int EGApalette[16][3] = {
   
 
 static int   readImage   PARM((PICINFO *));
-static int   readCode    PARM((void));
-static void  doInterlace PARM((int));
+static int   decodeRaster PARM((void));
+static void  addFrame    PARM((byte *, int, int, int));
+static int   makeAnim    PARM((PICINFO *));
+static int   animRender  PARM((ANIMSRC *, int, byte *));
+static int   animDelay   PARM((ANIMSRC *, int));
+static void  animFree    PARM((ANIMSRC *));
+static int   animCmap    PARM((GIFANIM *, byte *, byte *, byte *, byte *));
+static void  fillBits    PARM((void));
+static void  skipRaster  PARM((void));
+static void  nextLine    PARM((void));
+static void  putString   PARM((int, int, int));
 static int   gifError    PARM((PICINFO *, char *));
 static void  gifWarning  PARM((char *));
 
@@ -101,21 +153,26 @@ byte *dataptr;
 
 
 /*****************************/
-int LoadGIF(fname, pinfo)
+int LoadGIF(fname, pinfo, quick)
      char *fname;
      PICINFO *pinfo;
+     int      quick;
 /*****************************/
 {
-  /* returns '1' if successful */
+  /* returns '1' if successful.  If the file holds more than one image,
+     and we're not doing a 'quick' load, the images are returned as an
+     animation (see makeAnim()) */
 
   register byte  ch, ch1, *origptr;
   register int   i, block;
-  int            aspect, gotimage;
+  int            aspect, gotimage, disposal, delay, transp;
 
   /* initialize variables */
-  BitOffset = XC = YC = Pass = OutCount = gotimage = 0;
-  RawGIF = Raster = pic8 = NULL;
+  YC = Pass = gotimage = 0;
+  RawGIF = pic8 = NULL;
   gif89 = 0;
+  NFrames = 0;
+  disposal = delay = 0;  transp = -1;
 
   pinfo->pic     = (byte *) NULL;
   pinfo->comment = (char *) NULL;
@@ -135,12 +192,11 @@ int LoadGIF(fname, pinfo)
   if (!(dataptr = RawGIF = (byte *) calloc((size_t) filesize+256, (size_t) 1)))
     return( gifError(pinfo, "not enough memory to read gif file") );
   
-  if (!(Raster = (byte *) calloc((size_t) filesize+256,(size_t) 1))) 
-    return( gifError(pinfo, "not enough memory to read gif file") );
-  
   if (fread(dataptr, (size_t) filesize, (size_t) 1, fp) != 1) 
     return( gifError(pinfo, "GIF data read failed") );
 
+  EndGIF = RawGIF + filesize;
+
 
   origptr = dataptr;
 
@@ -322,18 +378,28 @@ int LoadGIF(fname, pinfo)
 
 
       else if (fn == 0xF9) {  /* Graphic Control Extension */
-	int j, sbsize;
+	int j, sbsize, flags;
 
 	if (DEBUG) fprintf(stderr,"Graphic Control extension\n\n");
 
-	SetISTR(ISTR_INFO, "%s:  %s", bname, 
-		"Graphic Control Extension in GIF file.  Ignored.");
-	
-	/* read (and ignore) data sub-blocks */
-	do {
+	/* remember disposal method, delay, and transparent color, as
+	   they're needed if this turns out to be an animation */
+	sbsize = NEXTBYTE;
+	if (sbsize >= 4) {
+	  flags    = NEXTBYTE;
+	  disposal = (flags >> 2) & 7;
+	  delay    = NEXTBYTE;  delay += (NEXTBYTE)<<8;
+	  transp   = NEXTBYTE;
+	  if (!(flags & 1)) transp = -1;
+	  dataptr += sbsize - 4;
+	}
+	else dataptr += sbsize;
+
+	/* read (and ignore) any remaining data sub-blocks */
+	while (sbsize) {
 	  j = 0; sbsize = NEXTBYTE;
 	  while (j<sbsize) { NEXTBYTE;  j++; }
-	} while (sbsize);
+	}
       }
       
 
@@ -372,6 +438,10 @@ int LoadGIF(fname, pinfo)
       if (DEBUG) fprintf(stderr,"imagesep (got=%d)  ",gotimage);
       if (DEBUG) fprintf(stderr,"  at start: offset=0x%lx\n",dataptr-RawGIF);
 
+      /* images after the first are only decoded as they're needed */
+      if (!quick) addFrame(dataptr, disposal, delay, transp);
+      disposal = delay = 0;  transp = -1;
+
       if (gotimage) {   /* just skip over remaining images */
 	int i,misc,ch,ch1;
 
@@ -393,7 +463,7 @@ int LoadGIF(fname, pinfo)
 	/* skip image data sub-blocks */
 	do {
 	  ch = ch1 = NEXTBYTE;
-	  while (ch--) NEXTBYTE;
+	  dataptr += ch;
 	  if ((dataptr - RawGIF) > filesize) break;      /* EOF */
 	} while(ch1);
       }
@@ -428,12 +498,15 @@ int LoadGIF(fname, pinfo)
     if (DEBUG) fprintf(stderr,"\n");
   }
 
-  free(RawGIF);	 RawGIF = NULL;
-  free(Raster);  Raster = NULL;
-
   if (!gotimage) 
      return( gifError(pinfo, "no image data found in GIF file") );
 
+  if (NFrames > 1 && makeAnim(pinfo)) {
+    RawGIF = NULL;                 /* it belongs to the animation now */
+    return 1;
+  }
+
+  free(RawGIF);	 RawGIF = NULL;
   return 1;
 }
 
@@ -442,13 +515,11 @@ int LoadGIF(fname, pinfo)
 static int readImage(pinfo)
      PICINFO *pinfo;
 {
-  register byte ch, ch1, *ptr1, *picptr;
-  int           i, npixels, maxpixels;
-
-  npixels = maxpixels = 0;
+  register byte ch;
+  int           i, maxpixels, rv;
 
   /* read in values from the image descriptor */
-  
+
   ch = NEXTBYTE;
   LeftOfs = ch + 0x100 * NEXTBYTE;
   ch = NEXTBYTE;
@@ -467,78 +538,144 @@ static int readImage(pinfo)
       pinfo->g[i] = NEXTBYTE;
       pinfo->b[i] = NEXTBYTE;
     }
+
+    /* the local colormap's size is the one that counts for this image */
+    numcols = 1 << ((Misc&7)+1);
+    BitMask = numcols - 1;
   }
 
 
   if (!HasColormap && !(Misc&0x80)) {
     /* no global or local colormap */
-    SetISTR(ISTR_WARNING, "%s:  %s", bname, 
+    SetISTR(ISTR_WARNING, "%s:  %s", bname,
 	    "No colormap in this GIF file.  Assuming EGA colors.");
   }
-    
 
-  
+
+
+  if (DEBUG) {
+    fprintf(stderr,"xv: LoadGIF() - picture is %dx%d, %d bits, %sinterlaced\n",
+	    Width, Height, BitsPerPixel, Interlace ? "" : "non-");
+  }
+
+
+  /* Allocate the 'pic' */
+  maxpixels = Width*Height;
+  pic8 = (byte *) malloc((size_t) maxpixels);
+  if (!pic8) return( gifError(pinfo, "couldn't malloc 'pic8'") );
+
+  rv = decodeRaster();
+  if (rv < 0) {
+    gifWarning("corrupt GIF file (bad code size).  Image skipped.");
+    free(pic8);  pic8 = NULL;
+    return 0;
+  }
+
+  if (rv == 0)
+    SetISTR(ISTR_WARNING,"%s:  %s", bname,
+	    "This GIF file seems to be truncated.  Winging it.");
+
+  fclose(fp);
+
+  /* fill in the PICINFO structure */
+
+  pinfo->pic     = pic8;
+  pinfo->w       = Width;
+  pinfo->h       = Height;
+  pinfo->type    = PIC8;
+  pinfo->frmType = F_GIF;
+  pinfo->colType = F_FULLCOLOR;
+
+  pinfo->normw = pinfo->w;   pinfo->normh = pinfo->h;
+
+  sprintf(pinfo->fullInfo,
+	  "GIF%s, %d bit%s per pixel, %sinterlaced.  (%d bytes)",
+ 	  (gif89) ? "89" : "87", BitsPerPixel,
+	  (BitsPerPixel==1) ? "" : "s",
+ 	  Interlace ? "" : "non-", filesize);
+
+  sprintf(pinfo->shrtInfo, "%dx%d GIF%s.",Width,Height,(gif89) ? "89" : "87");
+
+  /* pinfo.comment gets handled in main LoadGIF() block-reader */
+
+  return 1;
+}
+
+
+
+/* Decode the LZW raster data that starts at dataptr (with the initial code
+ * size byte) into 'pic8', which is Width*Height, using Interlace and
+ * BitMask as set up from the image descriptor.  Leaves dataptr just past
+ * the raster data.  Returns '1' if ok, '0' if the data ran out early (in
+ * which case the rest of the image is cleared), and '-1' if the initial
+ * code size is bogus (in which case nothing is written to 'pic8').
+ */
+
+static int decodeRaster()
+{
+  register byte *sp;
+  register int   len, code;
+  int            i, npixels, maxpixels, fch, lastch, incode;
+
+  npixels = 0;
+  maxpixels = Width*Height;
+
   /* Start reading the raster data. First we get the intial code size
    * and compute decompressor constant values, based on this code size.
    */
-  
+
   CodeSize = NEXTBYTE;
+  if (CodeSize < 1 || CodeSize > 11) {
+    BlkLeft = RasterEnd = 0;
+    skipRaster();
+    return -1;
+  }
 
   ClearCode = (1 << CodeSize);
   EOFCode = ClearCode + 1;
   FreeCode = FirstFree = ClearCode + 2;
-  
+
   /* The GIF spec has it that the code size is the code size used to
    * compute the above values is the code size given in the file, but the
    * code size used in compression/decompression is the code size given in
    * the file plus one. (thus the ++).
    */
-  
+
   CodeSize++;
   InitCodeSize = CodeSize;
   MaxCode = (1 << CodeSize);
   ReadMask = MaxCode - 1;
-  
-
-
-  /* UNBLOCK:
-   * Read the raster data.  Here we just transpose it from the GIF array
-   * to the Raster array, turning it from a series of blocks into one long
-   * data stream, which makes life much easier for readCode().
-   */
-  
-  ptr1 = Raster;
-  do {
-    ch = ch1 = NEXTBYTE;
-    while (ch--) { *ptr1 = NEXTBYTE; ptr1++; }
-    if ((dataptr - RawGIF) > filesize) {
-      SetISTR(ISTR_WARNING,"%s:  %s", bname,
-	      "This GIF file seems to be truncated.  Winging it.");
-      break;
-    }
-  } while(ch1);
-
-
-
 
-  if (DEBUG) {
-    fprintf(stderr,"xv: LoadGIF() - picture is %dx%d, %d bits, %sinterlaced\n",
-	    Width, Height, BitsPerPixel, Interlace ? "" : "non-");
+  /* the single-byte strings never change, so set them up once per image */
+  for (i=0; i<ClearCode; i++) {
+    Prefix[i]  = 0;
+    Suffix[i]  = FirstCh[i] = i & BitMask;
+    StrLen[i]  = 1;
   }
-  
 
-  /* Allocate the 'pic' */
-  maxpixels = Width*Height;
-  picptr = pic8 = (byte *) malloc((size_t) maxpixels);
-  if (!pic8) return( gifError(pinfo, "couldn't malloc 'pic8'") );
 
-  
-  /* Decompress the file, continuing until you see the GIF EOF code.
-   * One obvious enhancement is to add checking for corrupt files here.
+  /* The raster data is read straight out of its data sub-blocks (see
+   * fillBits()), and each decoded string is written directly to where it
+   * belongs in 'pic8' (see putString()), so there's no need to unblock
+   * the raster data, or to re-order the lines of an interlaced image.
    */
-  
-  Code = readCode();
-  while (Code != EOFCode) {
+
+  BitBuf = 0;  BitCnt = BlkLeft = RasterEnd = 0;
+  YC = Pass = 0;
+  OutPtr  = pic8;
+  OutLeft = (Height>0) ? Width : 0;
+  OldCode = -1;
+
+  while (npixels < maxpixels) {
+    /* pull the next CodeSize bits out of the bit buffer */
+    if (BitCnt < CodeSize) {
+      fillBits();
+      if (BitCnt < CodeSize) break;       /* ran out of raster data */
+    }
+    Code = (int) (BitBuf & ReadMask);
+    BitBuf >>= CodeSize;
+    BitCnt -= CodeSize;
+
     /* Clear code sets everything back to its initial value, then reads the
      * immediately subsequent code as uncompressed data.
      */
@@ -548,194 +685,527 @@ static int readImage(pinfo)
       MaxCode = (1 << CodeSize);
       ReadMask = MaxCode - 1;
       FreeCode = FirstFree;
-      Code = readCode();
-      CurCode = OldCode = Code;
-      FinChar = CurCode & BitMask;
-      if (!Interlace) *picptr++ = FinChar;
-         else doInterlace(FinChar);
+      OldCode  = -1;
+      continue;
+    }
+
+    if (Code == EOFCode) break;
+
+    if (OldCode < 0) {       /* first code after a clear is raw data */
+      Code &= BitMask;
+      putString(Code, 1, -1);
       npixels++;
+      OldCode = Code;
+      continue;
+    }
+
+    /* If less than FreeCode, the code is in the table already, and its
+     * string (and that string's first byte) are known.  Otherwise, it's
+     * the string for OldCode, plus the first byte of that same string.
+     */
+
+    incode = Code;
+    if (Code < FreeCode) {
+      code   = Code;
+      len    = StrLen[code];
+      lastch = -1;
     }
     else {
-      /* If not a clear code, must be data: save same as CurCode and InCode */
+      code   = OldCode;
+      len    = StrLen[code] + 1;
+      lastch = FirstCh[code];
+    }
+    fch = FirstCh[code];
+
+    if (len < OutLeft) {      /* the usual case:  build it right in place */
+      sp = OutPtr + len;
+      OutPtr = sp;  OutLeft -= len;
+      if (lastch >= 0) *--sp = lastch;
+      while (code >= ClearCode) { *--sp = Suffix[code];  code = Prefix[code]; }
+      *--sp = Suffix[code];
+    }
+    else putString(code, len, lastch);
 
-      /* if we're at maxcode and didn't get a clear, stop loading */
-      if (FreeCode>=4096) { /* printf("freecode blew up\n"); */
-			    break; }
+    npixels += len;
 
-      CurCode = InCode = Code;
-      
-      /* If greater or equal to FreeCode, not in the hash table yet;
-       * repeat the last character decoded
-       */
-      
-      if (CurCode >= FreeCode) {
-	CurCode = OldCode;
-	if (OutCount > 4096) {  /* printf("outcount1 blew up\n"); */ break; }
-	OutCode[OutCount++] = FinChar;
-      }
-      
-      /* Unless this code is raw data, pursue the chain pointed to by CurCode
-       * through the hash table to its end; each code in the chain puts its
-       * associated output code on the output queue.
-       */
-      
-      while (CurCode > BitMask) {
-	if (OutCount > 4096) break;   /* corrupt file */
-	OutCode[OutCount++] = Suffix[CurCode];
-	CurCode = Prefix[CurCode];
-      }
-      
-      if (OutCount > 4096) { /* printf("outcount blew up\n"); */ break; }
-      
-      /* The last code in the chain is treated as raw data. */
-      
-      FinChar = CurCode & BitMask;
-      OutCode[OutCount++] = FinChar;
-      
-      /* Now we put the data out to the Output routine.
-       * It's been stacked LIFO, so deal with it that way...
-       */
+    /* Build the table on-the-fly. No table is stored in the file.
+     * Once the table is full, the encoder may keep sending codes for a
+     * while before it sends a clear, so just stop adding to it.
+     */
 
-      /* safety thing:  prevent exceeding range of 'pic8' */
-      if (npixels + OutCount > maxpixels) OutCount = maxpixels-npixels;
-	
-      npixels += OutCount;
-      if (!Interlace) for (i=OutCount-1; i>=0; i--) *picptr++ = OutCode[i];
-                else  for (i=OutCount-1; i>=0; i--) doInterlace(OutCode[i]);
-      OutCount = 0;
+    if (FreeCode < 4096) {
+      Prefix[FreeCode]  = OldCode;
+      Suffix[FreeCode]  = fch;
+      FirstCh[FreeCode] = FirstCh[OldCode];
+      StrLen[FreeCode]  = StrLen[OldCode] + 1;
 
-      /* Build the hash table on-the-fly. No table is stored in the file. */
-      
-      Prefix[FreeCode] = OldCode;
-      Suffix[FreeCode] = FinChar;
-      OldCode = InCode;
-      
       /* Point to the next slot in the table.  If we exceed the current
-       * MaxCode value, increment the code size unless it's already 12.  If it
-       * is, do nothing: the next code decompressed better be CLEAR
+       * MaxCode value, increment the code size unless it's already 12.
        */
-      
+
       FreeCode++;
-      if (FreeCode >= MaxCode) {
-	if (CodeSize < 12) {
-	  CodeSize++;
-	  MaxCode *= 2;
-	  ReadMask = (1 << CodeSize) - 1;
-	}
+      if (FreeCode >= MaxCode && CodeSize < 12) {
+	CodeSize++;
+	MaxCode *= 2;
+	ReadMask = MaxCode - 1;
       }
     }
-    Code = readCode();
-    if (npixels >= maxpixels) break;
+
+    OldCode = incode;
+    if (OldCode >= FreeCode) OldCode = FreeCode - 1;    /* corrupt file */
   }
-  
-  if (npixels != maxpixels) {
-    SetISTR(ISTR_WARNING,"%s:  %s", bname,
-	    "This GIF file seems to be truncated.  Winging it.");
-    if (!Interlace)  /* clear->EOBuffer */
-      xvbzero((char *) pic8+npixels, (size_t) (maxpixels-npixels));
+
+  if (npixels < maxpixels) {
+    /* clear all lines that didn't get written */
+    while (OutLeft) {
+      xvbzero((char *) OutPtr, (size_t) OutLeft);
+      OutPtr += OutLeft;
+      nextLine();
+    }
   }
 
-  fclose(fp);
+  /* move dataptr past whatever's left of the raster data */
+  skipRaster();
 
-  /* fill in the PICINFO structure */
+  return (npixels < maxpixels) ? 0 : 1;
+}
 
-  pinfo->pic     = pic8;
-  pinfo->w       = Width;           
-  pinfo->h       = Height;
-  pinfo->type    = PIC8;
-  pinfo->frmType = F_GIF;
-  pinfo->colType = F_FULLCOLOR;
 
-  pinfo->normw = pinfo->w;   pinfo->normh = pinfo->h;
+
+/* Remember where image #NFrames starts (at 'desc', its image descriptor),
+ * along with the graphic control extension stuff that goes with it.
+ */
+
+static void addFrame(desc, disposal, delay, transp)
+     byte *desc;
+     int   disposal, delay, transp;
+{
+  GIFFRAME *fr;
+
+  if (NFrames < 0) return;      /* gave up on this file */
+
+  if (NFrames >= MaxFrames) {
+    int n = (MaxFrames) ? MaxFrames * 2 : 64;
+    if (Frames) fr = (GIFFRAME *) realloc(Frames, n * sizeof(GIFFRAME));
+           else fr = (GIFFRAME *) malloc(n * sizeof(GIFFRAME));
+    if (!fr) { NFrames = -1;  return; }
+    Frames = fr;  MaxFrames = n;
+  }
+
+  if (desc + 9 > EndGIF) return;    /* truncated */
+
+  fr = &Frames[NFrames++];
+  fr->desc     = desc;
+  fr->left     = desc[0] + 0x100 * desc[1];
+  fr->top      = desc[2] + 0x100 * desc[3];
+  fr->w        = desc[4] + 0x100 * desc[5];
+  fr->h        = desc[6] + 0x100 * desc[7];
+  fr->disposal = disposal;
+  fr->delay    = delay;
+  fr->transp   = transp;
+}
+
+
+/* Turns the images found by LoadGIF() into an ANIMSRC, which is returned
+ * in pinfo->anim, with its first frame in pinfo->pic.  The frames aren't
+ * decoded until they're asked for (see animRender()), so all that's kept
+ * around is the GIF file itself, and a few frame-sized buffers.
+ * Returns '0' (leaving pinfo as it was) if it couldn't be done.
+ */
+
+static int makeAnim(pinfo)
+     PICINFO *pinfo;
+{
+  ANIMSRC *as;
+  GIFANIM *ga;
+  GIFFRAME *fr;
+  byte    *pic;
+  int      i, w, h, maxf;
+
+  as = (ANIMSRC *) NULL;  ga = (GIFANIM *) NULL;  pic = (byte *) NULL;
+
+  /* the 'logical screen' is supposed to hold all the frames, but make sure */
+  w = RWidth;  h = RHeight;  maxf = 0;
+  for (i=0, fr=Frames; i<NFrames; i++, fr++) {
+    if (fr->left + fr->w > w) w = fr->left + fr->w;
+    if (fr->top  + fr->h > h) h = fr->top  + fr->h;
+    if (fr->w * fr->h > maxf) maxf = fr->w * fr->h;
+  }
+  if (w<1 || h<1 || maxf<1) return 0;
+
+  as = (ANIMSRC *) calloc((size_t) 1, sizeof(ANIMSRC));
+  ga = (GIFANIM *) calloc((size_t) 1, sizeof(GIFANIM));
+  if (!as || !ga) goto failed;
+
+  ga->frames = (GIFFRAME *) malloc(NFrames * sizeof(GIFFRAME));
+  ga->comp   = (byte *) malloc((size_t) w*h);
+  ga->save   = (byte *) malloc((size_t) w*h);
+  ga->frame  = (byte *) malloc((size_t) maxf);
+  pic        = (byte *) malloc((size_t) w*h);
+  if (!ga->frames || !ga->comp || !ga->save || !ga->frame || !pic)
+    goto failed;
+
+  xvbcopy((char *) Frames, (char *) ga->frames, NFrames * sizeof(GIFFRAME));
+  ga->raw     = RawGIF;
+  ga->rawsize = filesize;
+  ga->nframes = NFrames;
+  ga->gcmap   = (HasColormap) ? RawGIF + 13 : (byte *) NULL;
+  ga->gsize   = ColorMapSize;
+  ga->w = w;  ga->h = h;
+  ga->framesize = maxf;
+  ga->last = -1;
+
+  /* all frames are drawn using the colormap of the first one.  Frames
+     that have their own colormap get mapped into it */
+  ga->ncols = animCmap(ga, Frames[0].desc, as->r, as->g, as->b);
+  ga->bg = Background & (ga->ncols - 1);
+
+  if (ga->gcmap && (Frames[0].desc[8] & 0x80)) {
+    /* the background color is in the global colormap.  find it */
+    byte *cp;
+    int   d, mind;
+
+    cp = ga->gcmap + 3 * (Background & (ga->gsize - 1));
+    for (i=0, mind=1000000; i<ga->ncols && mind; i++) {
+      d = abs(cp[0]-as->r[i]) + abs(cp[1]-as->g[i]) + abs(cp[2]-as->b[i]);
+      if (d < mind) { mind = d;  ga->bg = i; }
+    }
+  }
+
+  as->nframes = NFrames;
+  as->w       = w;
+  as->h       = h;
+  as->render  = animRender;
+  as->delay   = animDelay;
+  as->free    = animFree;
+  as->data    = (char *) ga;
+
+  if (!animRender(as, 0, pic)) goto failed;
+
+  if (pinfo->pic) free(pinfo->pic);
+  pinfo->pic = pic;
+  pinfo->w = pinfo->normw = w;
+  pinfo->h = pinfo->normh = h;
+  for (i=0; i<256; i++) {
+    pinfo->r[i] = as->r[i];  pinfo->g[i] = as->g[i];  pinfo->b[i] = as->b[i];
+  }
+  pinfo->anim = as;
 
   sprintf(pinfo->fullInfo,
-	  "GIF%s, %d bit%s per pixel, %sinterlaced.  (%d bytes)",
- 	  (gif89) ? "89" : "87", BitsPerPixel, 
-	  (BitsPerPixel==1) ? "" : "s", 
- 	  Interlace ? "" : "non-", filesize);
+	  "GIF%s, %d bit%s per pixel, %d frame animation.  (%d bytes)",
+ 	  (gif89) ? "89" : "87", BitsPerPixel,
+	  (BitsPerPixel==1) ? "" : "s", NFrames, filesize);
 
-  sprintf(pinfo->shrtInfo, "%dx%d GIF%s.",Width,Height,(gif89) ? "89" : "87");
+  sprintf(pinfo->shrtInfo, "%dx%d GIF%s, %d frames.", w, h,
+	  (gif89) ? "89" : "87", NFrames);
 
-  /* pinfo.comment gets handled in main LoadGIF() block-reader */
+  return 1;
+
+ failed:
+  if (ga) {
+    if (ga->frames) free(ga->frames);
+    if (ga->comp)   free(ga->comp);
+    if (ga->save)   free(ga->save);
+    if (ga->frame)  free(ga->frame);
+    free(ga);
+  }
+  if (as)  free(as);
+  if (pic) free(pic);
+  SetISTR(ISTR_WARNING, "%s:  %s", bname,
+	  "Not enough memory to animate.  Showing first image only.");
+  return 0;
+}
 
+
+/* Render frame #n of the animation into 'pic' (as->w * as->h).  Frames
+ * are composited one on top of the next, as the GIF89 spec says, so
+ * frame #n is built by adding frames to the previous one rendered, or by
+ * starting again from frame #0 if going backwards.
+ */
+
+static int animRender(as, n, pic)
+     ANIMSRC *as;
+     int      n;
+     byte    *pic;
+{
+  GIFANIM  *ga;
+  GIFFRAME *fr;
+  byte      r[256], g[256], b[256], map[256], *sp, *dp;
+  int       i, j, k, x, y, w, h, fw, fh, ncols, transp;
+
+  ga = (GIFANIM *) as->data;
+  if (n < 0 || n >= ga->nframes) return 0;
+  w = ga->w;  h = ga->h;
+
+  if (n < ga->last) ga->last = -1;   /* n == last is already in comp */
+  if (ga->last < 0) {
+    xvbzero((char *) ga->comp, (size_t) w*h);
+    if (ga->bg) for (i=w*h, dp=ga->comp; i; i--) *dp++ = ga->bg;
+  }
+
+  for (k=ga->last+1; k<=n; k++) {
+    /* get rid of the previous frame, as it asked */
+    if (k>0) {
+      fr = &ga->frames[k-1];
+      fw = fr->w;  fh = fr->h;
+      if (fr->left + fw > w) fw = w - fr->left;
+      if (fr->top  + fh > h) fh = h - fr->top;
+
+      if (fr->disposal == DISPOSE_BG || fr->disposal == DISPOSE_PREV) {
+	for (y=0; y<fh; y++) {
+	  i  = (fr->top + y) * w + fr->left;
+	  dp = ga->comp + i;
+	  if (fr->disposal == DISPOSE_PREV)
+	    xvbcopy((char *) ga->save + i, (char *) dp, (size_t) fw);
+	  else
+	    for (x=0; x<fw; x++) *dp++ = ga->bg;
+	}
+      }
+    }
+
+    fr = &ga->frames[k];
+    if (fr->disposal == DISPOSE_PREV)
+      xvbcopy((char *) ga->comp, (char *) ga->save, (size_t) w*h);
+
+    /* decode the frame (see readImage()) */
+    dataptr = fr->desc;
+    EndGIF  = ga->raw + ga->rawsize;
+    Width   = fr->w;
+    Height  = fr->h;
+    if (Width*Height < 1) continue;
+    dataptr += 8;
+
+    Misc = NEXTBYTE;
+    Interlace = ((Misc & INTERLACEMASK) ? True : False);
+    ncols = animCmap(ga, fr->desc, r, g, b);
+    if (Misc & 0x80) dataptr += 3 * ncols;
+    BitMask = ncols - 1;
+
+    pic8 = ga->frame;
+    if (dataptr >= EndGIF || decodeRaster() < 0) continue;
+
+    /* if the frame has its own colormap, find the nearest colors in the
+       one we're using */
+    for (i=0; i<256; i++) map[i] = i;
+    if (ncols != ga->ncols ||
+	xvbcmp((char *) r, (char *) as->r, (size_t) ncols) ||
+	xvbcmp((char *) g, (char *) as->g, (size_t) ncols) ||
+	xvbcmp((char *) b, (char *) as->b, (size_t) ncols)) {
+      for (i=0; i<ncols; i++) {
+	int d, mind, best;
+	mind = 1000000;  best = 0;
+	for (j=0; j<ga->ncols && mind; j++) {
+	  d = abs(r[i]-as->r[j]) + abs(g[i]-as->g[j]) + abs(b[i]-as->b[j]);
+	  if (d < mind) { mind = d;  best = j; }
+	}
+	map[i] = best;
+      }
+    }
+
+    /* and paste it in, leaving the transparent pixels alone */
+    transp = fr->transp;
+    fw = fr->w;  fh = fr->h;
+    if (fr->left + fw > w) fw = w - fr->left;
+    if (fr->top  + fh > h) fh = h - fr->top;
+
+    for (y=0; y<fh; y++) {
+      sp = ga->frame + y * fr->w;
+      dp = ga->comp + (fr->top + y) * w + fr->left;
+      for (x=0; x<fw; x++, sp++, dp++)
+	if (*sp != transp) *dp = map[*sp];
+    }
+  }
+
+  ga->last = n;
+  xvbcopy((char *) ga->comp, (char *) pic, (size_t) w*h);
   return 1;
 }
 
 
+/* Returns how long to show frame #n, in milliseconds.  Delays of less than
+ * 2/100ths of a second are taken to mean 'not specified'.
+ */
+
+static int animDelay(as, n)
+     ANIMSRC *as;
+     int      n;
+{
+  GIFANIM *ga = (GIFANIM *) as->data;
+
+  if (n < 0 || n >= ga->nframes || ga->frames[n].delay < 2) return 100;
+  return ga->frames[n].delay * 10;
+}
+
+
+static void animFree(as)
+     ANIMSRC *as;
+{
+  GIFANIM *ga = (GIFANIM *) as->data;
+
+  free(ga->raw);
+  free(ga->frames);
+  free(ga->comp);
+  free(ga->save);
+  free(ga->frame);
+  free(ga);
+  free(as);
+}
+
 
-/* Fetch the next code from the raster data stream.  The codes can be
- * any length from 3 to 12 bits, packed into 8-bit bytes, so we have to
- * maintain our location in the Raster array as a BIT Offset.  We compute
- * the byte Offset into the raster array by dividing this by 8, pick up
- * three bytes, compute the bit Offset into our 24-bit chunk, shift to
- * bring the desired code to the bottom, then mask it off and return it. 
+/* Loads the colormap for the image whose descriptor is at 'desc' into r,g,b.
+ * That's its local colormap if it has one, or the file's global colormap,
+ * or the EGA colors if there's neither.  Returns the size of the colormap.
  */
 
-static int readCode()
+static int animCmap(ga, desc, r, g, b)
+     GIFANIM *ga;
+     byte    *desc, *r, *g, *b;
 {
-  int RawCode, ByteOffset;
-  
-  ByteOffset = BitOffset / 8;
-  RawCode = Raster[ByteOffset] + (Raster[ByteOffset + 1] << 8);
-  if (CodeSize >= 8)
-    RawCode += ( ((int) Raster[ByteOffset + 2]) << 16);
-  RawCode >>= (BitOffset % 8);
-  BitOffset += CodeSize;
-
-  return(RawCode & ReadMask);
+  byte *cp;
+  int   i, n;
+
+  if (desc[8] & 0x80) { cp = desc + 9;  n = 1 << ((desc[8]&7)+1); }
+  else { cp = ga->gcmap;  n = ga->gsize; }
+
+  if (cp && cp + 3*n > ga->raw + ga->rawsize) cp = (byte *) NULL;
+
+  for (i=0; i<256; i++) {
+    if (cp && i<n) { r[i] = cp[3*i];  g[i] = cp[3*i+1];  b[i] = cp[3*i+2]; }
+    else if (cp)   { r[i] = g[i] = b[i] = 0; }
+    else {
+      r[i] = EGApalette[i&15][0];
+      g[i] = EGApalette[i&15][1];
+      b[i] = EGApalette[i&15][2];
+    }
+  }
+
+  return n;
 }
 
 
-/***************************/
-static void doInterlace(Index)
-     int Index;
+
+/* Refill the bit buffer from the raster data stream.  The codes can be
+ * any length from 3 to 12 bits, packed LSB-first into 8-bit bytes, which
+ * are in turn split up into data sub-blocks of up to 255 bytes.  We grab
+ * as many whole bytes as will fit in an unsigned long (7 or 3 of them,
+ * depending on its size), hopping over sub-block headers as we go, so
+ * most codes can be pulled out of BitBuf with just a mask and a shift.
+ */
+
+static void fillBits()
 {
-  static byte *ptr = NULL;
-  static int   oldYC = -1;
-  
-  if (oldYC != YC) {  ptr = pic8 + YC * Width;  oldYC = YC; }
-  
-  if (YC<Height)
-    *ptr++ = Index;
-  
-  /* Update the X-coordinate, and if it overflows, update the Y-coordinate */
-  
-  if (++XC == Width) {
-    
-    /* deal with the interlace as described in the GIF
-     * spec.  Put the decoded scan line out to the screen if we haven't gone
-     * past the bottom of it
-     */
-    
-    XC = 0;
-    
-    switch (Pass) {
-    case 0:
-      YC += 8;
-      if (YC >= Height) { Pass++; YC = 4; }
-      break;
-      
-    case 1:
-      YC += 8;
-      if (YC >= Height) { Pass++; YC = 2; }
-      break;
-      
-    case 2:
-      YC += 4;
-      if (YC >= Height) { Pass++; YC = 1; }
-      break;
-      
-    case 3:
-      YC += 2;  break;
-      
-    default:
-      break;
+  while (BitCnt <= BITBUFSIZE - 8 && !RasterEnd) {
+    if (!BlkLeft) {
+      if (dataptr >= EndGIF) { RasterEnd = 1;  break; }    /* truncated */
+      BlkLeft = NEXTBYTE;
+      if (!BlkLeft) { RasterEnd = 1;  break; }       /* block terminator */
     }
+
+    if (dataptr >= EndGIF) { RasterEnd = 1;  break; }
+    BitBuf |= ((unsigned long) NEXTBYTE) << BitCnt;
+    BitCnt += 8;
+    BlkLeft--;
   }
 }
 
 
-      
+/* Leave dataptr just past the block terminator that ends the raster data
+ * of the current image, no matter how much of it the decoder used.
+ */
+
+static void skipRaster()
+{
+  int ch;
+
+  if (RasterEnd) return;
+  dataptr += BlkLeft;  BlkLeft = 0;
+
+  while (dataptr < EndGIF) {
+    ch = NEXTBYTE;
+    if (!ch) break;
+    dataptr += ch;
+  }
+
+  if (dataptr > EndGIF) {
+    SetISTR(ISTR_WARNING,"%s:  %s", bname,
+	    "This GIF file seems to be truncated.  Winging it.");
+    dataptr = EndGIF;
+  }
+}
+
+
+/* Move OutPtr/OutLeft to the start of the next line of the image, in
+ * the order they're stored in the file.  If the picture is interlaced,
+ * deal with the interlace as described in the GIF spec.
+ * Sets OutLeft to 0 once the whole image has been written.
+ */
+
+static void nextLine()
+{
+  static int passStart[4] = { 0, 4, 2, 1 };
+  static int passStep[4]  = { 8, 8, 4, 2 };
+
+  if (!Interlace) YC++;
+  else {
+    YC += passStep[Pass];
+    while (YC >= Height && Pass < 3) {    /* short images skip passes */
+      Pass++;
+      YC = passStart[Pass];
+    }
+  }
+
+  if (YC < Height) {
+    OutPtr  = pic8 + YC * Width;
+    OutLeft = Width;
+  }
+  else OutLeft = 0;
+}
+
+
+/* Write the string for 'code' (which is 'len' bytes long) to the output.
+ * If 'lastch' is non-negative, the string for 'code' is only len-1 bytes
+ * long, and 'lastch' gets tacked onto the end of it (the KwKwK case).
+ *
+ * The string is built back to front by walking the Prefix chain.  If it
+ * fits on the current output line, it's built right there.  Otherwise,
+ * it's built in a buffer and copied out a line at a time.
+ */
+
+static void putString(code, len, lastch)
+     int code, len, lastch;
+{
+  static byte strbuf[4097];
+  register byte *sp;
+  register int   c, n;
+
+  if (!OutLeft) return;          /* image is already full */
+
+  c = code;
+  if (len <= OutLeft) sp = OutPtr + len;
+                 else sp = strbuf + len;
+
+  if (lastch >= 0) *--sp = lastch;
+  while (c >= ClearCode) { *--sp = Suffix[c];  c = Prefix[c]; }
+  *--sp = Suffix[c];
+
+  if (len <= OutLeft) {
+    OutPtr += len;  OutLeft -= len;
+    if (!OutLeft) nextLine();
+    return;
+  }
+
+  /* string spans multiple lines (or runs off the end of the image) */
+  while (len && OutLeft) {
+    n = (len < OutLeft) ? len : OutLeft;
+    xvbcopy((char *) sp, (char *) OutPtr, (size_t) n);
+    sp += n;  len -= n;
+    OutPtr += n;  OutLeft -= n;
+    if (!OutLeft) nextLine();
+  }
+}
+
+
+
 /*****************************/
 static int gifError(pinfo, st)
      PICINFO *pinfo;
@@ -744,7 +1214,6 @@ static int gifError(pinfo, st)
   gifWarning(st);
 
   if (RawGIF != NULL) free(RawGIF);
-  if (Raster != NULL) free(Raster);
 
   if (pinfo->pic) free(pinfo->pic);
   if (pinfo->comment) free(pinfo->comment);
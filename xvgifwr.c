@@ -38,8 +38,6 @@
 
 #include "xv.h"
 
-typedef long int        count_int;
-
 static int  Width, Height;
 static int  curx, cury;
 static long CountDown;
@@ -50,10 +48,9 @@ static void putword     PARM((int, FILE *));
 static void compress    PARM((int, FILE *, byte *, int));
 static void output      PARM((int));
 static void cl_block    PARM((void));
-static void cl_hash     PARM((count_int));
 static void char_init   PARM((void));
-static void char_out    PARM((int));
 static void flush_char  PARM((void));
+static void flush_out   PARM((void));
 
 
 static byte pc2nc[256],r1[256],g1[256],b1[256];
@@ -236,19 +233,34 @@ FILE *fp;
 static unsigned long cur_accum = 0;
 static int           cur_bits = 0;
 
+/*
+ * Packets are built right in the output buffer, which is written out a
+ * few K at a time, rather than a packet at a time.  'a_packet' points to
+ * the current packet's count byte, 'a_next' to where its next byte goes.
+ */
 
+#define OBUFSIZE 8192
 
+static byte  obuf[OBUFSIZE + 256];
+static byte *a_packet, *a_next;
 
-#define min(a,b)        ((a>b) ? b : a)
+/*
+ * Number of characters so far in this 'packet'
+ */
+static int a_count;
 
-#define XV_BITS	12    /* BITS was already defined on some systems */
-#define MSDOS	1
+/*
+ * Add a character to the end of the current packet, and if it is 254
+ * characters, end the packet.
+ */
+#define char_out(c) \
+  { *a_next++ = (c);  if (++a_count >= 254) flush_char(); }
 
-#define HSIZE  5003            /* 80% occupancy */
 
-typedef unsigned char   char_type;
 
 
+#define XV_BITS	12    /* BITS was already defined on some systems */
+
 static int n_bits;                    /* number of bits/code */
 static int maxbits = XV_BITS;         /* user settable max # bits/code */
 static int maxcode;                   /* maximum code, given n_bits */
@@ -256,25 +268,19 @@ static int maxmaxcode = 1 << XV_BITS; /* NEVER generate this */
 
 #define MAXCODE(n_bits)     ( (1 << (n_bits)) - 1)
 
-static  count_int      htab [HSIZE];
-static  unsigned short codetab [HSIZE];
-#define HashTabOf(i)   htab[i]
-#define CodeTabOf(i)   codetab[i]
-
-static int hsize = HSIZE;            /* for dynamic table sizing */
-
 /*
- * To save much memory, we overlay the table used by compress() with those
- * used by decompress().  The tab_prefix table is the same size and type
- * as the codetab.  The tab_suffix table needs 2**BITS characters.  We
- * get this from the beginning of htab.  The output stack uses the rest
- * of htab, and contains characters.  There is plenty of room for any
- * possible stack (stack used to be 8000 characters).
+ * The string table.  Each string is a prefix string (a code) plus one more
+ * character.  childtab is indexed by (code << cshift) + character, and
+ * gives the code for that string, if it's in the table.  Rather than
+ * clearing childtab (up to 2 megs) every time the table fills up, its
+ * entries are checked against tab_prefix/tab_suffix, which are only
+ * valid for codes below free_ent.
  */
 
-#define tab_prefixof(i) CodeTabOf(i)
-#define tab_suffixof(i)        ((char_type *)(htab))[i]
-#define de_stack               ((char_type *)&tab_suffixof(1<<XV_BITS))
+static unsigned short  tab_prefix[1 << XV_BITS];
+static byte            tab_suffix[1 << XV_BITS];
+static unsigned short *childtab = (unsigned short *) NULL;
+static int             cshift;
 
 static int free_ent = 0;                  /* first unused entry */
 
@@ -284,23 +290,16 @@ static int free_ent = 0;                  /* first unused entry */
  */
 static int clear_flg = 0;
 
-static long int in_count = 1;            /* length of input */
-static long int out_count = 0;           /* # of codes output (for debugging) */
-
 /*
- * compress stdin to stdout
+ * compress pixels to GIF data
  *
- * Algorithm:  use open addressing double hashing (no chaining) on the 
- * prefix code / next character combination.  We do a variant of Knuth's
- * algorithm D (vol. 3, sec. 6.4) along with G. Knott's relatively-prime
- * secondary probe.  Here, the modular division first probe is gives way
- * to a faster exclusive-or manipulation.  Also do block compression with
- * an adaptive reset, whereby the code table is cleared when the compression
- * ratio decreases, but after the table fills.  The variable-length output
- * codes are re-sized at this point, and a special CLEAR code is generated
- * for the decompressor.  Late addition:  construct the table according to
- * file size for noticeable speed improvement on small files.  Please direct
- * questions about this implementation to ames!jaw.
+ * Algorithm:  the classic LZW scheme.  Walk down the string table for as
+ * long as the current string plus the next pixel is in it, then output
+ * the code for the current string, and add current string plus pixel to
+ * the table.  Finding the string is a single lookup in childtab.  When
+ * the table fills up, it's cleared, and a CLEAR code is generated for the
+ * decompressor.  The variable-length output codes are re-sized at this
+ * point.
  */
 
 static int g_init_bits;
@@ -317,13 +316,7 @@ FILE *outfile;
 byte *data;
 int   len;
 {
-  register long fcode;
-  register int i = 0;
-  register int c;
-  register int ent;
-  register int disp;
-  register int hsize_reg;
-  register int hshift;
+  register int c, ent, code, idx;
 
   /*
    * Set up the globals:  g_init_bits - initial number of bits
@@ -332,16 +325,17 @@ int   len;
   g_init_bits = init_bits;
   g_outfile   = outfile;
 
+  /* the child table is big, so only get it when first needed.  It doesn't
+     need to be initialized (see above), but do it once, to be tidy */
+  if (!childtab) {
+    childtab = (unsigned short *) calloc((size_t) (1 << (XV_BITS + 8)),
+					 sizeof(unsigned short));
+    if (!childtab) FatalError("Unable to malloc in WriteGIF()");
+  }
+
   /* initialize 'compress' globals */
   maxbits = XV_BITS;
   maxmaxcode = 1<<XV_BITS;
-  xvbzero((char *) htab,    sizeof(htab));
-  xvbzero((char *) codetab, sizeof(codetab));
-  hsize = HSIZE;
-  free_ent = 0;
-  clear_flg = 0;
-  in_count = 1;
-  out_count = 0;
   cur_accum = 0;
   cur_bits = 0;
 
@@ -349,75 +343,46 @@ int   len;
   /*
    * Set up the necessary values
    */
-  out_count = 0;
   clear_flg = 0;
-  in_count = 1;
   maxcode = MAXCODE(n_bits = g_init_bits);
 
   ClearCode = (1 << (init_bits - 1));
   EOFCode = ClearCode + 1;
   free_ent = ClearCode + 2;
+  cshift = init_bits - 1;        /* pixels are all less than ClearCode */
 
   char_init();
   ent = pc2nc[*data++];  len--;
 
-  hshift = 0;
-  for ( fcode = (long) hsize;  fcode < 65536L; fcode *= 2L )
-    hshift++;
-  hshift = 8 - hshift;                /* set hash code range bound */
-
-  hsize_reg = hsize;
-  cl_hash( (count_int) hsize_reg);            /* clear hash table */
-
   output(ClearCode);
     
   while (len) {
     c = pc2nc[*data++];  len--;
-    in_count++;
 
-    fcode = (long) ( ( (long) c << maxbits) + ent);
-    i = (((int) c << hshift) ^ ent);    /* xor hashing */
-
-    if ( HashTabOf (i) == fcode ) {
-      ent = CodeTabOf (i);
+    idx  = (ent << cshift) + c;
+    code = childtab[idx];
+    if (code > EOFCode && code < free_ent &&
+	tab_prefix[code] == ent && tab_suffix[code] == c) {
+      ent = code;
       continue;
     }
 
-    else if ( (long)HashTabOf (i) < 0 )      /* empty slot */
-      goto nomatch;
-
-    disp = hsize_reg - i;           /* secondary hash (after G. Knott) */
-    if ( i == 0 )
-      disp = 1;
-
-probe:
-    if ( (i -= disp) < 0 )
-      i += hsize_reg;
-
-    if ( HashTabOf (i) == fcode ) {
-      ent = CodeTabOf (i);
-      continue;
-    }
-
-    if ( (long)HashTabOf (i) >= 0 ) 
-      goto probe;
-
-nomatch:
     output(ent);
-    out_count++;
-    ent = c;
 
     if ( free_ent < maxmaxcode ) {
-      CodeTabOf (i) = free_ent++; /* code -> hashtable */
-      HashTabOf (i) = fcode;
+      childtab[idx]        = free_ent;      /* add string to the table */
+      tab_prefix[free_ent] = ent;
+      tab_suffix[free_ent] = c;
+      free_ent++;
     }
     else
       cl_block();
+
+    ent = c;
   }
 
   /* Put out the final code */
   output(ent);
-  out_count++;
   output(EOFCode);
 }
 
@@ -434,27 +399,15 @@ nomatch:
  * Assumptions:
  *      Chars are 8 bits long.
  * Algorithm:
- *      Maintain a BITS character long buffer (so that 8 codes will
- * fit in it exactly).  Use the VAX insv instruction to insert each
- * code in turn.  When the buffer fills up empty it and start over.
+ *      Codes are added to the top of a bit accumulator, and whole
+ * bytes are taken off the bottom of it, and added to the current
+ * packet (see char_out()).
  */
 
-static
-unsigned long masks[] = { 0x0000, 0x0001, 0x0003, 0x0007, 0x000F,
-                                  0x001F, 0x003F, 0x007F, 0x00FF,
-                                  0x01FF, 0x03FF, 0x07FF, 0x0FFF,
-                                  0x1FFF, 0x3FFF, 0x7FFF, 0xFFFF };
-
 static void output(code)
 int code;
 {
-  cur_accum &= masks[cur_bits];
-
-  if (cur_bits > 0)
-    cur_accum |= ((long)code << cur_bits);
-  else
-    cur_accum = code;
-	
+  cur_accum |= ((unsigned long) code << cur_bits);
   cur_bits += n_bits;
 
   while( cur_bits >= 8 ) {
@@ -492,6 +445,7 @@ int code;
     }
 
     flush_char();
+    flush_out();
 	
     fflush( g_outfile );
 
@@ -506,9 +460,9 @@ int code;
 /********************************/
 static void cl_block ()             /* table clear for block compress */
 {
-  /* Clear out the hash table */
+  /* Clear out the string table.  (Just forgetting about the old codes
+     is enough, see above) */
 
-  cl_hash ( (count_int) hsize );
   free_ent = ClearCode + 2;
   clear_flg = 1;
 
@@ -516,84 +470,43 @@ static void cl_block ()             /* table clear for block compress */
 }
 
 
-/********************************/
-static void cl_hash(hsize)          /* reset code table */
-register count_int hsize;
-{
-  register count_int *htab_p = htab+hsize;
-  register long i;
-  register long m1 = -1;
-
-  i = hsize - 16;
-  do {                            /* might use Sys V memset(3) here */
-    *(htab_p-16) = m1;
-    *(htab_p-15) = m1;
-    *(htab_p-14) = m1;
-    *(htab_p-13) = m1;
-    *(htab_p-12) = m1;
-    *(htab_p-11) = m1;
-    *(htab_p-10) = m1;
-    *(htab_p-9) = m1;
-    *(htab_p-8) = m1;
-    *(htab_p-7) = m1;
-    *(htab_p-6) = m1;
-    *(htab_p-5) = m1;
-    *(htab_p-4) = m1;
-    *(htab_p-3) = m1;
-    *(htab_p-2) = m1;
-    *(htab_p-1) = m1;
-    htab_p -= 16;
-  } while ((i -= 16) >= 0);
-
-  for ( i += 16; i > 0; i-- )
-    *--htab_p = m1;
-}
-
-
 /******************************************************************************
  *
  * GIF Specific routines
  *
  ******************************************************************************/
 
-/*
- * Number of characters so far in this 'packet'
- */
-static int a_count;
-
 /*
  * Set up the 'byte output' routine
  */
 static void char_init()
 {
-	a_count = 0;
+  a_count  = 0;
+  a_packet = obuf;
+  a_next   = obuf + 1;
 }
 
 /*
- * Define the storage for the packet accumulator
+ * End the packet, and start a new one.  If the buffer's full, write it out
  */
-static char accum[ 256 ];
-
-/*
- * Add a character to the end of the current packet, and if it is 254
- * characters, flush the packet to disk.
- */
-static void char_out(c)
-int c;
+static void flush_char()
 {
-  accum[ a_count++ ] = c;
-  if( a_count >= 254 ) 
-    flush_char();
+  if( a_count > 0 ) {
+    *a_packet = a_count;
+    a_packet  = a_next++;
+    a_count   = 0;
+    if (a_packet - obuf >= OBUFSIZE) flush_out();
+  }
 }
 
 /*
- * Flush the packet to disk, and reset the accumulator
+ * Write out all the finished packets.  Only called between packets.
  */
-static void flush_char()
+static void flush_out()
 {
-  if( a_count > 0 ) {
-    fputc(a_count, g_outfile );
-    fwrite(accum, (size_t) 1, (size_t) a_count, g_outfile );
-    a_count = 0;
-  }
-}	
+  if (a_packet > obuf)
+    fwrite(obuf, (size_t) 1, (size_t) (a_packet - obuf), g_outfile);
+
+  a_packet = obuf;
+  a_next   = obuf + 1;
+}
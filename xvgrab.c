@@ -7,6 +7,16 @@
  *     int Grab()             - handles the GRAB command
  *     int LoadGrab();        - 'loads' the pic from the last succesful Grab
  *            
+ *  A 'Repeat' grab keeps grabbing the same rectangle every 'grabInterval'
+ *  ms, until a mouse button is pressed.  The frames go into a ring of
+ *  'grabFrames' buffers, allocated up front, and the XImage is refilled in
+ *  place, so nothing is allocated per frame.  LoadGrab() hands the ring to
+ *  openPic() as the pages of the grabbed image, oldest first, and if
+ *  'grabSave' is set, each frame is written out as a PPM (or PGM) file.
+ *
+ *  If DOSHM is defined, grabs of the local display are done through the
+ *  MIT shared memory extension, rather than having the server send the
+ *  image down the wire.
  */
 
 #include "copyright.h"
@@ -14,12 +24,19 @@
 #define NEEDSTIME
 #include "xv.h"
 
+#ifdef DOSHM
+#  include <sys/ipc.h>
+#  include <sys/shm.h>
+#  include <X11/extensions/XShm.h>
+#endif
+
 static byte *grabPic = (byte *) NULL;
 static int  gbits;                              /* either '8' or '24' */
 static byte grabmapR[256], grabmapG[256], grabmapB[256];  /* colormap */
 static int  gWIDE,gHIGH;
 static int  grabInProgress=0;
 static int  hidewins = 0;
+static int  repeat = 0;
 static GC   rootGC;
 
 static void   flashrect       PARM((int, int, int, int, int));
@@ -30,9 +47,48 @@ static void   ungrabX         PARM((void));
 static int    convertImage    PARM((XImage *, XColor *, int, 
 				    XWindowAttributes *));
 
+static XImage *getImage        PARM((Window, int, int, int, int, 
+				    XWindowAttributes *));
+static void   freeImage       PARM((XImage *));
+static int    convertFast     PARM((XImage *, XColor *, int, Visual *));
 static int    lowbitnum       PARM((unsigned long));
 static int    getxcolors      PARM((XWindowAttributes *, XColor **));
 static Window xvClientWindow  PARM((Display *, Window));
+static int    grabErrHandler  PARM((Display *, XErrorEvent *));
+
+static int    grabError;                    /* set by grabErrHandler() */
+
+#ifdef DOSHM
+static XImage *shmGetImage    PARM((Window, int, int, int, int, 
+				    XWindowAttributes *));
+
+static XShmSegmentInfo shmInfo;
+static XImage *shmImage = (XImage *) NULL;  /* the image that uses it */
+static int     shmFailed = 0;               /* don't bother trying again */
+#endif
+
+
+/* the frames of a 'Repeat' grab */
+#define GRAB_CACHE  (256L * 1024L * 1024L)   /* max bytes of frames kept */
+
+typedef struct {
+  int    nslots;             /* size of the ring */
+  int    nframes;            /* # of frames grabbed (last 'nslots' are kept) */
+  int    w, h, bits;         /* size of every frame, and its gbits */
+  byte **pic;                /* the frames */
+  byte  *cmap;               /* r[256],g[256],b[256] of each, if 8-bit */
+} GRABSEQ;
+
+static GRABSEQ *grabSeq = (GRABSEQ *) NULL;  /* frames of the last Grab */
+
+static int      repeatGrab    PARM((Window, int, int, int, int));
+static int      regetImage    PARM((XImage *, Window, int, int));
+static GRABSEQ *seqAlloc      PARM((int));
+static void     seqFree       PARM((GRABSEQ *));
+static void     seqSave       PARM((GRABSEQ *));
+static int      seqSlot       PARM((GRABSEQ *, int));
+static int      seqPage       PARM((PAGESRC *, int, PICINFO *));
+static void     seqPageFree   PARM((PAGESRC *));
 
 
 
@@ -55,7 +111,7 @@ int Grab()
   if (grabInProgress) return 0;      /* avoid recursive grabs during delay */
 
   /* do the dialog box thing */
-  i = GrabPopUp(&hidewins, &grabDelay);
+  i = GrabPopUp(&hidewins, &grabDelay, &repeat);
   if (i==2) return 0;    /* cancelled */
   autograb = (i==1);
 
@@ -97,6 +153,7 @@ int Grab()
   if (grabPic) {  /* throw away previous 'grabbed' pic, if there is one */
     free(grabPic);  grabPic = (byte *) NULL;
   }
+  seqFree(grabSeq);  grabSeq = (GRABSEQ *) NULL;
 
 
   fc.flags = bc.flags = DoRed | DoGreen | DoBlue;
@@ -324,6 +381,8 @@ int Grab()
 
   SetCursors(-1);
 
+  if (rv && repeat) rv = repeatGrab(clickWin,ix,iy,iw,ih);
+
 
  exit:
 
@@ -445,10 +504,8 @@ static int grabImage(clickWin, x, y, w, h)
 
   XTranslateCoordinates(theDisp, rootW, clickWin, x, y, &ix, &iy, &win);
 
-  xerrcode = 0;
-  image = XGetImage(theDisp, clickWin, ix, iy, (u_int) w, (u_int) h, 
-		    AllPlanes, ZPixmap);
-  if (xerrcode || !image || !image->data) {
+  image = getImage(clickWin, ix, iy, w, h, &xwa);
+  if (!image) {
     sprintf(str, "Unable to get image (%d,%d %dx%d) from display", ix,iy,w,h);
     ungrabX();
     ErrPopUp(str, "\nThat Sucks!");
@@ -473,9 +530,7 @@ static int grabImage(clickWin, x, y, w, h)
 
   i = convertImage(image, colors, ncolors, &xwa);
 
-  /* DO *NOT* use xvDestroyImage(), as the 'data' field was alloc'd by X, not
-     necessarily through 'malloc() / free()' */
-  XDestroyImage(image);   
+  freeImage(image);
   
   if (colors) free((char *) colors);
 
@@ -490,6 +545,401 @@ static void ungrabX()
 }
 
 
+/***********************************/
+static XImage *getImage(win, x, y, w, h, xwap)
+     Window win;
+     int    x, y, w, h;
+     XWindowAttributes *xwap;
+{
+  /* gets the w*h rectangle at x,y in 'win' as a ZPixmap XImage, or
+     returns NULL.  The image should be freed with freeImage() */
+
+  XImage *image;
+
+#ifdef DOSHM
+  image = shmGetImage(win, x, y, w, h, xwap);
+  if (image) return image;
+#endif
+
+  xerrcode = 0;
+  image = XGetImage(theDisp, win, x, y, (u_int) w, (u_int) h, 
+		    AllPlanes, ZPixmap);
+  if (xerrcode || !image || !image->data) {
+    if (image) XDestroyImage(image);
+    return (XImage *) NULL;
+  }
+  return image;
+}
+
+
+/***********************************/
+static void freeImage(image)
+     XImage *image;
+{
+#ifdef DOSHM
+  if (image == shmImage) {
+    XShmDetach(theDisp, &shmInfo);
+    XSync(theDisp, False);
+    shmdt(shmInfo.shmaddr);
+    image->data = (char *) NULL;
+    XDestroyImage(image);
+    shmImage = (XImage *) NULL;
+    return;
+  }
+#endif
+
+  /* DO *NOT* use xvDestroyImage(), as the 'data' field was alloc'd by X, not
+     necessarily through 'malloc() / free()' */
+  XDestroyImage(image);
+}
+
+
+#ifdef DOSHM
+/***********************************/
+static XImage *shmGetImage(win, x, y, w, h, xwap)
+     Window win;
+     int    x, y, w, h;
+     XWindowAttributes *xwap;
+{
+  /* getImage() through a shared memory segment.  Returns NULL if the
+     server doesn't do MIT-SHM, or can't (ie, it's not on this machine) */
+
+  XImage *image;
+  XErrorHandler oldhandler;
+
+  if (shmFailed || shmImage) return (XImage *) NULL;
+  if (!XShmQueryExtension(theDisp)) { shmFailed = 1;  return (XImage *) NULL; }
+
+  image = XShmCreateImage(theDisp, xwap->visual, (u_int) xwap->depth, 
+			  ZPixmap, (char *) NULL, &shmInfo, (u_int) w, (u_int) h);
+  if (!image) return (XImage *) NULL;
+
+  shmInfo.shmid = shmget(IPC_PRIVATE, 
+			 (size_t) image->bytes_per_line * image->height,
+			 IPC_CREAT | 0600);
+  if (shmInfo.shmid < 0) {
+    XDestroyImage(image);
+    return (XImage *) NULL;
+  }
+
+  shmInfo.shmaddr = image->data = (char *) shmat(shmInfo.shmid, (char *) 0, 0);
+  if (shmInfo.shmaddr == (char *) -1) {
+    shmctl(shmInfo.shmid, IPC_RMID, (struct shmid_ds *) NULL);
+    image->data = (char *) NULL;
+    XDestroyImage(image);
+    return (XImage *) NULL;
+  }
+  shmInfo.readOnly = False;
+
+  /* a remote server can't attach the segment, and says so with an X error.
+     Catch it here, rather than in xvevent.c's handler, which would quit */
+
+  grabError = 0;
+  oldhandler = XSetErrorHandler(grabErrHandler);
+  XShmAttach(theDisp, &shmInfo);
+  XSync(theDisp, False);
+
+  /* the segment goes away when both of us have detached it */
+  shmctl(shmInfo.shmid, IPC_RMID, (struct shmid_ds *) NULL);
+
+  if (!grabError) {
+    XShmGetImage(theDisp, win, image, x, y, AllPlanes);
+    XSync(theDisp, False);
+    if (grabError) XShmDetach(theDisp, &shmInfo);
+  }
+  else shmFailed = 1;
+
+  XSync(theDisp, False);
+  XSetErrorHandler(oldhandler);
+
+  if (grabError) {
+    if (DEBUG) fprintf(stderr,"shmGetImage: X error %d\n", grabError);
+    shmdt(shmInfo.shmaddr);
+    image->data = (char *) NULL;
+    XDestroyImage(image);
+    return (XImage *) NULL;
+  }
+
+  shmImage = image;
+  return image;
+}
+#endif /* DOSHM */
+
+
+/***********************************/
+static int grabErrHandler(disp, err)
+     Display     *disp;
+     XErrorEvent *err;
+{
+  /* X errors that we're expecting (a remote server can't attach our shared
+     memory, the window being grabbed goes away) end up here, rather than
+     in xvevent.c's handler, which would quit */
+
+  grabError = err->error_code;
+  return 0;
+}
+
+
+/***********************************/
+static int regetImage(image, win, x, y)
+     XImage *image;
+     Window  win;
+     int     x, y;
+{
+  /* refills 'image' (from getImage()) with what's at x,y in 'win' now.
+     Returns '0' on an X error */
+
+  XErrorHandler oldhandler;
+
+  grabError = 0;
+  oldhandler = XSetErrorHandler(grabErrHandler);
+
+#ifdef DOSHM
+  if (image == shmImage) XShmGetImage(theDisp, win, image, x, y, AllPlanes);
+  else
+#endif
+    XGetSubImage(theDisp, win, x, y, (u_int) image->width, 
+		 (u_int) image->height, AllPlanes, ZPixmap, image, 0, 0);
+
+  XSync(theDisp, False);
+  XSetErrorHandler(oldhandler);
+  return (grabError == 0);
+}
+
+
+/***********************************/
+static int repeatGrab(clickWin, x, y, w, h)
+     Window clickWin;
+     int    x, y, w, h;
+{
+  /* called once grabImage() has grabbed the first frame (into grabPic).
+     Keeps grabbing the same rectangle every 'grabInterval' ms, until a
+     mouse button is pressed, keeping the last 'grabFrames' frames in
+     grabSeq.  Returns '1' (there's at least the first frame) */
+
+  XImage *image;
+  XWindowAttributes xwa;
+  XColor *colors;
+  XErrorHandler oldhandler;
+  GRABSEQ *gs;
+  Window win, rW, cW;
+  struct timeval due, now;
+  int    i, n, ix, iy, rx, ry, wx, wy, ncolors, slot;
+  long   ms;
+  unsigned int mask;
+
+  if (x<0) { w += x;  x = 0; }
+  if (y<0) { h += y;  y = 0; }
+  if (x+w>dispWIDE) w = dispWIDE-x;
+  if (y+h>dispHIGH) h = dispHIGH-y;
+
+  if (!XGetWindowAttributes(theDisp, clickWin, &xwa)) return 1;
+  XTranslateCoordinates(theDisp, rootW, clickWin, x, y, &ix, &iy, &win);
+
+  n = grabFrames;
+  if (n > GRAB_CACHE / ((long) gWIDE * gHIGH * (gbits/8)))
+    n = GRAB_CACHE / ((long) gWIDE * gHIGH * (gbits/8));
+
+  gs = (n > 1) ? seqAlloc(n) : (GRABSEQ *) NULL;
+  if (!gs) {
+    ErrPopUp("Not enough memory to keep a sequence of grabbed frames.",
+	     "\nBummer!");
+    return 1;
+  }
+
+  /* the frame that grabImage() got is the first one */
+  free(gs->pic[0]);
+  gs->pic[0] = grabPic;  grabPic = (byte *) NULL;
+  for (i=0; gs->bits==8 && i<256; i++) {
+    gs->cmap[i] = grabmapR[i];  gs->cmap[256+i] = grabmapG[i];
+    gs->cmap[512+i] = grabmapB[i];
+  }
+  gs->nframes = 1;
+
+  image = getImage(clickWin, ix, iy, w, h, &xwa);
+  ncolors = (image) ? getxcolors(&xwa, &colors) : 0;
+
+  /* a button press stops it.  Grab the buttons, so that the click doesn't
+     go to whatever window happens to be under the pointer */
+  XGrabButton(theDisp, (u_int) AnyButton, 0, rootW, False, 0, 
+	      GrabModeAsync, GrabModeAsync, None, tcross);
+
+  gettimeofday(&due, (struct timezone *) NULL);
+
+  while (image) {
+    if (XQueryPointer(theDisp,rootW,&rW,&cW,&rx,&ry,&wx,&wy,&mask) &&
+	(mask & (Button1Mask | Button2Mask | Button3Mask))) break;
+
+    /* wait for the next frame, keeping an eye on the buttons */
+    due.tv_usec += (long) grabInterval * 1000L;
+    while (due.tv_usec >= 1000000L) { due.tv_sec++;  due.tv_usec -= 1000000L; }
+
+    gettimeofday(&now, (struct timezone *) NULL);
+    ms = (due.tv_sec - now.tv_sec) * 1000L + (due.tv_usec-now.tv_usec)/1000L;
+    while (ms > 0) {
+      Timer((ms > 50) ? 50 : (int) ms);
+      if (XQueryPointer(theDisp,rootW,&rW,&cW,&rx,&ry,&wx,&wy,&mask) &&
+	  (mask & (Button1Mask | Button2Mask | Button3Mask))) break;
+      gettimeofday(&now, (struct timezone *) NULL);
+      ms = (due.tv_sec-now.tv_sec)*1000L + (due.tv_usec-now.tv_usec)/1000L;
+    }
+    if (ms > 0) break;                           /* button pressed */
+    if (ms < -grabInterval) due = now;           /* fell behind.  catch up */
+
+    if (!regetImage(image, clickWin, ix, iy)) break;  /* window's gone? */
+
+    if (ncolors) {     /* writable colormaps can change from frame to frame */
+      grabError = 0;
+      oldhandler = XSetErrorHandler(grabErrHandler);
+      XQueryColors(theDisp, xwa.colormap, colors, ncolors);
+      XSync(theDisp, False);
+      XSetErrorHandler(oldhandler);
+      if (grabError) break;
+    }
+
+    slot = gs->nframes % gs->nslots;
+    grabPic = gs->pic[slot];
+    i = convertImage(image, colors, ncolors, &xwa);
+    grabPic = (byte *) NULL;
+    if (!i) break;
+
+    for (i=0; gs->bits==8 && i<256; i++) {
+      gs->cmap[slot*768 + i]     = grabmapR[i];
+      gs->cmap[slot*768 + 256+i] = grabmapG[i];
+      gs->cmap[slot*768 + 512+i] = grabmapB[i];
+    }
+    gs->nframes++;
+  }
+
+  while (1) {      /* wait for the button to be released */
+    if (XQueryPointer(theDisp,rootW,&rW,&cW,&rx,&ry,&wx,&wy,&mask) &&
+	!(mask & (Button1Mask | Button2Mask | Button3Mask))) break;
+    Timer(20);
+  }
+  XUngrabButton(theDisp, (u_int) AnyButton, 0, rootW);
+
+  XBell(theDisp, 0);
+  XBell(theDisp, 0);
+
+  if (image) freeImage(image);
+  if (ncolors) free((char *) colors);
+
+  grabSeq = gs;
+  if (grabSave) seqSave(gs);
+  return 1;
+}
+
+
+/***********************************/
+static GRABSEQ *seqAlloc(nslots)
+     int nslots;
+{
+  /* allocates a ring of 'nslots' frames, of the size (and depth) that
+     convertImage() last produced.  Returns NULL if there isn't the memory */
+
+  GRABSEQ *gs;
+  int      i;
+
+  gs = (GRABSEQ *) calloc((size_t) 1, sizeof(GRABSEQ));
+  if (!gs) return (GRABSEQ *) NULL;
+
+  gs->nslots = nslots;  gs->w = gWIDE;  gs->h = gHIGH;  gs->bits = gbits;
+  gs->pic  = (byte **) calloc((size_t) nslots, sizeof(byte *));
+  gs->cmap = (byte *)  malloc((size_t) nslots * 768);
+  if (!gs->pic || !gs->cmap) { seqFree(gs);  return (GRABSEQ *) NULL; }
+
+  for (i=0; i<nslots; i++) {
+    gs->pic[i] = (byte *) malloc((size_t) gWIDE * gHIGH * (gbits/8));
+    if (!gs->pic[i]) { seqFree(gs);  return (GRABSEQ *) NULL; }
+  }
+
+  return gs;
+}
+
+
+/***********************************/
+static void seqFree(gs)
+     GRABSEQ *gs;
+{
+  int i;
+
+  if (!gs) return;
+  if (gs->pic) {
+    for (i=0; i<gs->nslots; i++) if (gs->pic[i]) free(gs->pic[i]);
+    free(gs->pic);
+  }
+  if (gs->cmap) free(gs->cmap);
+  free(gs);
+}
+
+
+/***********************************/
+static int seqSlot(gs, n)
+     GRABSEQ *gs;
+     int      n;
+{
+  /* returns the slot that frame #n (0 = the oldest one kept) is in */
+
+  if (gs->nframes <= gs->nslots) return n;
+  return (gs->nframes + n) % gs->nslots;
+}
+
+
+/***********************************/
+static void seqSave(gs)
+     GRABSEQ *gs;
+{
+  /* writes each frame out as a raw PPM file, named by using grabSave as
+     a printf() format, with the frame number (1..n) */
+
+  FILE *fp;
+  char  fname[MAXPATHLEN+1], *sp;
+  int   i, n, nfmt, slot, rv;
+  byte *cm;
+
+  /* grabSave has to have exactly one %d in it (maybe with a width) */
+  for (sp=grabSave, nfmt=0; *sp; sp++) {
+    if (*sp != '%') continue;
+    sp++;
+    if (*sp == '%') continue;
+    while (*sp >= '0' && *sp <= '9') sp++;
+    nfmt += (*sp == 'd') ? 1 : 2;
+    if (!*sp) break;
+  }
+
+  if (nfmt != 1 || strlen(grabSave) > (size_t) MAXPATHLEN - 20) {
+    SetISTR(ISTR_WARNING, "'grabSave' needs one '%%d' in it, for the frame #");
+    return;
+  }
+
+  n = (gs->nframes < gs->nslots) ? gs->nframes : gs->nslots;
+  WaitCursor();
+
+  for (i=0; i<n; i++) {
+    sprintf(fname, grabSave, i+1);
+    slot = seqSlot(gs, i);
+    cm   = gs->cmap + slot*768;
+
+    fp = fopen(fname, "w");
+    if (!fp) {
+      SetISTR(ISTR_WARNING, "Can't write '%s':  %s", fname, ERRSTR(errno));
+      break;
+    }
+
+    rv = WritePBM(fp, gs->pic[slot], (gs->bits == 8) ? PIC8 : PIC24, 
+		  gs->w, gs->h, cm, cm+256, cm+512, 256, F_FULLCOLOR, 1,
+		  (char *) NULL);
+
+    if (fclose(fp) == EOF || rv) {
+      SetISTR(ISTR_WARNING, "Error writing '%s'.", fname);
+      break;
+    }
+  }
+
+  SetCursors(-1);
+}
+
+
 
 
 
@@ -589,13 +1039,15 @@ static int convertImage(image, colors, ncolors, xwap)
   /* build the 'global' grabPic stuff */
   gWIDE = image->width;  gHIGH = image->height;
 
+  /* (repeatGrab() puts the frame it wants filled in grabPic) */
+
   if (visual->class == TrueColor || visual->class == DirectColor ||
       ncolors > 256) {
-    grabPic = (byte *) malloc((size_t) gWIDE * gHIGH * 3);
+    if (!grabPic) grabPic = (byte *) malloc((size_t) gWIDE * gHIGH * 3);
     gbits = 24;
   }
   else {
-    grabPic = (byte *) malloc((size_t) gWIDE * gHIGH);
+    if (!grabPic) grabPic = (byte *) malloc((size_t) gWIDE * gHIGH);
     gbits = 8;
 
     /* load up the colormap */
@@ -609,6 +1061,8 @@ static int convertImage(image, colors, ncolors, xwap)
   if (!grabPic) FatalError("unable to malloc grabPic in convertImage()");
   pptr = grabPic;
 
+  if (convertFast(image, colors, ncolors, visual)) return 1;
+
 
   if (visual->class == TrueColor || visual->class == DirectColor) {
     unsigned int tmp;
@@ -760,6 +1214,135 @@ static int convertImage(image, colors, ncolors, xwap)
 
 
 
+/**************************************/
+static int convertFast(image, colors, ncolors, visual)
+     XImage *image;
+     XColor *colors;
+     int     ncolors;
+     Visual *visual;
+{
+  /* the usual case:  a ZPixmap with 8, 16, 24, or 32 bits per pixel.
+     Pixels are picked up a whole byte at a time, and turned into colors
+     through lookup tables.  (32-bit TrueColor with 8-bit channels is just
+     bytes being shuffled around.)  Fills in grabPic the same way the code
+     in convertImage() would, and returns '1', or returns '0' if it's an
+     image it doesn't do */
+
+  byte   *tab[3], *lp, *pp;
+  CARD32  mask[3], v;
+  int     shift[3], size[3], off[3];
+  int     i, j, k, c, bpp, lsb, ok, n, tc;
+  unsigned int t;
+
+  bpp = image->bits_per_pixel;
+  if (image->format != ZPixmap || image->xoffset != 0) return 0;
+  if (bpp != 8 && bpp != 16 && bpp != 24 && bpp != 32) return 0;
+  if (image->bitmap_bit_order != image->byte_order &&
+      image->bitmap_unit != bpp) return 0;
+
+  lsb = (image->byte_order == LSBFirst);
+  tc  = (visual->class == TrueColor || visual->class == DirectColor);
+  tab[0] = tab[1] = tab[2] = (byte *) NULL;
+
+  if (tc) {
+    mask[0] = image->red_mask;
+    mask[1] = image->green_mask;
+    mask[2] = image->blue_mask;
+
+    for (c=0; c<3; c++) {
+      shift[c] = lowbitnum((unsigned long) mask[c]);
+      if (shift[c] < 0) return 0;
+      size[c] = (mask[c] >> shift[c]) + 1;
+      if (size[c] > 65536) return 0;
+    }
+
+    /* 32-bit pixels, 8-bit channels:  no tables needed */
+    if (bpp == 32 && visual->class == TrueColor &&
+	(mask[0] >> shift[0]) == 0xff && (mask[1] >> shift[1]) == 0xff &&
+	(mask[2] >> shift[2]) == 0xff && !(shift[0]&7) && !(shift[1]&7) &&
+	!(shift[2]&7)) {
+      for (c=0; c<3; c++) off[c] = (lsb) ? shift[c]/8 : 3 - shift[c]/8;
+
+      for (i=0, pp=grabPic; i<image->height; i++) {
+	lp = (byte *) image->data + i * image->bytes_per_line;
+	for (j=0; j<image->width; j++, lp+=4, pp+=3) {
+	  pp[0] = lp[off[0]];  pp[1] = lp[off[1]];  pp[2] = lp[off[2]];
+	}
+      }
+      return 1;
+    }
+
+    /* channel value -> 0..255, the same as convertImage() does it */
+    for (c=0; c<3; c++) {
+      tab[c] = (byte *) malloc((size_t) size[c]);
+      if (!tab[c]) break;
+
+      if (visual->class == DirectColor) {
+	for (k=0; k<size[c]; k++) {
+	  if (k >= ncolors) tab[c][k] = 0;
+	  else tab[c][k] = ((c==0) ? colors[k].red : (c==1) ? colors[k].green
+			    : colors[k].blue) >> 8;
+	}
+      }
+      else {
+	n = 0;  t = size[c] - 1;
+	while (t >= 256) { t >>= 1;  n -= 1; }
+	while (t < 128)  { t <<= 1;  n += 1; }
+	for (k=0; k<size[c]; k++) 
+	  tab[c][k] = (n >= 0) ? (k << n) : (k >> (-n));
+      }
+    }
+  }
+
+  else if (gbits == 24) {     /* lots of colors, via the colormap */
+    for (c=0; c<3; c++) {
+      tab[c] = (byte *) malloc((size_t) ncolors);
+      if (!tab[c]) break;
+      for (k=0; k<ncolors; k++) 
+	tab[c][k] = ((c==0) ? colors[k].red : (c==1) ? colors[k].green 
+		     : colors[k].blue) >> 8;
+    }
+  }
+
+  ok = (gbits == 8 || (tab[0] && tab[1] && tab[2]));
+
+  for (i=0, pp=grabPic; ok && i<image->height; i++) {
+    lp = (byte *) image->data + i * image->bytes_per_line;
+
+    for (j=0; j<image->width; j++) {
+      switch (bpp) {
+      case 8:   v = *lp++;  break;
+      case 16:  v = (lsb) ? (lp[0] | (lp[1]<<8)) : ((lp[0]<<8) | lp[1]);
+		lp += 2;  break;
+      case 24:  v = (lsb) ? (lp[0] | (lp[1]<<8) | (lp[2]<<16))
+		          : ((lp[0]<<16) | (lp[1]<<8) | lp[2]);
+		lp += 3;  break;
+      default:  v = (lsb) ? 
+		  (lp[0] | (lp[1]<<8) | (lp[2]<<16) | ((CARD32) lp[3]<<24)) :
+		  (((CARD32) lp[0]<<24) | (lp[1]<<16) | (lp[2]<<8) | lp[3]);
+		lp += 4;  break;
+      }
+
+      if (tc) {
+	*pp++ = tab[0][(v & mask[0]) >> shift[0]];
+	*pp++ = tab[1][(v & mask[1]) >> shift[1]];
+	*pp++ = tab[2][(v & mask[2]) >> shift[2]];
+      }
+      else {
+	if (v >= ncolors) FatalError("convertImage(): pixvalue >= ncolors");
+	if (gbits == 24) {
+	  *pp++ = tab[0][v];  *pp++ = tab[1][v];  *pp++ = tab[2][v];
+	}
+	else *pp++ = (byte) v;
+      }
+    }
+  }
+
+  for (c=0; c<3; c++) if (tab[c]) free(tab[c]);
+  return ok;
+}
+
+
 /**************************************/
 static int lowbitnum(ul)
      unsigned long ul;
@@ -851,7 +1434,25 @@ int LoadGrab(pinfo)
   /* loads up (into XV structures) last image successfully grabbed.
      returns '0' on failure, '1' on success */
 
-  int   i;
+  int      i;
+  PAGESRC *ps;
+
+  if (grabSeq) {            /* the frames of a 'Repeat' grab */
+    ps = (PAGESRC *) malloc(sizeof(PAGESRC));
+    if (!ps) FatalError("out of memory in LoadGrab()");
+
+    ps->npages = (grabSeq->nframes < grabSeq->nslots) ? grabSeq->nframes
+                                                      : grabSeq->nslots;
+    ps->load   = seqPage;
+    ps->free   = seqPageFree;
+    ps->data   = (char *) grabSeq;
+    grabSeq = (GRABSEQ *) NULL;
+
+    if (!seqPage(ps, 0, pinfo)) { seqPageFree(ps);  return 0; }
+    if (ps->npages > 1) pinfo->pages = ps;
+                   else seqPageFree(ps);
+    return 1;
+  }
 
   if (!grabPic) return 0;   /* no image to use */
 
@@ -885,6 +1486,61 @@ int LoadGrab(pinfo)
 }
 
 
+/***********************************/
+static int seqPage(ps, n, pinfo)
+     PAGESRC *ps;
+     int      n;
+     PICINFO *pinfo;
+{
+  /* the PAGESRC 'load' function for a 'Repeat' grab:  'loads' frame #n */
+
+  GRABSEQ *gs;
+  int      i, slot;
+  size_t   size;
+
+  gs   = (GRABSEQ *) ps->data;
+  slot = seqSlot(gs, n);
+  size = (size_t) gs->w * gs->h * (gs->bits/8);
+
+  pinfo->pic = (byte *) malloc(size);
+  if (!pinfo->pic) return 0;
+  xvbcopy((char *) gs->pic[slot], (char *) pinfo->pic, size);
+
+  if (gs->bits == 24) pinfo->type = PIC24;
+  else {
+    pinfo->type = PIC8;
+    for (i=0; i<256; i++) {
+      pinfo->r[i] = gs->cmap[slot*768 + i];
+      pinfo->g[i] = gs->cmap[slot*768 + 256+i];
+      pinfo->b[i] = gs->cmap[slot*768 + 512+i];
+    }
+  }
+
+  pinfo->normw   = pinfo->w   = gs->w;
+  pinfo->normh   = pinfo->h   = gs->h;
+  pinfo->frmType = -1;
+  pinfo->colType = -1;
+
+  sprintf(pinfo->fullInfo,"<%s internal>, frame %d of %d (%d grabbed)", 
+	  (pinfo->type == PIC8) ? "8-bit" : "24-bit", n+1, ps->npages,
+	  gs->nframes);
+  
+  sprintf(pinfo->shrtInfo,"%dx%d image.", gs->w, gs->h);
+  
+  pinfo->comment = (char *) NULL;
+  return 1;
+}
+
+
+/***********************************/
+static void seqPageFree(ps)
+     PAGESRC *ps;
+{
+  seqFree((GRABSEQ *) ps->data);
+  free(ps);
+}
+
+
 
 
 
@@ -15,6 +15,8 @@
  *            void DrawEpic(void);
  *            byte *FSDither()
  *            void CreateXImage()
+ *            int  XImageFilled()
+ *            void FillXImage(x,y,w,h)
  *            void Set824Menus( pictype );
  *            void Change824Mode( pictype );
  *            int  DoPad(mode, str, wide, high, opaque, omode);
@@ -36,6 +38,7 @@ static void crop1             PARM((int, int, int, int, int));
 static int  doAutoCrop24      PARM((void));
 static void floydDitherize1   PARM((XImage *, byte *, int, int, int, 
 				    byte *, byte *,byte *));
+static void orderDitherize1   PARM((XImage *, byte *, int, int));
 static int  highbit           PARM((unsigned long));
 
 static int  doPadSolid        PARM((char *, int, int, int, int));
@@ -44,6 +47,7 @@ static int  doPadLoad         PARM((char *, int, int, int, int));
 
 static int  doPadPaste        PARM((byte *, int, int, int, int));
 static int  ReadImageFile1    PARM((char *, PICINFO *));
+static void killOrdFill       PARM((void));
 
 
 
@@ -51,6 +55,20 @@ static int  ReadImageFile1    PARM((char *, PICINFO *));
 #define DO_ZOOM 1
 
 
+/* when a 24-bit image is ordered-dithered onto an 8-bit colormapped
+   display, each pixel of theImage only depends on one pixel of egampic,
+   so theImage is dithered ORD_TILE x ORD_TILE pixels at a time, as parts
+   of it get drawn (see FillXImage()).  Parts of the window that are off
+   the screen never get done */
+
+#define ORD_TILE 64
+
+static int   ordOK   = 0;              /* set while CreateXImage() runs */
+static byte *ordPic  = (byte *) NULL;  /* where theImage's pixels come from */
+static byte *ordDone = (byte *) NULL;  /* which tiles of it have been done */
+static int   ordTW, ordTH;             /* # of tiles across, and down */
+
+
 /***********************************/
 void Resize(w,h)
 int w,h;
@@ -64,6 +82,8 @@ int w,h;
   /* if same size, and Ximage created, do nothing */
   if (w==eWIDE && h==eHIGH && theImage!=NULL) return;
 
+  AnimSync();   /* about to regenerate epic from cpic */
+
   if (DEBUG) fprintf(stderr,"Resize(%d,%d)  eSIZE=%d,%d  cSIZE=%d,%d\n",
 		     w,h,eWIDE,eHIGH,cWIDE,cHIGH);
 
@@ -528,6 +548,7 @@ void UnCrop()
 
   if (cpic == pic) return;     /* not cropped */
 
+  AnimSync();
   BTSetActive(&but[BUNCROP],0);
   
   if (epicMode == EM_SMOOTH) {   /* turn off smoothing */
@@ -599,6 +620,7 @@ int DoAutoCrop()
 
   ctop = cbot = cleft = cright = 0;
 
+  AnimSync();
   if (picType == PIC24) return( doAutoCrop24() );
 
   /* crop the top */
@@ -817,6 +839,7 @@ void DoCrop(x,y,w,h)
   if (x+w > pWIDE) w = pWIDE-x;
   if (y+h > pHIGH) h = pHIGH-y;
 
+  AnimSync();   /* cpic gets cut out of the frame that's being shown */
 
   FreeEpic();
   if (cpic && cpic !=  pic) free(cpic);
@@ -908,9 +931,11 @@ void DoRotate(dir)
   int i;
   
   /* dir=0: 90 degrees clockwise, else 90 degrees counter-clockwise */
+  AnimKill();       /* animations only play the right way up */
   WaitCursor();
   
   RotatePic(pic, picType, &pWIDE, &pHIGH, dir);
+  StretchRotate(dir);
   
   /* rotate clipped version and modify 'clip' coords */
   if (cpic != pic && cpic != NULL) {
@@ -1018,14 +1043,17 @@ void Flip(dir)
    * Note:  flips pic, cpic, and epic.  Doesn't touch Ximage, nor does it draw
    */
   
+  AnimKill();       /* animations only play the right way up */
   WaitCursor();
 
   if (HaveSelection()) {            /* only flip selection region */
+    StretchKill();                  /* (so can't re-stretch it any more) */
     flipSel(dir);
     return;
   }
 
   FlipPic(pic, pWIDE, pHIGH, dir);
+  StretchFlip(dir);
   
   /* flip clipped version */
   if (cpic && cpic != pic) {
@@ -1184,6 +1212,8 @@ void KillOldPics()
 {
   /* throw away all previous images */
 
+  AnimKill();
+  StretchKill();
   FreeEpic();
   if (cpic && cpic != pic) free(cpic);
   if (pic) free(pic);
@@ -1325,6 +1355,40 @@ static void floydDitherize1(ximage,pic824,ptype, wide, high, rmap, gmap, bmap)
 
 
 
+/************************/
+static void orderDitherize1(ximage, pic24, wide, high)
+     XImage *ximage;
+     byte   *pic24;
+     int     wide, high;
+{
+  /* like floydDitherize1(), for a PIC24, but does an ordered dither (see
+   * OrderDither()), so the result doesn't depend on the rest of the image
+   */
+
+  byte *bwpic, *pp, *ip, pix8;
+  int   i, j, bit, order;
+
+  bwpic = OrderDither(pic24, PIC24, wide, high, NULL, NULL, NULL,
+		      black&0x1, white&0x1);
+  if (!bwpic) FatalError("ran out of memory in orderDitherize1()\n");
+
+  order = ximage->bitmap_bit_order;
+
+  for (i=0, pp=bwpic; i<high; i++) {
+    ip = (byte *) ximage->data + i * ximage->bytes_per_line;
+    for (j=0, bit=0, pix8=0; j<wide; j++, pp++) {
+      if (order==LSBFirst) pix8 |= (*pp << bit);
+                      else pix8 |= (*pp << (7-bit));
+      if (++bit == 8) { *ip++ = pix8;  bit = pix8 = 0; }
+    }
+    if (bit) *ip++ = pix8;   /* write partial byte at end of line */
+  }
+
+  free(bwpic);
+}
+
+
+
 /************************/
 byte *FSDither(inpic, intype, w, h, rmap, gmap, bmap, 
 	      bval, wval)
@@ -1438,6 +1502,8 @@ byte *FSDither(inpic, intype, w, h, rmap, gmap, bmap,
 /***********************************/
 void CreateXImage()
 {
+  AnimFlush();      /* cached animation frames won't match the new image */
+  killOrdFill();
   xvDestroyImage(theImage);   theImage = NULL;
 
   if (!epic) GenerateEpic(eWIDE, eHIGH);  /* shouldn't happen... */
@@ -1452,8 +1518,70 @@ void CreateXImage()
   if (picType == PIC8) 
     theImage = Pic8ToXImage(epic,     (u_int) eWIDE, (u_int) eHIGH, 
 			    cols, rMap, gMap, bMap);
-  else if (picType == PIC24)
+  else if (picType == PIC24) {
+    ordOK = !useroot;
     theImage = Pic24ToXImage(egampic, (u_int) eWIDE, (u_int) eHIGH);
+    ordOK = 0;
+  }
+}
+
+
+/***********************************/
+int XImageFilled()
+{
+  /* returns '0' if parts of theImage haven't been dithered yet */
+
+  return (ordDone == NULL);
+}
+
+
+/***********************************/
+void FillXImage(x,y,w,h)
+     int x,y,w,h;
+{
+  /* makes sure that the given rectangle of theImage has been dithered */
+
+  int   tx, ty, px, py, pw, ph, i, j, bpl;
+  byte *ip;
+
+  if (!ordDone || !theImage) return;
+
+  if (x<0) { w += x;  x = 0; }
+  if (y<0) { h += y;  y = 0; }
+  if (x+w > theImage->width)  w = theImage->width  - x;
+  if (y+h > theImage->height) h = theImage->height - y;
+  if (w<1 || h<1) return;
+
+  bpl = theImage->bytes_per_line;
+
+  for (ty = y/ORD_TILE; ty <= (y+h-1)/ORD_TILE; ty++) {
+    for (tx = x/ORD_TILE; tx <= (x+w-1)/ORD_TILE; tx++) {
+      if (ordDone[ty*ordTW + tx]) continue;
+
+      px = tx * ORD_TILE;  pw = theImage->width  - px;
+      py = ty * ORD_TILE;  ph = theImage->height - py;
+      if (pw > ORD_TILE) pw = ORD_TILE;
+      if (ph > ORD_TILE) ph = ORD_TILE;
+
+      ip = (byte *) theImage->data + py * bpl + px;
+      Do332OrderRect(ordPic, theImage->width, px, py, pw, ph, ip, bpl);
+      for (i=0; i<ph; i++, ip += bpl)
+	for (j=0; j<pw; j++) ip[j] = (byte) stdcols[ip[j]];
+
+      ordDone[ty*ordTW + tx] = 1;
+    }
+  }
+}
+
+
+/***********************************/
+static void killOrdFill()
+{
+  /* theImage is going away, or its pixels are */
+
+  if (ordDone) free(ordDone);
+  ordDone = (byte *) NULL;
+  ordPic  = (byte *) NULL;
 }
 
 
@@ -1869,7 +1997,10 @@ XImage *Pic24ToXImage(pic24, wide, high)
     if (!imagedata) FatalError("couldn't malloc imagedata");
 
     xim->data = (char *) imagedata;
-    floydDitherize1(xim, pic24,PIC24, (int) wide, (int) high, NULL,NULL,NULL);
+    if (conv24 == CONV24_ORDER) 
+      orderDitherize1(xim, pic24, (int) wide, (int) high);
+    else
+      floydDitherize1(xim, pic24,PIC24, (int) wide, (int) high, NULL,NULL,NULL);
 
     return xim;
   }
@@ -2011,30 +2142,47 @@ XImage *Pic24ToXImage(pic24, wide, high)
     /************************************************************************/
 
     byte *pic8;
-    int   bwdith;
+    int   bwdith, ordfill;
 
     /* in all cases, make an 8-bit version of the image, either using
-       'black' and 'white', or the stdcmap */
+       'black' and 'white', or the stdcmap (unless it's going to be
+       ordered-dithered a piece at a time, by FillXImage()) */
 
-    bwdith = 0;
+    bwdith = ordfill = 0;
 
     if (ncols == 0 && dispDEEP != 1) {   /* do 'black' and 'white' dither */
       /* note that if dispDEEP > 8, pic8 will just have '0' and '1' instead 
 	 of 'black' and 'white' */
 
-      pic8 = FSDither(pic24, PIC24, (int) wide, (int) high, NULL, NULL, NULL, 
-		      (int) ((dispDEEP <= 8) ? black : 0), 
-		      (int) ((dispDEEP <= 8) ? white : 1));
+      if (conv24 == CONV24_ORDER)
+	pic8 = OrderDither(pic24, PIC24, (int) wide, (int) high, 
+			   NULL, NULL, NULL, 
+			   (int) ((dispDEEP <= 8) ? black : 0), 
+			   (int) ((dispDEEP <= 8) ? white : 1));
+      else
+	pic8 = FSDither(pic24, PIC24, (int) wide, (int) high, NULL, NULL, NULL,
+			(int) ((dispDEEP <= 8) ? black : 0), 
+			(int) ((dispDEEP <= 8) ? white : 1));
       bwdith = 1;
     }
 
+    else if (conv24 == CONV24_ORDER && ordOK && dispDEEP == 8) {
+      pic8 = (byte *) NULL;   /* dithered as it's drawn.  see FillXImage() */
+      ordfill = 1;
+    }
+
+    else if (conv24 == CONV24_ORDER) {   /* ordered dither using stdcmap */
+      pic8 = Do332OrderDither(pic24, NULL, (int) wide, (int) high, 
+			      NULL, NULL, NULL);
+    }
+
     else {                               /* do color dither using stdcmap */
       pic8 = Do332ColorDither(pic24, NULL, (int) wide, (int) high, 
 			      NULL, NULL, NULL,
 			      stdrdisp, stdgdisp, stdbdisp, 256);
     }
 
-    if (!pic8) FatalError("out of memory in Pic24ToXImage()\n");
+    if (!pic8 && !ordfill) FatalError("out of memory in Pic24ToXImage()\n");
 
 
     /* DISPLAY-DEPENDENT code follows... */
@@ -2053,8 +2201,17 @@ XImage *Pic24ToXImage(pic24, wide, high)
       /* Now create the image data - pad each scanline as necessary */
       imagedata = (byte *) malloc((size_t) (imWIDE * high));
       if (!imagedata) FatalError("couldn't malloc imagedata");
+
+      if (ordfill) {    /* FillXImage() will fill it in, as it's needed */
+	ordTW = (wide + ORD_TILE-1) / ORD_TILE;
+	ordTH = (high + ORD_TILE-1) / ORD_TILE;
+	ordDone = (byte *) calloc((size_t) (ordTW * ordTH), (size_t) 1);
+	if (!ordDone) FatalError("couldn't malloc ordDone");
+	ordPic = pic24;
+	xvbzero((char *) imagedata, (size_t) (imWIDE * high));
+      }
       
-      for (i=0, pp=pic8, ip=imagedata; i<high; i++) {
+      else for (i=0, pp=pic8, ip=imagedata; i<high; i++) {
 	if (((i+1)&0x7f) == 0) WaitCursor();
 
 	if (bwdith)
@@ -2332,7 +2489,7 @@ XImage *Pic24ToXImage(pic24, wide, high)
 
     }   /* end of the switch */
 
-    free(pic8);  /* since we ALWAYS make a copy of it into imagedata */
+    if (pic8) free(pic8);  /* since we ALWAYS make a copy of it into imagedata */
   }
 
 
@@ -2394,6 +2551,8 @@ void Change824Mode(mode)
     return;  
   }
 
+  AnimSync();
+
   /* should probably actually *do* something involving colors, regenrating
      pic's, drawing an Ximage, etc. */
 
@@ -2433,6 +2592,12 @@ void Change824Mode(mode)
 /***********************************************************/
 void FreeEpic()
 {
+  /* if theImage is still being filled in from egampic, it can't be, now */
+  if (ordDone) {
+    killOrdFill();
+    xvDestroyImage(theImage);   theImage = NULL;
+  }
+
   if (egampic && egampic != epic) free(egampic);
   if (epic && epic != cpic) free(epic);
   epic = egampic = NULL;
@@ -468,6 +468,11 @@ void Warning()
 {
   char *st;
 
+  if (!theDisp) {    /* no display (-convert) */
+    fprintf(stderr, "%s: %s\n", cmd, GetISTR(ISTR_INFO));
+    return;
+  }
+
   /* give 'em time to read message */
   if (infoUp || ctrlUp || anyBrowUp) sleep(3); 
   else {
@@ -633,6 +638,8 @@ void WaitCursor()
   XWMHints xwmh;
   time_t   nowT;
 
+  if (!theDisp) return;    /* no display (-convert) */
+
   if (!waiting) {
     time(&lastwaittime);
     waiting=1;
@@ -665,6 +672,8 @@ void SetCursors(n)
   /* if n < 0   sets normal cursor in all windows
      n = 0..6   cycles through fish cursors */
 
+  if (!theDisp) return;    /* no display (-convert) */
+
   if (n<0) {
     if (waiting) {
       waiting=0;
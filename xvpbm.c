@@ -2,6 +2,9 @@
  * xvpbm.c - load routine for 'pm' format pictures
  *
  * LoadPBM(fname, pinfo)  -  loads a PBM, PGM, or PPM file
+ * LoadPBMStream(fp, name, pinfo)  -  same, from an already-open stream
+ * PBMRows()  -  # of rows the last load got, if it can be added to later
+ * LoadPBMRows(fname,pic,ptype,w,h,y0,ny)  -  reads rows of a growing file
  * WritePBM(fp,pic,ptype,w,h,r,g,b,numcols,style,raw,cmt,comment)
  */
 
@@ -27,14 +30,18 @@
 
 static int garbage;
 static long numgot, filesize;
+static int rowsgot;        /* see PBMRows() */
 
 static int loadpbm  PARM((FILE *, PICINFO *, int));
 static int loadpgm  PARM((FILE *, PICINFO *, int, int));
 static int loadppm  PARM((FILE *, PICINFO *, int, int));
+static int loaddeep PARM((FILE *, PICINFO *, int, int, int, byte *));
 static int getint   PARM((FILE *, PICINFO *));
 static int getbit   PARM((FILE *, PICINFO *));
 static int getshort PARM((FILE *));
 static int pbmError PARM((char *, char *));
+static int writeRaw PARM((FILE *, byte *, int, int, int, byte *, byte *,
+			  byte *, int, int));
 
 static char *bname;
 
@@ -47,24 +54,50 @@ int LoadPBM(fname, pinfo)
   /* returns '1' on success */
 
   FILE  *fp;
+  int    rv;
+
+  pinfo->pic     = (byte *) NULL;
+  pinfo->comment = (char *) NULL;
+
+  /* open the file */
+  fp = xv_fopen(fname,"r");
+  if (!fp) return (pbmError(BaseName(fname), "can't open file"));
+
+  rv = LoadPBMStream(fp, fname, pinfo);
+  fclose(fp);
+  return rv;
+}  
+
+
+
+/*******************************************/
+int LoadPBMStream(fp, name, pinfo)
+     FILE    *fp;
+     char    *name;
+     PICINFO *pinfo;
+/*******************************************/
+{
+  /* reads one PBM, PGM, or PPM image from 'fp', which needn't be seekable
+     (LoadPS() reads Ghostscript's output straight out of a pipe).  'name'
+     is only used in messages.  Doesn't close 'fp'.  Returns '1' on success */
+
   int    c, c1;
   int    maxv, rv;
 
   garbage = maxv = rv = 0;
-  bname = BaseName(fname);
+  rowsgot = -1;
+  bname = BaseName(name);
 
   pinfo->pic     = (byte *) NULL;
   pinfo->comment = (char *) NULL;
 
 
-  /* open the file */
-  fp = xv_fopen(fname,"r");
-  if (!fp) return (pbmError(bname, "can't open file"));
-
-  /* compute file length */
-  fseek(fp, 0L, 2);
-  filesize = ftell(fp);
-  fseek(fp, 0L, 0);
+  /* compute file length, if it's a file */
+  filesize = 0L;
+  if (fseek(fp, 0L, 2) == 0) {
+    filesize = ftell(fp);
+    fseek(fp, 0L, 0);
+  }
 
 
   /* read the first two bytes of the file to determine which format
@@ -87,7 +120,6 @@ int LoadPBM(fname, pinfo)
 
 
   if (garbage) {
-    fclose(fp);
     if (pinfo->comment) free(pinfo->comment);
     pinfo->comment = (char *) NULL;
     return (pbmError(bname, "Garbage characters in header."));
@@ -105,8 +137,6 @@ int LoadPBM(fname, pinfo)
   else if (c1=='2' || c1=='5') rv = loadpgm(fp, pinfo, c1=='5' ? 1 : 0, maxv);
   else if (c1=='3' || c1=='6') rv = loadppm(fp, pinfo, c1=='6' ? 1 : 0, maxv);
 
-  fclose(fp);
-
   if (!rv) {
     if (pinfo->pic) free(pinfo->pic);
     if (pinfo->comment) free(pinfo->comment);
@@ -119,6 +149,82 @@ int LoadPBM(fname, pinfo)
 
 
 
+/*******************************************/
+int PBMRows()
+{
+  /* if the last LoadPBM() was of a raw PGM or PPM with no more than 8 bits
+     per sample (the kind that LoadPBMRows() can read), returns the # of
+     complete rows it got.  Otherwise, returns -1 */
+
+  return rowsgot;
+}
+
+
+/*******************************************/
+int LoadPBMRows(fname, pic, ptype, w, h, y0, ny)
+     char *fname;
+     byte *pic;
+     int   ptype, w, h, y0, ny;
+{
+  /* for '-poll'ing a file that's being written a row at a time.  If 'fname'
+     is a w*h raw PGM (ptype = PIC8) or PPM (PIC24) with no more than 8 bits
+     per sample, reads rows y0 through y0+ny-1 (or as many of them as have
+     been written) into 'pic', as grey levels or RGB triples scaled to
+     0..255.  Returns the # of complete rows in the file, or -1 if it isn't
+     that kind of file (any more) */
+
+  FILE   *fp;
+  PICINFO junk;
+  int     c, c1, fw, fh, maxv, rows;
+  long    start, rowlen, got, i;
+  byte    scale[256];
+
+  fp = xv_fopen(fname,"r");
+  if (!fp) return -1;
+
+  garbage = 0;
+  junk.comment = (char *) NULL;
+
+  c = getc(fp);  c1 = getc(fp);
+  fw = fh = maxv = 0;
+  if (c == 'P' && c1 == ((ptype == PIC8) ? '5' : '6')) {
+    fw   = getint(fp, &junk);
+    fh   = getint(fp, &junk);
+    maxv = getint(fp, &junk);
+  }
+  if (junk.comment) free(junk.comment);
+
+  if (garbage || fw != w || fh != h || maxv < 1 || maxv > 255) {
+    fclose(fp);
+    return -1;
+  }
+
+  rowlen = (long) w * ((ptype == PIC8) ? 1 : 3);
+  start  = ftell(fp);
+  fseek(fp, 0L, 2);
+  rows = (int) ((ftell(fp) - start) / rowlen);
+  if (rows > h) rows = h;
+  if (rows < 0) rows = 0;
+
+  if (pic && y0 >= 0 && y0 < rows && ny > 0) {
+    if (y0 + ny > rows) ny = rows - y0;
+
+    fseek(fp, start + y0 * rowlen, 0);
+    got = (long) fread(pic, (size_t) 1, (size_t) (ny * rowlen), fp);
+    if (got < ny * rowlen) rows = y0 + (int) (got / rowlen);
+
+    if (maxv < 255) {
+      for (i=0; i<=maxv; i++) scale[i] = (i * 255) / maxv;
+      for (i=0; i<got; i++) pic[i] = scale[pic[i]];
+    }
+  }
+
+  fclose(fp);
+  return rows;
+}
+
+
+
 /*******************************************/
 static int loadpbm(fp, pinfo, raw)
      FILE    *fp;
@@ -220,7 +326,14 @@ static int loadpgm(fp, pinfo, raw, maxv)
 
   numgot = 0;
 
-  if (!raw) {
+  /* a DEEPPIC only has room for DEEPLEVELS levels.  A bigger maxval
+     (which isn't legal, anyway) just gets its bits dropped */
+  if (holdmaxv>255 && holdmaxv<DEEPLEVELS &&
+      loaddeep(fp, pinfo, raw, holdmaxv, 1, pic8)) {
+    /* pic8 has already been stretched to 0..255 */
+    for (i=0; i<256; i++) pinfo->r[i] = pinfo->g[i] = pinfo->b[i] = i;
+  }
+  else if (!raw) {
     for (i=0, pix=pic8; i<h; i++) {
       if ((i&0x3f)==0) WaitCursor();
       for (j=0; j<w; j++, pix++)
@@ -237,6 +350,7 @@ static int loadpgm(fp, pinfo, raw, maxv)
     }
     else {
       numgot = fread(pic8, (size_t) 1, (size_t) w*h, fp);  /* read raw data */
+      if (w > 0) rowsgot = numgot / w;
     }
   }
 
@@ -257,7 +371,7 @@ static int loadppm(fp, pinfo, raw, maxv)
      int      raw, maxv;
 {
   byte *pix, *pic24, scale[256], *pic8;
-  int   i,j,bitshift, w, h, holdmaxv;
+  int   i,j,bitshift, w, h, holdmaxv, deep;
 
   w = pinfo->w;  h = pinfo->h;
 
@@ -280,8 +394,12 @@ static int loadppm(fp, pinfo, raw, maxv)
 
 
   numgot = 0;
+  deep = 0;
 
-  if (!raw) {
+  if (holdmaxv>255 && holdmaxv<DEEPLEVELS &&
+      loaddeep(fp, pinfo, raw, holdmaxv, 3, pic24))
+    deep = 1;         /* pic24 has already been stretched to 0..255 */
+  else if (!raw) {
     for (i=0, pix=pic24; i<h; i++) {
       if ((i&0x3f)==0) WaitCursor();
       for (j=0; j<w*3; j++, pix++)
@@ -298,6 +416,7 @@ static int loadppm(fp, pinfo, raw, maxv)
     }
     else {
       numgot = fread(pic24, (size_t) 1, (size_t) w*h*3, fp);  /* read data */
+      if (w > 0) rowsgot = numgot / (w*3);
     }
   }
   
@@ -310,7 +429,7 @@ static int loadppm(fp, pinfo, raw, maxv)
   /* have to scale all RGB values up (Conv24to8 expects RGB values to
      range from 0-255 */
 
-  if (maxv<255) { 
+  if (maxv<255 && !deep) { 
     for (i=0; i<=maxv; i++) scale[i] = (i * 255) / maxv;
 
     for (i=0, pix=pic24; i<h; i++) {
@@ -324,6 +443,49 @@ static int loadppm(fp, pinfo, raw, maxv)
 
 
 
+/*******************************************/
+static int loaddeep(fp, pinfo, raw, maxv, nchan, pic)
+     FILE    *fp;
+     PICINFO *pinfo;
+     int      raw, maxv, nchan;
+     byte    *pic;
+{
+  /* reads the samples of a PGM (nchan=1) or PPM (nchan=3) that has
+     255<maxv<DEEPLEVELS into a DEEPPIC, so all the bits are kept, and stretches them
+     into 'pic'.  Returns '0' (having read nothing) if there isn't enough
+     memory for the DEEPPIC */
+
+  DEEPPIC        *dp;
+  unsigned short *sp;
+  long           *hist;
+  int             i, j, v, w, h;
+
+  w = pinfo->w;  h = pinfo->h;
+  dp = DeepAlloc(w, h, nchan);
+  if (!dp) return 0;
+
+  dp->nlevels = maxv+1;
+  dp->min = 0.0;  dp->max = (double) maxv;
+  hist = dp->hist;
+
+  for (i=0, sp=dp->data; i<h; i++) {
+    if ((i&0x3f)==0) WaitCursor();
+    for (j=0; j<w*nchan; j++, sp++) {
+      v = (raw) ? getshort(fp) : getint(fp, pinfo);
+      if (v > maxv) v = maxv;
+      if (v < 0)    v = 0;          /* ascii number that overflowed */
+      *sp = (unsigned short) v;
+      hist[v]++;
+    }
+  }
+
+  DeepStretch(dp, stretchMode, pic);
+  pinfo->deep = dp;
+  return 1;
+}
+
+
+
 /*******************************************/
 static int getint(fp, pinfo)
      FILE *fp;
@@ -398,7 +560,7 @@ static int getint(fp, pinfo)
 static int getshort(fp)
      FILE    *fp;
 {
-  /* used in RAW mode to read 16-bit values */
+  /* used in RAW mode to read 16-bit values, which are stored MSB first */
 
   int c1, c2;
 
@@ -409,7 +571,7 @@ static int getshort(fp)
 
   numgot++;
 
-  return (c2 << 8) | c1;
+  return (c1 << 8) | c2;
 }
 
 
@@ -533,27 +695,25 @@ int WritePBM(fp,pic,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle,raw,comment)
 
   /* write the image data */
 
-  if (colorstyle==0) {                  /* 24bit RGB, 3 bytes per pixel */
+  if (colorstyle==2 && ptype==PIC24)     /* shouldn't happen */
+    FatalError("PIC24 and B/W Stipple in WritePBM()\n");
+
+  if (raw) {
+    if (writeRaw(fp,pic,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle))
+      return -1;
+  }
+
+  else if (colorstyle==0) {             /* 24bit RGB, 3 numbers per pixel */
     for (i=0, pix=pic, len=0; i<h; i++) {
       if ((i&63)==0) WaitCursor();
       for (j=0; j<w; j++) {
-	if (raw) {
-	  if (ptype==PIC8) {
-	    putc(rmap[*pix],fp);  putc(gmap[*pix],fp);  putc(bmap[*pix],fp);
-	  }
-	  else {  /* PIC24 */
-	    putc(pix[0],fp);  putc(pix[1],fp);  putc(pix[2],fp);
-	  }
-	}
-	else {
-	  if (ptype==PIC8) 
-	    fprintf(fp,"%3d %3d %3d ",rmap[*pix], gmap[*pix], bmap[*pix]);
-	  else
-	    fprintf(fp,"%3d %3d %3d ",pix[0], pix[1], pix[2]);
+	if (ptype==PIC8) 
+	  fprintf(fp,"%3d %3d %3d ",rmap[*pix], gmap[*pix], bmap[*pix]);
+	else
+	  fprintf(fp,"%3d %3d %3d ",pix[0], pix[1], pix[2]);
 
-	  len+=12;
-	  if (len>58) { fprintf(fp,"\n");  len=0; }
-	}
+	len+=12;
+	if (len>58) { fprintf(fp,"\n");  len=0; }
 	
 	pix += (ptype==PIC24) ? 3 : 1;
       }
@@ -569,26 +729,19 @@ int WritePBM(fp,pic,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle,raw,comment)
     for (i=0, pix=pic, len=0; i<w*h; i++) {
       if ((i&0x7fff)==0) WaitCursor();
 
-      if (raw) putc((ptype==PIC8) ? rgb[*pix] : MONO(pix[0],pix[1],pix[2]),fp);
-
-      else {
-	if (ptype==PIC8) fprintf(fp,"%3d ",rgb[*pix]);
-	            else fprintf(fp,"%3d ",MONO(pix[0],pix[1],pix[2]));
-	len += 4;
-	if (len>66) { fprintf(fp,"\n");  len=0; }
-      }
+      if (ptype==PIC8) fprintf(fp,"%3d ",rgb[*pix]);
+                  else fprintf(fp,"%3d ",MONO(pix[0],pix[1],pix[2]));
+      len += 4;
+      if (len>66) { fprintf(fp,"\n");  len=0; }
 
       pix += (ptype==PIC24) ? 3 : 1;
     }
   }
 
   else if (colorstyle==2) {             /* 1-bit B/W stipple */
-    int bit,k,flipbw;
+    int flipbw;
     char *str0, *str1;
 
-    /* shouldn't happen */
-    if (ptype == PIC24) FatalError("PIC24 and B/W Stipple in WritePBM()\n");
-
     /* if '0' is black, set flipbw */
     flipbw = (MONO(rmap[0],gmap[0],bmap[0]) < MONO(rmap[1],gmap[1],bmap[1]));
 
@@ -597,37 +750,98 @@ int WritePBM(fp,pic,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle,raw,comment)
 
     for (i=0, pix=pic, len=0; i<h; i++) {
       if ((i&15)==0) WaitCursor();
-      for (j=0, bit=0, k=0; j<w; j++, pix++) {
-	if (raw) {
-	  k = (k << 1) | *pix;
-	  bit++;
-	  if (bit==8) {
-	    if (flipbw) k = ~k;
-	    fputc(k,fp);
-	    bit = k = 0;
-	  }
+      for (j=0; j<w; j++, pix++) {
+	if (*pix) fprintf(fp,str1);
+	     else fprintf(fp,str0);
+	len+=2;
+	if (len>68) { fprintf(fp,"\n"); len=0; }
+      }
+    }
+  }
+
+  if (ferror(fp)) return -1;
+
+  return 0;
+}
+
+
+/*******************************************/
+static int writeRaw(fp,pic,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle)
+     FILE *fp;
+     byte *pic;
+     int   ptype, w,h;
+     byte *rmap, *gmap, *bmap;
+     int   numcols, colorstyle;
+{
+  /* writes the image data of a raw PPM/PGM/PBM file.  Each line is
+     converted into a buffer, and written out with a single fwrite(), 
+     rather than a putc() per byte.  Returns '0' if successful */
+
+  byte *line, *lp, *pix, rgb[256];
+  int   i, j, bit, k, bpl, flipbw;
+
+  if      (colorstyle==0) bpl = w * 3;
+  else if (colorstyle==1) bpl = w;
+  else                    bpl = (w + 7) / 8;
+
+  line = (byte *) malloc((size_t) bpl + 1);
+  if (!line) FatalError("couldn't malloc line buffer in WritePBM()");
+
+  flipbw = 0;
+  if (colorstyle==1 && ptype==PIC8)
+    for (i=0; i<numcols; i++) rgb[i] = MONO(rmap[i],gmap[i],bmap[i]);
+  else if (colorstyle==2)      /* if '0' is black, set flipbw */
+    flipbw = (MONO(rmap[0],gmap[0],bmap[0]) < MONO(rmap[1],gmap[1],bmap[1]));
+
+  for (i=0, pix=pic; i<h; i++) {
+    if ((i&63)==0) WaitCursor();
+    lp = line;
+
+    if (colorstyle==0) {                  /* 24bit RGB, 3 bytes per pixel */
+      if (ptype==PIC8) {
+	for (j=0; j<w; j++, pix++) {
+	  *lp++ = rmap[*pix];  *lp++ = gmap[*pix];  *lp++ = bmap[*pix];
 	}
-	else {
-	  if (*pix) fprintf(fp,str1);
-	       else fprintf(fp,str0);
-	  len+=2;
-	  if (len>68) { fprintf(fp,"\n"); len=0; }
+      }
+      else {
+	xvbcopy((char *) pix, (char *) line, (size_t) bpl);
+	pix += bpl;
+      }
+    }
+
+    else if (colorstyle==1) {             /* 8-bit greyscale */
+      if (ptype==PIC8) 
+	for (j=0; j<w; j++, pix++) *lp++ = rgb[*pix];
+      else
+	for (j=0; j<w; j++, pix+=3) *lp++ = MONO(pix[0],pix[1],pix[2]);
+    }
+
+    else {                                /* 1-bit B/W stipple */
+      for (j=0, bit=0, k=0; j<w; j++, pix++) {
+	k = (k << 1) | *pix;
+	bit++;
+	if (bit==8) {
+	  if (flipbw) k = ~k;
+	  *lp++ = (byte) k;
+	  bit = k = 0;
 	}
-      } /* j */
-      if (raw && bit) {
+      }
+      if (bit) {
 	k = k << (8-bit);
 	if (flipbw) k = ~k;
-	fputc(k,fp);
+	*lp++ = (byte) k;
       }
     }
-  }
 
-  if (ferror(fp)) return -1;
+    if (fwrite((char *) line, (size_t) 1, (size_t) bpl, fp) != bpl) break;
+  }
 
-  return 0;
+  free(line);
+  return (i < h || ferror(fp));
 }
 
 
+
 	  
 	  
 
@@ -849,7 +849,8 @@ int LoadPDS(fname, pinfo)
 
 
 /*
- *   16-bit to 8-bit conversion
+ *   16-bit to 8-bit conversion.  The 16-bit samples are kept (in
+ *   pinfo->deep), so that the stretch can be changed later
  */
 
 /*******************************************/
@@ -858,29 +859,31 @@ static int Convert16BitImage(fname, pinfo, swab)
      PICINFO *pinfo;
      int swab;
 {
-  unsigned short *pShort;
-  long i, j, k, l, n, *hist, nTot;
-  size_t m;
-  byte *lut, *pPix8;
+  DEEPPIC *dp;
+  unsigned short *pShort, *pLev;
+  long i, j, k, n, lo, hi, *hist;
+  byte *pPix8;
   FILE *fp;
   char  name[1024], *c;
 
-  m = 65536 * sizeof(byte);
-  lut = (byte *) malloc(m);
-  if (lut == NULL) {
-    SetISTR(ISTR_WARNING,"LoadPDS: couldn't malloc %d", m);
-    return 0;
-  }
   pinfo->w /= 2;
-
-  /* allocate histogram table */
-  m = 65536 * sizeof(long);
-  hist = (long *) malloc(m);
-  if (hist == NULL) {
-    SetISTR(ISTR_WARNING,"LoadPDS: couldn't malloc %d", m);
-    free(lut);
+  dp = DeepAlloc(pinfo->w, pinfo->h, 1);
+  if (dp == NULL) {
+    SetISTR(ISTR_WARNING,"LoadPDS: couldn't malloc %d", 
+	    pinfo->w * pinfo->h * sizeof(unsigned short));
     return 0;
   }
+  hist = dp->hist;
+
+  /* get the samples into native byte order */
+  n = pinfo->h * pinfo->w;
+  pShort = (unsigned short *)pinfo->pic;
+  pLev   = dp->data;
+  if (swab)
+    for (i = 0; i < n; i++, pShort++)
+      *pLev++ = ((*pShort & 255) << 8) | ((*pShort >> 8) & 255);
+  else
+    for (i = 0; i < n; i++) *pLev++ = *pShort++;
 
   /* check whether histogram file exists */
 #ifdef VMS
@@ -894,10 +897,10 @@ static int Convert16BitImage(fname, pinfo, swab)
 
   /* read the histogram file which is always LSB_INTEGER */
   if ((fp = xv_fopen(name, "r")) != NULL) {
-    for (n = k = nTot = 0; n < 65536 && k != EOF; n++, nTot += j) {
+    for (n = k = 0; n < 65536 && k != EOF; n++) {
       for (i = j = 0; i < 4 && (k = getc(fp)) != EOF; i++)
         j = ((j >> 8) & 0xffffff) | ((k & 255) << 24);
-      hist[swab ? ((n & 255) << 8) | ((n >> 8) & 255) : n] = j;
+      hist[n] = j;
     }
     fclose(fp);
     if (k == EOF)
@@ -908,62 +911,41 @@ static int Convert16BitImage(fname, pinfo, swab)
   if (fp == NULL) {
     for (n = 0; n < 65536; n++)
       hist[n] = 0;
-    nTot = n = pinfo->h * pinfo->w;
-    pShort = (unsigned short *)pinfo->pic;
-    while (--n >= 0) {
-      hist[*pShort++]++;
-    }
+    n = pinfo->h * pinfo->w;
+    pLev = dp->data;
+    while (--n >= 0)
+      hist[*pLev++]++;
   }
 
-  /* use either histogram equalization or linear stretch */
-  if (0) {      /* was: (conv24MB.flags[CONV24_HIST]) */
-
-    /* construct lookup table to invert the histogram */
-    m = l = hist[0];
-    i = (nTot - m) >> 8;
-    for (n = j = 1; n < 65536; n++) {
-      k = swab ? ((n & 255) << 8) | ((n >> 8) & 255) : n;
-      if ((l += hist[k]) > m && j < 255)
-        j++, m += i;
-      lut[k] = j;
-    }
-
-  } else {
-
-    /* find min and max of histogram */
-    n = nTot/10000;
-    for (m = 0, j = 1; j < 65536; j++)
-      if ((m += hist[swab ? ((j & 255) << 8) | ((j >> 8) & 255) : j]) > n)
-        break;
-    for (m = 0, k = 65535; --k > 1; )
-      if ((m += hist[swab ? ((k & 255) << 8) | ((k >> 8) & 255) : k]) > n)
-        break;
-
-    /* construct stretch table */
-    for (n = 0; n < 65536; n++) {
-      i = swab ? (((n & 255) << 8) | ((n >> 8) & 255)) : n;
-      m = 1 + (254 * (n - j)) / (k - j);
-      lut[i] = n < j ? 0 : (n > k ? 255 : m);
-    }
+  /* make level 0 the lowest value that's used, and nlevels-1 the highest */
+  for (lo = 0; lo < 65535 && hist[lo] == 0; lo++);
+  for (hi = 65535; hi > lo && hist[hi] == 0; hi--);
+
+  if (lo > 0 || hi < 65535) {
+    n = pinfo->h * pinfo->w;
+    for (i = 0, pLev = dp->data; i < n; i++, pLev++)
+      *pLev = (*pLev < lo) ? 0 : (*pLev > hi) ? hi - lo : *pLev - lo;
+    for (i = lo; i <= hi; i++)
+      hist[i - lo] = hist[i];
+    for (i = hi - lo + 1; i < 65536; i++)
+      hist[i] = 0;
   }
+  dp->nlevels = hi - lo + 1;
+  dp->min = (double) lo;  dp->max = (double) hi;
 
-  /* allocate new 8-bit image */
-  free(hist);
+  /* allocate new 8-bit image, and stretch the samples into it */
   n = pinfo->w * pinfo->h;
   pPix8 = (byte *)malloc(n*sizeof(byte));
   if (pPix8 == NULL) {
     SetISTR(ISTR_WARNING,"LoadPDS: couldn't malloc %d", n*sizeof(byte));
-    free(lut);
+    DeepFree(dp);
     return 0;
   }
 
-  /* convert the 16-bit image to 8-bit */
-  lut[0] = 0;
-  free(pShort = (unsigned short *)pinfo->pic);
-  pinfo->pic = pPix8;
-  while(--n >= 0)
-    *pPix8++ = lut[*pShort++];
-  free(lut);
+  DeepStretch(dp, stretchMode, pPix8);
+  free(pinfo->pic);
+  pinfo->pic  = pPix8;
+  pinfo->deep = dp;
   return 1;
 }
 
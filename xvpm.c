@@ -48,6 +48,7 @@ static int  pmError  PARM((char *, char *));
 static int  flip4    PARM((int));
 static int  getint32 PARM((FILE *));
 static void putint32 PARM((int, FILE *));
+static void putPlane PARM((byte *, int, int, byte *, FILE *));
 
 
 /*******************************************/
@@ -261,7 +262,6 @@ int WritePM(fp, pic, ptype, w, h, rmap, gmap, bmap, numcols, colorstyle,
 
   char  foo[256];
   int   i;
-  byte *p;
 
   /* create 'comment' field */
   sprintf(foo,"CREATOR: XV %s\n", REVDATE);
@@ -288,25 +288,17 @@ int WritePM(fp, pic, ptype, w, h, rmap, gmap, bmap, numcols, colorstyle,
   if (colorstyle == 0) {         /* 24bit RGB, organized as 3 8bit planes */
 
     if (ptype == PIC8) {
-      WaitCursor();
-      for (i=0,p=pic; i<w*h; i++, p++) putc(rmap[*p], fp);
-
-      WaitCursor();
-      for (i=0,p=pic; i<w*h; i++, p++) putc(gmap[*p], fp);
-
-      WaitCursor();
-      for (i=0,p=pic; i<w*h; i++, p++) putc(bmap[*p], fp);
+      putPlane(pic, w*h, 1, rmap, fp);
+      putPlane(pic, w*h, 1, gmap, fp);
+      putPlane(pic, w*h, 1, bmap, fp);
     }
 
     else {  /* PIC24 */
-      WaitCursor();
-      for (i=0,p=pic; i<w*h; i++, p+=3) putc(*p, fp);
-
-      WaitCursor();
-      for (i=0,p=pic+1; i<w*h; i++, p+=3) putc(*p, fp);
-
-      WaitCursor();
-      for (i=0,p=pic+2; i<w*h; i++, p+=3) putc(*p, fp);
+      byte ident[256];
+      for (i=0; i<256; i++) ident[i] = i;
+      putPlane(pic,   w*h, 3, ident, fp);
+      putPlane(pic+1, w*h, 3, ident, fp);
+      putPlane(pic+2, w*h, 3, ident, fp);
     }
   }
 
@@ -316,25 +308,16 @@ int WritePM(fp, pic, ptype, w, h, rmap, gmap, bmap, numcols, colorstyle,
     
     if (ptype == PIC8) {
       for (i=0; i<numcols; i++) rgb[i] = MONO(rmap[i],gmap[i],bmap[i]);
-      for (i=0, p=pic; i<w*h; i++, p++) {
-	if ((i & 0x3fff) == 0) WaitCursor();
-	putc(rgb[*p],fp);
-      }
-    }
-    else {  /* PIC24 */
-      for (i=0, p=pic; i<w*h; i++, p+=3) {
-	if ((i & 0x3fff) == 0) WaitCursor();
-	putc( MONO(p[0],p[1],p[2]), fp);
-      }
+      putPlane(pic, w*h, 1, rgb, fp);
     }
+    else putPlane(pic, w*h, 3, (byte *) NULL, fp);      /* PIC24 */
   }
 
   else /* (colorstyle == 2) */ { /* B/W stipple.  pic is 1's and 0's */
     /* note: pic has already been dithered into 8-bit image */
-    for (i=0, p=pic; i<w*h; i++, p++) {
-      if ((i & 0x3fff) == 0) WaitCursor();
-      putc(*p ? 255 : 0,fp);
-    }
+    byte bw[256];
+    for (i=0; i<256; i++) bw[i] = (i) ? 255 : 0;
+    putPlane(pic, w*h, 1, bw, fp);
   }
 
   if (comment) {
@@ -349,6 +332,32 @@ int WritePM(fp, pic, ptype, w, h, rmap, gmap, bmap, numcols, colorstyle,
 }
 
 
+/*****************************/
+static void putPlane(p, npix, step, map, fp)
+     byte *p, *map;
+     int   npix, step;
+     FILE *fp;
+{
+  /* writes one 8-bit plane of 'npix' pixels.  Pixels are 'step' bytes 
+     apart in 'p', and are written as map[*p], or as the MONO() of the 
+     RGB triple at 'p' if 'map' is NULL.  Done a buffer-full at a time */
+
+  byte  buf[16384], *bp;
+  int   i, n;
+
+  while (npix > 0) {
+    WaitCursor();
+    n = (npix < sizeof(buf)) ? npix : sizeof(buf);
+
+    if (map) for (i=0, bp=buf; i<n; i++, p+=step) *bp++ = map[*p];
+        else for (i=0, bp=buf; i<n; i++, p+=step) *bp++ = MONO(p[0],p[1],p[2]);
+
+    if (fwrite((char *) buf, (size_t) 1, (size_t) n, fp) != n) return;
+    npix -= n;
+  }
+}
+
+
 /*****************************/
 static int pmError(fname, st)
      char *fname, *st;
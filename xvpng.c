@@ -64,12 +64,14 @@ static    void png_xv_error   PARM((png_structp png_ptr,
                                     png_const_charp message));
 static    void png_xv_warning PARM((png_structp png_ptr,
                                     png_const_charp message));
+static    void stretch16      PARM((PICINFO *));
 
 /*** local variables ***/
 static char *filename;
 static char *fbasename;
 static int   colorType;
 static int   read_anything;
+static DEEPPIC *deep;           /* the 16-bit samples, if there are any */
 static double Display_Gamma = DISPLAY_GAMMA;
 
 static DIAL  cDial, gDial;
@@ -823,6 +825,7 @@ int LoadPNG(fname, pinfo)
   int linesize;
   int filesize;
   int pass;
+  int read_16;
   size_t commentsize;
 
   fbasename = BaseName(fname);
@@ -831,6 +834,7 @@ int LoadPNG(fname, pinfo)
   pinfo->comment = (char *) NULL;
 
   read_anything=0;
+  deep = (DEEPPIC *) NULL;
 
   /* open the file */
   fp = xv_fopen(fname,"r");
@@ -863,6 +867,11 @@ int LoadPNG(fname, pinfo)
   if (setjmp(png_jmpbuf (png_ptr))) {
     fclose(fp);
     png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
+    if(deep) {
+      if(read_anything) stretch16(pinfo);
+      else DeepFree(deep);
+      deep = (DEEPPIC *) NULL;
+    }
     if(!read_anything) {
       if(pinfo->pic) {
         free(pinfo->pic);
@@ -940,8 +949,13 @@ int LoadPNG(fname, pinfo)
                        0, Display_Gamma);
   }
 
-  if (png_get_bit_depth (png_ptr, info_ptr) == 16)
-    png_set_strip_16 (png_ptr);
+  if (png_get_bit_depth (png_ptr, info_ptr) == 16) {
+    /* keep all 16 bits in a DEEPPIC (see xvstretch.c), in native order */
+    int one = 1;
+    if (*(char *) &one) png_set_swap(png_ptr);
+    read_16 = 1;
+  }
+  else read_16 = 0;
 
   if (png_get_color_type (png_ptr, info_ptr) == PNG_COLOR_TYPE_GRAY ||
       png_get_color_type (png_ptr, info_ptr) == PNG_COLOR_TYPE_GRAY_ALPHA)
@@ -989,12 +1003,23 @@ int LoadPNG(fname, pinfo)
     png_error(png_ptr, "can't allocate space for PNG image");
   }
 
+  if(read_16) {
+    deep = DeepAlloc(pinfo->w, pinfo->h, linesize / pinfo->w);
+    if(!deep) {
+      png_error(png_ptr, "can't allocate space for PNG image");
+    }
+    xvbzero((char *) deep->data,
+	    (size_t) linesize * pinfo->h * sizeof(unsigned short));
+  }
+
   /*  png_start_read_image(png_ptr); */
 
   for(i = 0; i < pass; i++) {
     byte *p = pinfo->pic;
     for(j = 0; j < pinfo->h; j++) {
-      png_read_row(png_ptr, p, NULL);
+      if(deep) png_read_row(png_ptr, (png_bytep) (deep->data + j*linesize),
+			    NULL);
+          else png_read_row(png_ptr, p, NULL);
       read_anything = 1;
       if((j & 0x1f) == 0) WaitCursor();
       p += linesize;
@@ -1002,6 +1027,11 @@ int LoadPNG(fname, pinfo)
   }
 
   png_read_end(png_ptr, info_ptr);
+
+  if(deep) {
+    stretch16(pinfo);
+    deep = (DEEPPIC *) NULL;
+  }
   
   {
     png_textp pTxt;
@@ -1038,6 +1068,28 @@ int LoadPNG(fname, pinfo)
 }
 
 
+/*******************************************/
+static void
+stretch16(pinfo)
+     PICINFO *pinfo;
+{
+  /* makes the histogram of the 16-bit samples in 'deep', stretches them
+     into pinfo->pic, and hands 'deep' over to pinfo */
+
+  unsigned short *sp;
+  long i;
+
+  deep->nlevels = 65536;
+  deep->min = 0.0;  deep->max = 65535.0;
+
+  for(i = (long) deep->w * deep->h * deep->nchan, sp = deep->data; i > 0; i--)
+    deep->hist[*sp++]++;
+
+  DeepStretch(deep, stretchMode, pinfo->pic);
+  pinfo->deep = deep;
+}
+
+
 /*******************************************/
 static void
 png_xv_error(png_ptr, message)
@@ -7,7 +7,7 @@
  *   PopUp(str,...)        -  maps, sets up popW
  *   ErrPopUp(str,str)     -  maps, sets up popW
  *   GetStrPopUp(...)      -  opens a 1-line, editable text popup window
- *   GrabPopUp(*hide,*del) -  opens 'grab' popup dialog
+ *   GrabPopUp(*hide,*del,*rep) - opens 'grab' popup dialog
  *   PadPopUp()            -  opens 'grab' popup dialog
  *   ClosePopUp()          -  closes pop-up or alert window, if open
  *   OpenAlert(str)        -  maps a button-less window
@@ -25,6 +25,8 @@
 #define PUWIDE 400
 #define PUHIGH 170
 
+#define GRAB_PUHIGH 210
+
 #define PAD_PUWIDE 480
 #define PAD_PUHIGH 215
 
@@ -55,6 +57,7 @@ static void build1PadList PARM((char *, char **, char **, int *,
 #define DELAYSTR "Delay:"
 #define SECSTR   "seconds"
 #define HIDESTR  "Hide XV windows"
+#define REPSTR   "Repeat"
 
 /* local variables */
 Window popW;
@@ -70,7 +73,7 @@ int   gsBufLen, gsAllow, gsCurPos, gsStPos, gsEnPos;
 int   gsx, gsy, gsw, gsh;
 
 /* stuff for GrabPopUp */
-CBUTT ahideCB;
+CBUTT ahideCB, arepCB;
 
 
 /*** stuff for PadPopUp ***/
@@ -188,14 +191,20 @@ static int doPopUp(txt, labels, n, poptyp, wname)
   int    i;
   XEvent event;
 
+  if (!theDisp) {    /* no display (-convert).  take the default button */
+    fprintf(stderr, "%s: %s\n", cmd, txt);
+    return 0;
+  }
+
   if (firsttime) createPUD();
 
-  if (poptyp != ISPAD) { puwide = PUWIDE;      puhigh = PUHIGH;     }
-                  else { puwide = PAD_PUWIDE;  puhigh = PAD_PUHIGH; }
+  if      (poptyp == ISPAD)  { puwide = PAD_PUWIDE;  puhigh = PAD_PUHIGH;  }
+  else if (poptyp == ISGRAB) { puwide = PUWIDE;      puhigh = GRAB_PUHIGH; }
+  else                       { puwide = PUWIDE;      puhigh = PUHIGH;      }
 
 
   /* attach controls to popW, now that it exists */
-  if      (poptyp==ISGRAB) ahideCB.win = popW;
+  if      (poptyp==ISGRAB) ahideCB.win = arepCB.win = popW;
   else if (poptyp == ISPAD) {
     
     if (!padHaveDooDads) {
@@ -366,8 +375,8 @@ int GetStrPopUp(txt, labels, n, buf, buflen, filstr, allow)
 
 
 /***************************************************/
-int GrabPopUp(pHide, pDelay)
-     int *pHide, *pDelay;
+int GrabPopUp(pHide, pDelay, pRepeat)
+     int *pHide, *pDelay, *pRepeat;
 {
   /* pops up Grab options dialog box */
 
@@ -385,7 +394,7 @@ int GrabPopUp(pHide, pDelay)
   gsw = 32;
   gsh = LINEHIGH+5;
   gsx = 10 + StringWidth(DELAYSTR) + 5;
-  gsy = (PUHIGH-BUTTH-10-5-gsh);
+  gsy = (GRAB_PUHIGH-BUTTH-10-5-gsh);
 
   changedGSBuf();      /* careful!  popW doesn't exist yet! */
 
@@ -395,17 +404,25 @@ int GrabPopUp(pHide, pDelay)
 	   gsy+2, HIDESTR, infofg, infobg, hicol, locol);
   ahideCB.val = *pHide;
 
+  CBCreate(&arepCB, (Window) NULL, 
+	   ahideCB.x-20-18-StringWidth(REPSTR),
+	   gsy+2, REPSTR, infofg, infobg, hicol, locol);
+  arepCB.val = *pRepeat;
+
   sprintf(grabTxt, "Grab: after delay, Left button grabs a window, ");
   strcat (grabTxt, "Middle button ");
   strcat (grabTxt, "grabs a rectangular area, Right button cancels.\n\n");
   strcat (grabTxt, "AutoGrab: after delay, grabs ");
   strcat (grabTxt, "the window the cursor is positioned in.  ");
-  strcat (grabTxt, "Delay must be non-zero.");
+  strcat (grabTxt, "Delay must be non-zero.\n\n");
+  strcat (grabTxt, "Repeat: keeps grabbing the same area until a mouse ");
+  strcat (grabTxt, "button is pressed.  The last frames are kept as pages.");
 
   rv = doPopUp(grabTxt, grabLabels, 3, ISGRAB, "xv grab");
 
-  *pHide  = ahideCB.val;
-  *pDelay = atoi(delaybuf);
+  *pHide   = ahideCB.val;
+  *pDelay  = atoi(delaybuf);
+  *pRepeat = arepCB.val;
   return rv;
 }
 
@@ -884,6 +901,7 @@ int x,y,w,h;
     DrawString(popW, gsx+gsw+5, gsy+ASCENT+4, SECSTR);
 
     CBRedraw(&ahideCB);
+    CBRedraw(&arepCB);
   }
 
   else if (popUp == ISPAD) {
@@ -969,6 +987,8 @@ static void clickPUD(x,y)
 
   if (popUp==ISGRAB && CBClick(&ahideCB, x,y)) CBTrack(&ahideCB);
 
+  else if (popUp==ISGRAB && CBClick(&arepCB, x,y)) CBTrack(&arepCB);
+
   else if (popUp == ISPAD) {
     if (PTINRECT(x, y, padDButt.x, padDButt.y, padDButt.w, padDButt.h)) {
       if (BTTrack(&padDButt)) {
@@ -16,8 +16,12 @@
 #define NEEDSDIR
 #include "xv.h"
 
+#if defined(GS_PATH) && !defined(VMS)
+#  include <sys/wait.h>
+#endif
+
 #define PSWIDE 431
-#define PSHIGH 350
+#define PSHIGH 370
 #define PMAX   200    /* size of square that a 'page' has to fit into */
 
 #define PS_BOK    0
@@ -74,6 +78,41 @@ static void psRleCmapImage PARM((FILE *, int));
 static void epsPreview     PARM((FILE *, byte *, int, int, int, int, 
 				 byte *, byte *, byte *, int));
 static int  writeBWStip    PARM((FILE *, byte *, char *, int, int, int));
+static int  packBWRow      PARM((byte *, byte *, int, int));
+static void rle_packbits   PARM((byte *, int));
+static void psoStart       PARM((FILE *));
+static void psoText        PARM((char *));
+static void psoHex         PARM((byte *, int));
+static void psoHexRow      PARM((byte *, int, char *, int));
+static void psoA85         PARM((byte *, int));
+static int  psoEnd         PARM((int));
+static void psoFlush       PARM((void));
+
+#if defined(GS_PATH) && !defined(VMS)
+#define GS_CACHE 4    /* # of rendered pages kept by a gs page source */
+
+/* a multi-page document whose pages are rendered by gs as they're asked
+   for.  The document is kept open (it may be a temp file that xv is about
+   to delete), and handed to each gs as its standard input */
+typedef struct { FILE    *fp;
+		 char     name[64];             /* for messages */
+		 int      pdf;
+		 int      npages;
+		 int      cpage[GS_CACHE];      /* page in each slot, or -1 */
+		 long     cused[GS_CACHE];      /* when it was last asked for */
+		 PICINFO  cinfo[GS_CACHE];
+		 long     clock;
+	       } GSDOC;
+
+static int  gsPipeable     PARM((void));
+static int  gsVersion      PARM((void));
+static int  gsCountPages   PARM((FILE *, int));
+static int  gsRender       PARM((FILE *, char *, int, int, PICINFO *));
+static void gsInfo         PARM((PICINFO *, int, int, int));
+static void gsStore        PARM((GSDOC *, int, PICINFO *));
+static int  gsPage         PARM((PAGESRC *, int, PICINFO *));
+static void gsFree         PARM((PAGESRC *));
+#endif
 
 
 
@@ -119,6 +158,20 @@ static int   colorType;         /* value of 'Colors' rbutt in dir box */
 static int   firsttime=1;       /* first time PSDialog being opened ? */
 
 
+/* image data is encoded (as hex digits, or ASCII base-85) into psoBuf,
+   which is written out whenever it fills up.  See psoStart(), et al. */
+
+#define PSOBUFSIZE 65536
+#define PSOHEXLINE 36           /* bytes per line of hex data */
+#define PSOA85LINE 75           /* chars per line of ASCII85 data */
+
+static FILE *psoFile;
+static char *psoBuf = (char *) NULL;
+static int   psoLen, psoErr, psoCol, psoNtup;
+static unsigned long psoTuple;
+static char  psoHexTab[512];    /* 2 hex digits for each byte value */
+
+
 /***************************************************/
 void CreatePSD(geom)
 char *geom;
@@ -138,6 +191,8 @@ char *geom;
 
   CBCreate(&encapsCB, psW, 240, 7, "preview", infofg, infobg, hicol, locol);
   CBCreate(&pscompCB, psW, 331, 7, "compress", infofg, infobg, hicol, locol);
+  CBCreate(&pslevel2CB, psW, 240, 190+90+22, "Level 2 PostScript", 
+	   infofg, infobg, hicol, locol);
 
   DCreate(&xsDial, psW, 240, 30, 80, 100, 10.0, 800.0, 100.0, 0.5, 5.0, 
 	  infofg, infobg, hicol, locol, "Width", "%");
@@ -420,6 +475,7 @@ int x,y,w,h;
 
   CBRedraw(&encapsCB);
   if (colorType != F_BWDITHER && picType!=PIC24) CBRedraw(&pscompCB);
+  CBRedraw(&pslevel2CB);
   CBRedraw(&lockCB);
 
   ULineString(psW, orientRB->x-16, orientRB->y-3-DESCENT, "Orientation:");
@@ -598,6 +654,7 @@ int x,y;
 
   else if (CBClick(&encapsCB,x,y)) CBTrack(&encapsCB);
   else if (CBClick(&pscompCB,x,y)) CBTrack(&pscompCB);
+  else if (CBClick(&pslevel2CB,x,y)) CBTrack(&pslevel2CB);
 }
 
 
@@ -888,10 +945,10 @@ double newx, newy;
 static void writePS()
 {
   FILE *fp;
-  int   i, j, q, err, rpix, gpix, bpix, nc, ptype;
-  int   iw, ih, ox, oy, slen, lwidth, bits, colorps, w, h, pfree;
+  int   i, j, err, nc, ptype, level2, rlecmap;
+  int   iw, ih, ox, oy, slen, bits, colorps, w, h, pfree;
   double iwf, ihf;
-  byte *inpix, *rmap, *gmap, *bmap;
+  byte *inpix, *rmap, *gmap, *bmap, *row, *ip;
 
   slen = bits = colorps = 0;
 
@@ -903,6 +960,9 @@ static void writePS()
   
   inpix = GenSavePic(&ptype, &w, &h, &pfree, &nc, &rmap, &gmap, &bmap);
 
+  level2  = pslevel2CB.val;
+  rlecmap = (ptype==PIC8 && pscompCB.val && colorType != F_BWDITHER);
+
     
   /* printed image will have size iw,ih (in picas) */
   iw = (int) (sz_inx * 72.0 + 0.5);
@@ -931,6 +991,7 @@ static void writePS()
   else 
     fprintf(fp,"%%%%BoundingBox: %d %d %d %d\n", ox, oy, ox+iw, oy+ih);
 
+  if (level2) fprintf(fp,"%%%%LanguageLevel: 2\n");
   fprintf(fp,"%%%%Pages: 1\n");
   fprintf(fp,"%%%%DocumentFonts:\n");
   fprintf(fp,"%%%%EndComments\n");
@@ -958,20 +1019,22 @@ static void writePS()
   fprintf(fp,"%% build a temporary dictionary\n");
   fprintf(fp,"20 dict begin\n\n");
 
-  if (colorType == F_BWDITHER || ptype==PIC24 || !pscompCB.val) {
-    fprintf(fp,"%% define string to hold a scanline's worth of data\n");
-    fprintf(fp,"/pix %d string def\n\n", slen);
-  }
+  if (!level2) {
+    if (colorType == F_BWDITHER || ptype==PIC24 || !pscompCB.val) {
+      fprintf(fp,"%% define string to hold a scanline's worth of data\n");
+      fprintf(fp,"/pix %d string def\n\n", slen);
+    }
 
-  /*
-   * Add loop invariant strings that should not be defined
-   * over and over again inside a loop
-   * K. Schnepper DLR FF-DR Oberpfaffenhofen, Mai 12. 1993
-   */
-  fprintf(fp,"%% define space for color conversions\n");
-  fprintf(fp,"/grays %d string def  %% space for gray scale line\n", w);
-  fprintf(fp,"/npixls 0 def\n");
-  fprintf(fp,"/rgbindx 0 def\n\n");
+    /*
+     * Add loop invariant strings that should not be defined
+     * over and over again inside a loop
+     * K. Schnepper DLR FF-DR Oberpfaffenhofen, Mai 12. 1993
+     */
+    fprintf(fp,"%% define space for color conversions\n");
+    fprintf(fp,"/grays %d string def  %% space for gray scale line\n", w);
+    fprintf(fp,"/npixls 0 def\n");
+    fprintf(fp,"/rgbindx 0 def\n\n");
+  }
 
 
   if (RBWhich(orientRB)==ORNT_LAND) {   /* Landscape mode */
@@ -1000,12 +1063,43 @@ static void writePS()
   fprintf(fp,"%% size of image (on paper, in 1/72inch coords)\n");
   fprintf(fp,"%.5f %.5f scale\n\n",iwf,ihf);
 
-  if (colorType == F_BWDITHER) {   /* 1-bit dither code uses 'image' */
-    int flipbw;
 
-    /* set if color#0 is white */
-    flipbw = (MONO(rmap[0],gmap[0],bmap[0]) > MONO(rmap[1],gmap[1],bmap[1]));
+  /* a scanline's worth of data (worst case is an rle'd line, which can
+     be up to w * 129/128 bytes, plus a bit) */
+  row = (byte *) malloc((size_t) slen + w/64 + 4);
+  if (!row) FatalError("unable to malloc row in writePS()\n");
+
+
+  if (level2) {      /* Level 2:  'image' dictionary, and filters */
+    if (rlecmap) {
+      fprintf(fp,"%% indexed color, to go with the run-length encoding\n");
+      fprintf(fp,"[/Indexed /%s %d <\n", 
+	      (colorps) ? "DeviceRGB" : "DeviceGray", nc-1);
+      for (i=0; i<nc; i++) {
+	if (colorps) fprintf(fp,"%02x%02x%02x ", rmap[i],gmap[i],bmap[i]);
+	else fprintf(fp,"%02x ", MONO(rmap[i],gmap[i],bmap[i]));
+	if ((i%10) == 9) fprintf(fp,"\n");
+      }
+      fprintf(fp,">] setcolorspace\n\n");
+    }
+    else fprintf(fp,"/%s setcolorspace\n\n", 
+		 (colorps) ? "DeviceRGB" : "DeviceGray");
+
+    fprintf(fp,"<<\n");
+    fprintf(fp,"  /ImageType 1\n");
+    fprintf(fp,"  /Width %d  /Height %d\n", w, h);
+    fprintf(fp,"  /BitsPerComponent %d\n", bits);
+    if      (rlecmap) fprintf(fp,"  /Decode [0 255]\n");
+    else if (colorps) fprintf(fp,"  /Decode [0 1 0 1 0 1]\n");
+    else              fprintf(fp,"  /Decode [0 1]\n");
+    fprintf(fp,"  /ImageMatrix [%d 0 0 %d 0 %d]\n", w, -h, h);
+    fprintf(fp,"  /DataSource currentfile /ASCII85Decode filter%s\n",
+	    (rlecmap) ? " /RunLengthDecode filter" : "");
+    fprintf(fp,">>\n");
+    fprintf(fp,"image\n");
+  }
 
+  else if (colorType == F_BWDITHER) {   /* 1-bit dither code uses 'image' */
     fprintf(fp,"%% dimensions of data\n");
     fprintf(fp,"%d %d %d\n\n",w,h,bits);
 
@@ -1014,20 +1108,13 @@ static void writePS()
 
     fprintf(fp,"{currentfile pix readhexstring pop}\n");
     fprintf(fp,"image\n");
-
-    /* write the actual image data */
-
-    err = writeBWStip(fp, inpix, "", w, h, flipbw);
   }
 
   else {      /* all other formats */
-    byte *rleline = (byte *) NULL;
-    unsigned long outbytes = 0;
-
     /* if we're using color, make sure 'colorimage' is defined */
     if (colorps) psColorImage(fp);
 
-    if (ptype==PIC8 && pscompCB.val) {  /* write cmap & rle-cmapped image fn */
+    if (rlecmap) {  /* write cmap & rle-cmapped image fn */
       psColorMap(fp, colorps, nc, rmap, gmap, bmap);
       psRleCmapImage(fp, colorps);
     }
@@ -1035,74 +1122,72 @@ static void writePS()
     fprintf(fp,"%d %d %d\t\t\t%% dimensions of data\n",w,h,bits);
     fprintf(fp,"[%d 0 0 %d 0 %d]\t\t%% mapping matrix\n", w, -h, h);
 
-    if (ptype==PIC8 && pscompCB.val) fprintf(fp,"rlecmapimage\n");
+    if (rlecmap) fprintf(fp,"rlecmapimage\n");
     else {
       fprintf(fp,"{currentfile pix readhexstring pop}\n");
       if (colorps) fprintf(fp,"false 3 colorimage\n");
               else fprintf(fp,"image\n");
     }
+  }
 
-    /* dump the image data to the file */
-    err = 0;
 
-    if (ptype==PIC8 && pscompCB.val) {
-      rleline  = (byte *) malloc((size_t) w * 2);  /* worst-case */
-      if (!rleline) FatalError("unable to malloc rleline in writePS()\n");
-    }
+  /* dump the image data to the file, one scanline at a time */
 
-    for (i=0; i<h && err != EOF; i++) {
-      int rlen;
-      lwidth = 0;
-      putc('\n',fp);
+  if (colorType == F_BWDITHER && !level2) {
+    int flipbw;
 
-      if ((i&0x1f) == 0) WaitCursor();
+    /* set if color#0 is white */
+    flipbw = (MONO(rmap[0],gmap[0],bmap[0]) > MONO(rmap[1],gmap[1],bmap[1]));
+    err = writeBWStip(fp, inpix, "", w, h, flipbw);
+  }
 
-      if (ptype==PIC8 && pscompCB.val) { /* write rle-encoded cmapped image */
-	rlen = rle_encode(inpix, rleline, w);
-	inpix += w;
-	outbytes += rlen;
+  else {
+    unsigned long outbytes = 0;
+    byte *pp;
+    int   rlen, flipbw;
+
+    /* set if color#0 is white */
+    flipbw = (MONO(rmap[0],gmap[0],bmap[0]) > MONO(rmap[1],gmap[1],bmap[1]));
 
-	for (j=0; j<rlen && err != EOF; j++) {
-	  err = fprintf(fp,"%02x", rleline[j]);
-	  lwidth += 2;
+    psoStart(fp);
 
-	  if (lwidth>70) { putc('\n',fp); lwidth = 0; }
-	}
+    for (i=0, ip=inpix; i<h; i++, ip += w * ((ptype==PIC24) ? 3 : 1)) {
+      if ((i&0x1f) == 0) WaitCursor();
+
+      if (colorType == F_BWDITHER)       /* 'image' wants 1 = white */
+	rlen = packBWRow(ip, row, w, flipbw);
+
+      else if (rlecmap) {                /* rle-encoded cmapped image */
+	rlen = rle_encode(ip, row, w);
+	if (level2) rle_packbits(row, rlen);
+	outbytes += rlen;
       }
 
-      else {  /* write non-rle raw (gray/rgb) image data */
-	for (j=0; j<w && err != EOF; j++) {
+      else {                             /* raw (gray/rgb) image data */
+	for (j=0, pp=row; j<w; j++) {
+	  int rpix, gpix, bpix;
 
 	  if (ptype == PIC8) {
-	    rpix = rmap[*inpix];
-	    gpix = gmap[*inpix];
-	    bpix = bmap[*inpix];
+	    rpix = rmap[ip[j]];  gpix = gmap[ip[j]];  bpix = bmap[ip[j]];
 	  }
 	  else {  /* PIC24 */
-	    rpix = inpix[0];
-	    gpix = inpix[1];
-	    bpix = inpix[2];
-	  }
-	  
-	  if (colorps) { 
-	    err = fprintf(fp,"%02x%02x%02x",rpix,gpix,bpix);
-	    lwidth+=6;
-	  }
-      
-	  else {  /* greyscale */
-	    err = fprintf(fp,"%02x", MONO(rpix,gpix,bpix));
-	    lwidth+=2;
+	    rpix = ip[j*3];  gpix = ip[j*3+1];  bpix = ip[j*3+2];
 	  }
 
-	  if (lwidth>70) { putc('\n',fp); lwidth = 0; }
-
-	  inpix += (ptype==PIC24) ? 3 : 1;
+	  if (colorps) { *pp++ = rpix;  *pp++ = gpix;  *pp++ = bpix; }
+	          else   *pp++ = MONO(rpix,gpix,bpix);
 	}
+	rlen = pp - row;
       }
+
+      if (level2) psoA85(row, rlen);
+      else psoHexRow(row, rlen, (char *) NULL, 1);
     }
 
-    if (ptype==PIC8 && pscompCB.val) {
-      free(rleline);
+    if (level2 && rlecmap) { row[0] = 128;  psoA85(row, 1); }  /* EOD */
+    err = psoEnd(level2);
+
+    if (rlecmap) {
       fprintf(fp,"\n\n");
       fprintf(fp,"%%\n");
       fprintf(fp,"%% Compression made this file %.2f%% %s\n",
@@ -1113,6 +1198,8 @@ static void writePS()
     }
   }
 
+  free(row);
+
 
   fprintf(fp,"\n\nshowpage\n\n");
 
@@ -1478,45 +1565,220 @@ static int writeBWStip(fp, pic, prompt, w, h, flipbw)
 
      returns '0' if everythings fine, 'EOF' if writing failed */
 
-  int err, i, j, lwidth;
-  byte outbyte, bitnum, bit;
+  int   i, n;
+  byte *row;
 
-  err = 0;
+  row = (byte *) malloc((size_t) (w+7)/8);
+  if (!row) FatalError("unable to malloc row in writeBWStip()");
+
+  psoStart(fp);
+  for (i=0; i<h; i++, pic += w) {
+    if ((i&0x3f) == 0) WaitCursor();
+    n = packBWRow(pic, row, w, flipbw);
+    psoHexRow(row, n, prompt, 0);
+  }
 
-  for (i=0; i<h && err != EOF; i++) {
-    fprintf(fp, "%s", prompt);
+  free(row);
+  return psoEnd(0);
+}
 
-    outbyte = bitnum = lwidth = 0;
 
-    if ((i&0x3f) == 0) WaitCursor();
+/***********************************/
+static int packBWRow(pic, row, w, flipbw)
+     byte *pic, *row;
+     int   w, flipbw;
+{
+  /* packs a row of 'w' B/W pixels (1 byte per pixel) into 'row', 8 to a
+     byte, msb first, inverting them if 'flipbw'.  Returns # of bytes */
+
+  int  j, n;
+  byte outbyte;
+
+  for (j=0, n=0; j<w; n++) {
+    for (outbyte=0; (j&7) != 7 && j<w-1; j++) 
+      outbyte = (outbyte<<1) | (pic[j] & 0x01);
+    outbyte = (outbyte<<1) | (pic[j] & 0x01);
+    outbyte <<= 7 - (j&7);
+    j++;
+    row[n] = (flipbw) ? ~outbyte & 0xff : outbyte;
+  }
 
-    for (j=0; j<w && err != EOF; j++) {
-      bit = *pic;
-      outbyte = (outbyte<<1) | ((bit)&0x01);
-      bitnum++;
+  return n;
+}
 
-      if (bitnum==8) {
-	if (flipbw) outbyte = ~outbyte & 0xff;
-	err = fprintf(fp,"%02x",outbyte);
-	lwidth+=2;
-	outbyte = bitnum = 0;
-      }
 
-      if (lwidth>=72 && j+1<w) { fprintf(fp, "\n%s", prompt); lwidth = 0; }
-      pic++;
+/**********************************************/
+static void rle_packbits(rleline, rlen)
+     byte *rleline;
+     int   rlen;
+{
+  /* turns the output of rle_encode() into the (same-sized) form that the
+     RunLengthDecode filter reads:  'n' followed by n+1 bytes, or 257-n
+     followed by a byte that's repeated n times */
+
+  int i, c;
+
+  for (i=0; i<rlen; ) {
+    c = rleline[i];
+    if (c & 0x80) {                  /* non-run block of (c&0x7f)+1 */
+      rleline[i] = c & 0x7f;
+      i += (c & 0x7f) + 2;
     }
+    else {                           /* run of c+1.  runs of 1 aren't runs */
+      rleline[i] = (c) ? 256 - c : 0;
+      i += 2;
+    }
+  }
+}
+
 
-    if (bitnum) {   /* few bits left over... */
-      for ( ; bitnum<8; bitnum++) outbyte <<= 1;
-      if (flipbw) outbyte = ~outbyte & 0xff;
-      err = fprintf(fp,"%02x",outbyte);
-      lwidth+=2;
+/**********************************************/
+static void psoStart(fp)
+     FILE *fp;
+{
+  /* starts writing encoded image data to 'fp' */
+
+  int i;
+  static char *hex = "0123456789abcdef";
+
+  if (!psoBuf) {
+    psoBuf = (char *) malloc((size_t) PSOBUFSIZE);
+    if (!psoBuf) FatalError("unable to malloc PostScript output buffer");
+
+    for (i=0; i<256; i++) {
+      psoHexTab[i*2]   = hex[i>>4];
+      psoHexTab[i*2+1] = hex[i&15];
     }
+  }
 
-    fprintf(fp, "\n");
+  psoFile = fp;
+  psoLen  = psoErr = psoCol = psoNtup = 0;
+  psoTuple = 0;
+}
+
+
+/**********************************************/
+static void psoFlush()
+{
+  if (psoLen && fwrite(psoBuf, (size_t) 1, (size_t) psoLen, psoFile) != 
+      (size_t) psoLen) psoErr = 1;
+  psoLen = 0;
+}
+
+
+/**********************************************/
+static void psoText(str)
+     char *str;
+{
+  while (*str) {
+    if (psoLen == PSOBUFSIZE) psoFlush();
+    psoBuf[psoLen++] = *str++;
   }
+}
+
+
+/**********************************************/
+static void psoHex(p, n)
+     byte *p;
+     int   n;
+{
+  /* appends 'n' bytes worth of hex digits.  No line breaks */
+
+  char *hp;
 
-  return err;
+  for ( ; n>0; n--, p++) {
+    if (psoLen > PSOBUFSIZE - 2) psoFlush();
+    hp = psoHexTab + (*p << 1);
+    psoBuf[psoLen++] = hp[0];
+    psoBuf[psoLen++] = hp[1];
+  }
+}
+
+
+/**********************************************/
+static void psoHexRow(p, n, prompt, lead)
+     byte *p;
+     int   n, lead;
+     char *prompt;
+{
+  /* writes a scanline's worth of bytes as hex, PSOHEXLINE bytes per line.
+     If 'lead', the scanline starts on a new line (and a line is only 
+     ended if it's full), otherwise every line starts with 'prompt', and 
+     ends with a newline */
+
+  int k;
+
+  if (lead) psoText("\n");
+
+  for ( ; n>0; n-=k, p+=k) {
+    k = (n > PSOHEXLINE) ? PSOHEXLINE : n;
+    if (!lead) psoText(prompt);
+    psoHex(p, k);
+    if (!lead || k == PSOHEXLINE) psoText("\n");
+  }
+}
+
+
+/**********************************************/
+static void psoA85(p, n)
+     byte *p;
+     int   n;
+{
+  /* appends 'n' bytes, ASCII base-85 encoded (every 4 bytes become 5 chars,
+     from '!' to 'u', or 'z' if they were all zero) */
+
+  int           i;
+  unsigned long t;
+  char          c5[5];
+
+  for ( ; n>0; n--, p++) {
+    psoTuple = (psoTuple << 8) | *p;
+    if (++psoNtup < 4) continue;
+
+    if (psoLen > PSOBUFSIZE - 8) psoFlush();
+    t = psoTuple & 0xffffffffUL;
+    if (t == 0) {
+      psoBuf[psoLen++] = 'z';
+      psoCol++;
+    }
+    else {
+      for (i=4; i>=0; i--) { c5[i] = (char) ('!' + t % 85);  t /= 85; }
+      for (i=0; i<5; i++) psoBuf[psoLen++] = c5[i];
+      psoCol += 5;
+    }
+
+    if (psoCol >= PSOA85LINE) { psoBuf[psoLen++] = '\n';  psoCol = 0; }
+    psoTuple = 0;  psoNtup = 0;
+  }
+}
+
+
+/**********************************************/
+static int psoEnd(a85)
+     int a85;
+{
+  /* finishes off the image data (adding the ASCII85 end-of-data marker, if
+     'a85'), and writes out whatever's left.  Returns '0' if everything
+     went out, or 'EOF' if writing failed */
+
+  int           i, n;
+  unsigned long t;
+  char          c5[5];
+
+  if (a85) {
+    if (psoLen > PSOBUFSIZE - 8) psoFlush();
+
+    if (psoNtup) {           /* 1-3 bytes left:  pad, and write n+1 chars */
+      n = psoNtup;
+      t = (psoTuple << (8 * (4-n))) & 0xffffffffUL;
+      for (i=4; i>=0; i--) { c5[i] = (char) ('!' + t % 85);  t /= 85; }
+      for (i=0; i<=n; i++) psoBuf[psoLen++] = c5[i];
+    }
+    psoText("~>\n");
+  }
+
+  psoFlush();
+  return (psoErr || ferror(psoFile)) ? EOF : 0;
 }
 
 
@@ -1530,10 +1792,13 @@ int LoadPS(fname, pinfo, quick)
      PICINFO *pinfo;
      int      quick;
 {
-  /* returns '1' if successful.  If the document is a single page, the
-     a temporary PNM file is created, loaded, and deleted.  If the
-     document is multiple pages, a series of PNM files are created, and
-     the first one is loaded (but not deleted) */
+  /* returns '1' if successful.  If Ghostscript's output is a PNM format
+     (the usual case) it's read straight out of a pipe, one page at a time:
+     page 1 is rendered and loaded, and if the number of pages can be
+     found in the document, the rest are left to a PAGESRC that renders
+     them when they're asked for.  Otherwise, gs renders every page into
+     a series of PNM files, the first of which is loaded (and deleted, if
+     it's the only page) */
 
 
   char tmp[512], tmp1[512], tmpname[64];
@@ -1546,6 +1811,68 @@ int LoadPS(fname, pinfo, quick)
 
 #ifdef GS_PATH
 
+#ifndef VMS
+  if (gsPipeable()) {
+    FILE    *fp;
+    PAGESRC *ps;
+    GSDOC   *gd;
+    int      pdf;
+
+    fp = xv_fopen(fname, "r");
+    if (!fp) {
+      SetISTR(ISTR_WARNING, "LoadPS: couldn't open '%s'", fname);
+      return 0;
+    }
+
+    pdf  = (getc(fp) == '%' && getc(fp) == 'P');
+    nump = (quick) ? 1 : gsCountPages(fp, pdf);
+
+    /* -dFirstPage/-dLastPage only work on PostScript in gs 9.54 and later.
+       If they won't, render the whole thing the old way */
+    if (nump > 1 && !pdf && gsVersion() < 954) nump = 0;
+
+    if (nump >= 1) {
+      WaitCursor();
+      SetISTR(ISTR_INFO, "Running '%s'...", GS_PATH);
+
+      if (!gsRender(fp, BaseName(fname), pdf, 0, pinfo)) {
+	fclose(fp);
+	SetCursors(-1);
+	return 0;
+      }
+      gsInfo(pinfo, pdf, 1, nump);
+
+      if (nump == 1) fclose(fp);
+      else {
+	ps = (PAGESRC *) malloc(sizeof(PAGESRC));
+	gd = (GSDOC *)   malloc(sizeof(GSDOC));
+	if (!ps || !gd) FatalError("Insufficient memory for gs page source");
+
+	gd->fp     = fp;
+	gd->pdf    = pdf;
+	gd->npages = nump;
+	gd->clock  = 0;
+	strncpy(gd->name, BaseName(fname), sizeof(gd->name) - 1);
+	gd->name[sizeof(gd->name) - 1] = '\0';
+	for (i=0; i<GS_CACHE; i++) gd->cpage[i] = -1;
+	gsStore(gd, 0, pinfo);
+
+	ps->npages = nump;
+	ps->load   = gsPage;
+	ps->free   = gsFree;
+	ps->data   = (char *) gd;
+	pinfo->pages = ps;
+      }
+
+      SetCursors(-1);
+      return 1;
+    }
+
+    fclose(fp);     /* couldn't count the pages.  do it the old way */
+  }
+#endif /* VMS */
+
+
 #ifndef VMS
   sprintf(tmpname, "%s/xvpgXXXXXX", tmpdir);
 #else
@@ -1712,3 +2039,309 @@ int LoadPS(fname, pinfo, quick)
 		 we don't have 'gs' package */
 }
 
+
+
+#if defined(GS_PATH) && !defined(VMS)
+
+/***********************************/
+static int gsPipeable()
+{
+  /* returns '1' if gsDev produces something LoadPBMStream() can read */
+
+  return (!strncmp(gsDev, "pbm", (size_t) 3) ||
+	  !strncmp(gsDev, "pgm", (size_t) 3) ||
+	  !strncmp(gsDev, "ppm", (size_t) 3) ||
+	  !strncmp(gsDev, "pnm", (size_t) 3));
+}
+
+
+/***********************************/
+static int gsVersion()
+{
+  /* returns the version of gs as 100*major + minor (ie, '954' for 9.54),
+     or 0 if it can't be determined.  Only asks gs once */
+
+  static int vers = -1;
+  FILE *fp;
+  int   maj, min;
+
+  if (vers >= 0) return vers;
+
+  vers = 0;
+  fp = popen(GS_PATH " --version", "r");
+  if (fp) {
+    if (fscanf(fp, "%d.%d", &maj, &min) == 2) vers = maj * 100 + min;
+    pclose(fp);
+  }
+
+  if (DEBUG) fprintf(stderr,"gsVersion:  %d\n", vers);
+  return vers;
+}
+
+
+/***********************************/
+static int gsCountPages(fp, pdf)
+     FILE *fp;
+     int   pdf;
+{
+  /* returns the number of pages in the document, going by its '%%Pages:'
+     comment (PostScript), or by counting '/Type /Page' objects (PDF).
+     Returns 0 if it can't tell.  (PDFs that keep their objects in
+     compressed object streams can't be counted this way.) */
+
+  static char *key = "/Type";
+  char  line[256];
+  int   c, n, k;
+
+  rewind(fp);
+  n = 0;
+
+  if (!pdf) {
+    while (fgets(line, (int) sizeof(line), fp)) {
+      if (!strncmp(line, "%%Pages:", (size_t) 8) &&
+	  sscanf(line+8, "%d", &k) == 1 && k > 0) {
+	n = k;  break;     /* if it's '(atend)', keep looking */
+      }
+    }
+  }
+
+  else {
+    k = 0;
+    while ((c = getc(fp)) != EOF) {
+      if (key[k]) {                          /* matching '/Type' */
+	k = (c == key[k]) ? k+1 : (c == '/');
+	continue;
+      }
+
+      while (c==' ' || c=='\t' || c=='\r' || c=='\n') c = getc(fp);
+      if (c == '/' && getc(fp) == 'P' && getc(fp) == 'a' &&
+	  getc(fp) == 'g' && getc(fp) == 'e') {
+	c = getc(fp);
+	if (!isalnum(c)) n++;                /* not '/Pages' */
+      }
+      if (c == EOF) break;
+      k = (c == '/');
+    }
+  }
+
+  rewind(fp);
+  if (DEBUG) fprintf(stderr,"gsCountPages:  %d pages\n", n);
+  return n;
+}
+
+
+/***********************************/
+static int gsRender(fp, name, pdf, page, pinfo)
+     FILE    *fp;
+     char    *name;
+     int      pdf, page;
+     PICINFO *pinfo;
+{
+  /* has gs render page #page (0..n-1) of the document open on 'fp', and
+     reads the result out of a pipe, into pinfo.  Returns '1' on success */
+
+  char  *args[16], devarg[64], resarg[32], farg[32], larg[32], geomarg[80];
+#ifdef GS_LIB
+  char   incarg[MAXPATHLEN+3];
+#endif
+  int    fds[2], nargs, rv, status;
+  pid_t  pid;
+  FILE  *gsfp;
+  struct stat st;
+
+  sprintf(devarg,  "-sDEVICE=%s", gsDev);
+  sprintf(resarg,  "-r%d", gsRes);
+  sprintf(farg,    "-dFirstPage=%d", page+1);
+  sprintf(larg,    "-dLastPage=%d",  page+1);
+
+  nargs = 0;
+  args[nargs++] = GS_PATH;
+  args[nargs++] = devarg;
+  args[nargs++] = resarg;
+  args[nargs++] = "-q";
+  args[nargs++] = "-dNOPAUSE";
+  args[nargs++] = "-dBATCH";
+  args[nargs++] = "-sstdout=%stderr";   /* keep gs's chatter out of the pic */
+  args[nargs++] = "-sOutputFile=-";
+  args[nargs++] = farg;
+  args[nargs++] = larg;
+
+#ifdef GS_LIB
+  sprintf(incarg, "-I%s", GS_LIB);
+  args[nargs++] = incarg;
+#endif
+
+  if (gsGeomStr) {
+    sprintf(geomarg, "-g%.70s", gsGeomStr);
+    args[nargs++] = geomarg;
+  }
+
+  /* gs reads the document from its stdin.  PDFs have to be seekable,
+     so name it, if there's a way to, rather than using '-' */
+  args[nargs++] = (pdf && stat("/dev/fd/0", &st) == 0) ? "/dev/fd/0" : "-";
+  args[nargs]   = (char *) NULL;
+
+  if (DEBUG) fprintf(stderr,"gsRender:  page %d of '%s'\n", page+1, name);
+
+  if (pipe(fds) < 0) {
+    SetISTR(ISTR_WARNING, "LoadPS: couldn't create pipe: %s", ERRSTR(errno));
+    return 0;
+  }
+
+  fflush(stdout);  fflush(stderr);
+  pid = fork();
+  if (pid < 0) {
+    close(fds[0]);  close(fds[1]);
+    SetISTR(ISTR_WARNING, "LoadPS: couldn't fork: %s", ERRSTR(errno));
+    return 0;
+  }
+
+  if (pid == 0) {                         /* child:  becomes gs */
+    dup2(fileno(fp), 0);
+    dup2(fds[1], 1);
+    close(fds[0]);  close(fds[1]);
+    lseek(0, 0L, 0);
+    execvp(GS_PATH, args);
+    fprintf(stderr, "%s: couldn't run '%s': %s\n",
+	    cmd, GS_PATH, ERRSTR(errno));
+    _exit(1);
+  }
+
+  close(fds[1]);
+  gsfp = fdopen(fds[0], "r");
+  if (!gsfp) {
+    close(fds[0]);
+    rv = 0;
+  }
+  else {
+    rv = LoadPBMStream(gsfp, name, pinfo);
+    fclose(gsfp);
+  }
+
+  /* all that's wanted has been read.  If this gs doesn't understand
+     -dLastPage, it may well be busy rendering the next page... */
+  kill(pid, SIGTERM);
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+
+  if (!rv) {
+    SetISTR(ISTR_WARNING, "Ghostscript couldn't render page %d of '%s'.",
+	    page+1, name);
+    return 0;
+  }
+
+  pinfo->anim  = (ANIMSRC *) NULL;
+  pinfo->pages = (PAGESRC *) NULL;
+  if (pinfo->deep) DeepFree(pinfo->deep);
+  pinfo->deep  = (DEEPPIC *) NULL;
+  return 1;
+}
+
+
+/***********************************/
+static void gsInfo(pinfo, pdf, page, npages)
+     PICINFO *pinfo;
+     int      pdf, page, npages;
+{
+  if (npages > 1)
+    sprintf(pinfo->fullInfo, "%s, page %d of %d, rendered at %d dpi.",
+	    (pdf) ? "PDF" : "PostScript", page, npages, gsRes);
+  else
+    sprintf(pinfo->fullInfo, "%s, rendered at %d dpi.",
+	    (pdf) ? "PDF" : "PostScript", gsRes);
+
+  sprintf(pinfo->shrtInfo, "%dx%d %s.", pinfo->w, pinfo->h,
+	  (pdf) ? "PDF" : "PostScript");
+}
+
+
+/***********************************/
+static void gsStore(gd, page, pinfo)
+     GSDOC   *gd;
+     int      page;
+     PICINFO *pinfo;
+{
+  /* keeps a copy of the page that's just been rendered into 'pinfo',
+     in place of the one that hasn't been looked at for the longest */
+
+  PICINFO *cp;
+  size_t   size;
+  int      i, slot;
+
+  for (i=0, slot=0; i<GS_CACHE; i++) {
+    if (gd->cpage[i] < 0) { slot = i;  break; }
+    if (gd->cused[i] < gd->cused[slot]) slot = i;
+  }
+
+  cp = &(gd->cinfo[slot]);
+  if (gd->cpage[slot] >= 0) free(cp->pic);
+  gd->cpage[slot] = -1;
+
+  size = (size_t) pinfo->w * pinfo->h * ((pinfo->type == PIC24) ? 3 : 1);
+  *cp = *pinfo;
+  cp->comment = (char *) NULL;
+  cp->pic = (byte *) malloc(size);
+  if (!cp->pic) return;                 /* no big deal */
+
+  xvbcopy((char *) pinfo->pic, (char *) cp->pic, size);
+  gd->cpage[slot] = page;
+  gd->cused[slot] = gd->clock++;
+}
+
+
+/***********************************/
+static int gsPage(ps, n, pinfo)
+     PAGESRC *ps;
+     int      n;
+     PICINFO *pinfo;
+{
+  /* the PAGESRC 'load' function:  loads page #n, from the cache if it's
+     there, otherwise from gs */
+
+  GSDOC   *gd;
+  size_t   size;
+  byte    *pic;
+  int      i;
+
+  gd = (GSDOC *) ps->data;
+
+  for (i=0; i<GS_CACHE; i++) {
+    if (gd->cpage[i] != n) continue;
+
+    size = (size_t) gd->cinfo[i].w * gd->cinfo[i].h *
+      ((gd->cinfo[i].type == PIC24) ? 3 : 1);
+    pic = (byte *) malloc(size);
+    if (!pic) break;                    /* try rendering it, then... */
+
+    xvbcopy((char *) gd->cinfo[i].pic, (char *) pic, size);
+    *pinfo = gd->cinfo[i];
+    pinfo->pic = pic;
+    gd->cused[i] = gd->clock++;
+    return 1;
+  }
+
+  WaitCursor();
+  if (!gsRender(gd->fp, gd->name, gd->pdf, n, pinfo)) return 0;
+  gsInfo(pinfo, gd->pdf, n+1, gd->npages);
+  gsStore(gd, n, pinfo);
+  return 1;
+}
+
+
+/***********************************/
+static void gsFree(ps)
+     PAGESRC *ps;
+{
+  GSDOC *gd;
+  int    i;
+
+  gd = (GSDOC *) ps->data;
+  for (i=0; i<GS_CACHE; i++)
+    if (gd->cpage[i] >= 0) free(gd->cinfo[i].pic);
+
+  fclose(gd->fp);
+  free(gd);
+  free(ps);
+}
+
+#endif /* GS_PATH && !VMS */
+
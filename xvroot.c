@@ -17,6 +17,7 @@
 
 /* local function pre-definitions */
 static void killRootPix PARM((void));
+static void mirrorPix   PARM((Pixmap, int, int));
 
 
 /***********************************/
@@ -31,6 +32,7 @@ void MakeRootPic()
   unsigned int rpixw, rpixh;
 
   killRootPix();
+  FillXImage(0, 0, eWIDE, eHIGH);   /* all of theImage goes into the root */
 
   rmode = rootMode;
   /* if eWIDE,eHIGH == dispWIDE,dispHIGH just use 'normal' mode to save mem */
@@ -72,31 +74,10 @@ void MakeRootPic()
   }
 
   else if (rmode == RM_MIRROR || rmode == RM_IMIRROR) {
-    /* quadrant 2 */
+    /* quadrant 2, and the flipped ones are copied from it in the server */
     XPutImage(theDisp, tmpPix, theGC, theImage, 0,0, 0,0, 
 	      (u_int) eWIDE, (u_int) eHIGH);
-    if (epic == NULL) FatalError("epic == NULL in RM_MIRROR code...\n");
-
-    /* quadrant 1 */
-    FlipPic(epic, eWIDE, eHIGH, 0);   /* flip horizontally */
-    CreateXImage();
-    XPutImage(theDisp, tmpPix, theGC, theImage, 0,0, eWIDE,0, 
-	      (u_int) eWIDE, (u_int) eHIGH);
-
-    /* quadrant 4 */
-    FlipPic(epic, eWIDE, eHIGH, 1);   /* flip vertically */
-    CreateXImage();
-    XPutImage(theDisp, tmpPix, theGC, theImage, 0,0, eWIDE,eHIGH, 
-	      (u_int) eWIDE, (u_int) eHIGH);
-
-    /* quadrant 3 */
-    FlipPic(epic, eWIDE, eHIGH, 0);   /* flip horizontally */
-    CreateXImage();
-    XPutImage(theDisp, tmpPix, theGC, theImage, 0,0, 0,eHIGH, 
-	      (u_int) eWIDE, (u_int) eHIGH);
-
-    FlipPic(epic, eWIDE, eHIGH, 1);   /* flip vertically  (back to orig) */
-    CreateXImage();                   /* put back to original state */
+    mirrorPix(tmpPix, eWIDE, eHIGH);
   }
 
 
@@ -165,79 +146,48 @@ void MakeRootPic()
 
 
   else if (rmode == RM_ECENTER || rmode == RM_ECMIRR) {
-    int fliph, flipv;
-
-    fliph = 0;  flipv = 0;
-
-    if (dispWIDE == eWIDE) {
-      /* horizontal center line */
-      int y, ay;
-      
-      y = eHIGH - ((dispHIGH/2)%eHIGH); /* Starting point in picture to copy */
-      ay = 0;    /* Vertical anchor point */
-      while (ay < dispHIGH) {
-	XPutImage(theDisp, tmpPix, theGC, theImage, 0,y,
-		  0,ay, (u_int) eWIDE, (u_int) eHIGH);
-	ay += eHIGH - y;
-	y = 0;
-	if (rmode == RM_ECMIRR) {
-	  FlipPic(epic, eWIDE, eHIGH, 1);   flipv = !flipv;
-	  CreateXImage();
-	}
-      }
-    }
-    else if (dispHIGH == eHIGH) {
-      /* vertical centerline */
-      int x, ax;
-      
-      x = eWIDE - ((dispWIDE/2)%eWIDE); /* Starting point in picture to copy */
-      ax = 0;    /* Horizontal anchor point */
-      while (ax < dispWIDE) {
-	XPutImage(theDisp, tmpPix, theGC, theImage, x,0,
-		  ax,0, (u_int) eWIDE, (u_int) eHIGH);
-	ax += eWIDE - x;
-	x = 0;
-	if (rmode == RM_ECMIRR) {
-	  FlipPic(epic, eWIDE, eHIGH, 0);   fliph = !fliph;
-	  CreateXImage();
-	}
-      }
-    }
-    else {
-      /* vertical and horizontal centerlines */
-      int x,y, ax,ay;
-      
-      y = eHIGH - ((dispHIGH/2)%eHIGH); /* Starting point in picture to copy */
-      ay = 0;    /* Vertical anchor point */
-      
-      while (ay < dispHIGH) {
-	x = eWIDE - ((dispWIDE/2)%eWIDE);/* Starting point in picture to cpy */
-	ax = 0;    /* Horizontal anchor point */
-	while (ax < dispWIDE) {
-	  XPutImage(theDisp, tmpPix, theGC, theImage, x,y,
-		    ax,ay, (u_int) eWIDE, (u_int) eHIGH);
-	  if (rmode == RM_ECMIRR) {
-	    FlipPic(epic, eWIDE, eHIGH, 0);  fliph = !fliph;
-	    CreateXImage();
-	  }
-	  ax += eWIDE - x;
-	  x = 0;
-	}
-	if (rmode == RM_ECMIRR) {
-	  FlipPic(epic, eWIDE, eHIGH, 1);   flipv = !flipv;
-	  if (fliph) {   /* leftmost image is always non-hflipped */
-	    FlipPic(epic, eWIDE, eHIGH, 0);   fliph = !fliph;
-	  }
-	  CreateXImage();
-	}
-	ay += eHIGH - y;
-	y = 0;
-      }
+    /* the picture (or, for RM_ECMIRR, the picture and its three flipped
+       versions) goes into a tile, once, and the server fills tmpPix with
+       it.  The tile is lined up so that the edge of a picture falls on the
+       center line(s) of the screen, and for RM_ECMIRR, the top-left one is
+       the right way around */
+
+    Pixmap tile;
+    int    x, y, tw, th;
+
+    tw = eWIDE;  th = eHIGH;
+    if (rmode == RM_ECMIRR) { tw *= 2;  th *= 2; }
+
+    xerrcode = 0;
+    tile = XCreatePixmap(theDisp, mainW, (u_int) tw, (u_int) th, dispDEEP);
+    XSync(theDisp, False);
+    if (xerrcode || !tile) {
+      XFreePixmap(theDisp, tmpPix);
+      ErrPopUp("Insufficient memory in X server to store root pixmap.",
+	       "\nDarn!");
+      return;
     }
 
-    /* put epic back to normal */
-    if (fliph) FlipPic(epic, eWIDE, eHIGH, 0);
-    if (flipv) FlipPic(epic, eWIDE, eHIGH, 1);
+    XPutImage(theDisp, tile, theGC, theImage, 0,0, 0,0, 
+	      (u_int) eWIDE, (u_int) eHIGH);
+    if (rmode == RM_ECMIRR) mirrorPix(tile, eWIDE, eHIGH);
+
+    /* point in the picture that goes at the top-left of the screen.  A
+       picture as wide as the screen is split on the horizontal center
+       line only, and one just as high on the vertical one.  (So one the
+       size of the screen is split across the middle) */
+    x = (dispWIDE == eWIDE) ? 0 : eWIDE - ((dispWIDE/2)%eWIDE);
+    y = (dispHIGH == eHIGH && dispWIDE != eWIDE) ?
+      0 : eHIGH - ((dispHIGH/2)%eHIGH);
+
+    XSetFillStyle(theDisp, theGC, FillTiled);
+    XSetTile(theDisp, theGC, tile);
+    XSetTSOrigin(theDisp, theGC, -x, -y);
+    XFillRectangle(theDisp, tmpPix, theGC, 0,0, rpixw, rpixh);
+    XSetFillStyle(theDisp, theGC, FillSolid);
+    XSetTSOrigin(theDisp, theGC, 0, 0);
+
+    XFreePixmap(theDisp, tile);
   }
 
 
@@ -249,6 +199,29 @@ void MakeRootPic()
 
 
 
+/************************************************************************/
+static void mirrorPix(pix, w, h)
+     Pixmap pix;
+     int    w, h;
+{
+  /* 'pix' is 2w x 2h, with a picture in the top-left quadrant.  Fills in
+     the other three with its horizontal, vertical, and h+v flips, one row
+     or column at a time, using XCopyArea().  That's w+h small requests,
+     rather than sending the (flipped) picture to the server three more
+     times.  theGC has GraphicsExposures off, so there are no NoExpose
+     events to deal with */
+
+  int i;
+
+  for (i=0; i<w; i++)      /* top-right = top-left, flipped horizontally */
+    XCopyArea(theDisp, pix, pix, theGC, i, 0, 1, (u_int) h, 2*w-1-i, 0);
+
+  for (i=0; i<h; i++)      /* bottom half = top half, flipped vertically */
+    XCopyArea(theDisp, pix, pix, theGC, 0, i, (u_int) (2*w), 1, 0, 2*h-1-i);
+}
+
+
+
 /************************************************************************/
 void ClearRoot()
 {
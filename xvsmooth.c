@@ -10,12 +10,31 @@
  *                                rdisp, gdisp, bdisp, maplen)
  *            byte *Do332ColorDither(pic24, pic8, w, h, rmap,gmap,bmap, 
  *                                rdisp, gdisp, bdisp, maplen)
+ *            byte *Do332OrderDither(pic24, pic8, w, h, rmap,gmap,bmap)
+ *            void  Do332OrderRect(pic24, pw, x0, y0, w, h, out, obpl)
+ *            byte *OrderDither(inpic, intype, w, h, rmap,gmap,bmap,
+ *                                bval, wval)
  */
 
 #include "copyright.h"
 
 #include "xv.h"
 
+#define ICM_SLOTS 2                  /* # of inverse colormaps kept */
+#define ICM_SIZE  (32 * 32 * 32)     /* entries in each */
+
+typedef struct { short *cache;
+		 int    maplen;
+		 byte   r[256], g[256], b[256];
+		 long   lastused;
+	       } ICMAP;
+
+static ICMAP icmaps[ICM_SLOTS];
+static long  icmClock = 0;
+
+static short *invCmap PARM((byte *, byte *, byte *, int));
+static void  init332Order PARM((void));
+
 static int smoothX  PARM((byte *, byte *, int, int, int, int, int,
 			  byte *, byte *, byte *));
 static int smoothY  PARM((byte *, byte *, int, int, int, int, int, 
@@ -547,15 +566,17 @@ byte *DoColorDither(pic24, pic8, w, h, rmap, gmap, bmap,
      if pic24 is NULL, uses the passed-in pic8 (an 8-bit image) as
      the source, and the rmap,gmap,bmap arrays as the desired colors */
 
-  byte *np, *ep, *newpic; 
-  short *cache;
-  int r2, g2, b2;
-  int *thisline, *nextline, *thisptr, *nextptr, *tmpptr;
-  int  i, j, rerr, gerr, berr, pwide3;
-  int  imax, jmax;
-  int key;
-  long cnt1, cnt2;
-  int fserrmap[512];   /* -255 .. 0 .. +255 */
+  /* as in quick_quant(), only the error is kept for the next line, and
+     the error going right and down is summed in registers */
+
+  byte  *np, *sp, *newpic, *linebuf; 
+  short *cache, *errline, *ep;
+  int    r2, g2, b2;
+  int    i, j, k, rerr, gerr, berr, pwide3;
+  int    rright, gright, bright, rdl, gdl, bdl, rdn, gdn, bdn;
+  int    key;
+  int    fserrmap[512];   /* -255 .. 0 .. +255 */
+  int    e7[512], e5[512], e3[512], e1[512];
 
   /* compute somewhat non-linear floyd-steinberg error mapping table */
   for (i=j=0; i<=0x40; i++,j++) 
@@ -565,64 +586,57 @@ byte *DoColorDither(pic24, pic8, w, h, rmap, gmap, bmap,
   for (     ; i<=0xff; i++) 
     { fserrmap[256+i] = j;  fserrmap[256-i] = -j; }
 
+  /* and the fractions of it that go to the neighbors */
+  for (i=1; i<512; i++) {
+    e7[i] = (fserrmap[i]*7) / 16;   e5[i] = (fserrmap[i]*5) / 16;
+    e3[i] = (fserrmap[i]*3) / 16;   e1[i] =  fserrmap[i]    / 16;
+  }
+
 
-  cnt1 = cnt2 = 0;
-  pwide3 = w*3;  imax = h-1;  jmax = w-1;
-  ep = (pic24) ? pic24 : pic8;
+  pwide3 = w*3;
 
   /* attempt to malloc things */
-  newpic = (byte *)  malloc((size_t) (w * h));
-  cache  = (short *) calloc((size_t) (2<<14), sizeof(short));
-  thisline = (int *) malloc(pwide3 * sizeof(int));
-  nextline = (int *) malloc(pwide3 * sizeof(int));
-  if (!cache || !newpic || !thisline || !nextline) { 
-    if (newpic)   free(newpic);
-    if (cache)    free(cache);
-    if (thisline) free(thisline);
-    if (nextline) free(nextline);
+  newpic  = (byte *)  malloc((size_t) (w * h));
+  cache   = invCmap(rdisp, gdisp, bdisp, maplen);
+  errline = (short *) malloc((pwide3 + 3) * sizeof(short));
+  linebuf = (byte *)  malloc((size_t) pwide3);
+  if (!cache || !newpic || !errline || !linebuf) { 
+    if (newpic)  free(newpic);
+    if (errline) free(errline);
+    if (linebuf) free(linebuf);
 
     return (byte *) NULL;
   }
 
+  /* one pixel of padding on the left, for the lower-left error of pixel 0 */
+  for (j=0; j<pwide3+3; j++) errline[j] = 0;
   np = newpic;
 
-  /* get first line of picture */
-
-  if (pic24) {
-    for (j=pwide3, tmpptr=nextline; j; j--, ep++)
-      *tmpptr++ = (int) *ep;
-  }
-  else {
-    for (j=w, tmpptr=nextline; j; j--, ep++) {
-      *tmpptr++ = (int) rmap[*ep];
-      *tmpptr++ = (int) gmap[*ep];
-      *tmpptr++ = (int) bmap[*ep];
-    }
-  }
-
 
   for (i=0; i<h; i++) {
     ProgressMeter(0, h-1, i, "Dither");
     if ((i&15) == 0) WaitCursor();
 
-    tmpptr = thisline;  thisline = nextline;  nextline = tmpptr;   /* swap */
-
-    if (i!=imax) {  /* get next line */
-      if (!pic24)
-	for (j=w, tmpptr=nextline; j; j--, ep++) {
-	  *tmpptr++ = (int) rmap[*ep];
-	  *tmpptr++ = (int) gmap[*ep];
-	  *tmpptr++ = (int) bmap[*ep];
-	}
-      else
-	for (j=pwide3, tmpptr=nextline; j; j--, ep++) *tmpptr++ = (int) *ep;
+    if (pic24) sp = pic24 + i * pwide3;
+    else {
+      byte *ip = pic8 + i*w;
+      for (j=w, sp=linebuf; j; j--, ip++) {
+	*sp++ = rmap[*ip];  *sp++ = gmap[*ip];  *sp++ = bmap[*ip];
+      }
+      sp = linebuf;
     }
 
+    rright = gright = bright = 0;    /* error coming from the left */
+    rdl = gdl = bdl = 0;             /* error for below the previous pixel */
+    rdn = gdn = bdn = 0;             /* error for below this pixel */
+
     /* dither a line */
-    for (j=0, thisptr=thisline, nextptr=nextline; j<w; j++,np++) {
-      int k, d, mind, closest;
+    for (j=w, ep=errline+3; j; j--, np++, sp+=3, ep+=3) {
+      int d, mind, closest;
 
-      r2 = *thisptr++;  g2 = *thisptr++;  b2 = *thisptr++;
+      r2 = sp[0] + ep[0] + rright;
+      g2 = sp[1] + ep[1] + gright;
+      b2 = sp[2] + ep[2] + bright;
 
       /* map r2,g2,b2 components (could be outside 0..255 range) 
 	 into 0..255 range */
@@ -663,19 +677,20 @@ byte *DoColorDither(pic24, pic8, w, h, rmap, gmap, bmap,
 	}
       }
 
-      key = ((r2&0xf8)<<6) | ((g2&0xf8)<<1) | (b2>>4);
-      if (key >= (2<<14)) FatalError("'key' overflow in DoColorDither()");
+      key = ((r2&0xf8)<<7) | ((g2&0xf8)<<2) | (b2>>3);
 
-      if (cache[key]) { *np = (byte) (cache[key] - 1);  cnt1++;	}
+      if (cache[key]) *np = (byte) (cache[key] - 1);
       else {
-	/* not in cache, have to search the colortable */
-	cnt2++;
+	/* not in cache, have to search the colortable, for the color
+	   closest to the middle of the cache cell */
+	int rc, gc, bc;
 
+	rc = (r2&0xf8) + 4;  gc = (g2&0xf8) + 4;  bc = (b2&0xf8) + 4;
         mind = 10000;
-	for (k=closest=0; k<maplen && mind>7; k++) {
-	  d = abs(r2 - rdisp[k])
-	    + abs(g2 - gdisp[k]) 
-	    + abs(b2 - bdisp[k]);
+	for (k=closest=0; k<maplen && mind>0; k++) {
+	  d = abs(rc - rdisp[k])
+	    + abs(gc - gdisp[k]) 
+	    + abs(bc - bdisp[k]);
 	  if (d<mind) { mind = d;  closest = k; }
 	}
 	cache[key] = closest + 1;
@@ -683,53 +698,75 @@ byte *DoColorDither(pic24, pic8, w, h, rmap, gmap, bmap,
       }
 
 
-      /* propogate the error */
-      rerr = r2 - rdisp[*np];
-      gerr = g2 - gdisp[*np];
-      berr = b2 - bdisp[*np];
+      /* propogate the error.  (both r2 and rdisp are 0..255, so the
+	 difference is already in range for the tables) */
+      rerr = 256 + r2 - rdisp[*np];
+      gerr = 256 + g2 - gdisp[*np];
+      berr = 256 + b2 - bdisp[*np];
 
+      rright = e7[rerr];  gright = e7[gerr];  bright = e7[berr];
 
-      RANGE(rerr, -255, 255);
-      RANGE(gerr, -255, 255);
-      RANGE(berr, -255, 255);
-      rerr = fserrmap[256+rerr];
-      gerr = fserrmap[256+gerr];
-      berr = fserrmap[256+berr];
+      ep[-3] = rdl + e3[rerr];  ep[-2] = gdl + e3[gerr];  ep[-1] = bdl + e3[berr];
+      rdl = rdn + e5[rerr];     gdl = gdn + e5[gerr];     bdl = bdn + e5[berr];
+      rdn = e1[rerr];           gdn = e1[gerr];           bdn = e1[berr];
+    }
 
+    ep[-3] = rdl;  ep[-2] = gdl;  ep[-1] = bdl;
+  }
 
 
-      if (j!=jmax) {  /* adjust RIGHT pixel */
-	thisptr[0] += (rerr*7)/16;
-	thisptr[1] += (gerr*7)/16;
-	thisptr[2] += (berr*7)/16;
-      }
-      
-      if (i!=imax) {	/* do BOTTOM pixel */
-	nextptr[0] += (rerr*5)/16;
-	nextptr[1] += (gerr*5)/16;
-	nextptr[2] += (berr*5)/16;
-
-	if (j>0) {  /* do BOTTOM LEFT pixel */
-	  nextptr[-3] += (rerr*3)/16;
-	  nextptr[-2] += (gerr*3)/16;
-	  nextptr[-1] += (berr*3)/16;
-	}
+  free(errline);  free(linebuf);
 
-	if (j!=jmax) {  /* do BOTTOM RIGHT pixel */
-	  nextptr[3] += rerr/16;
-	  nextptr[4] += gerr/16;
-	  nextptr[5] += berr/16;
-	}
-	nextptr += 3;
-      }
+  return newpic;
+}
+
+
+/********************************************/
+static short *invCmap(rdisp, gdisp, bdisp, maplen)
+     byte *rdisp, *gdisp, *bdisp;
+     int   maplen;
+{
+  /* returns the inverse colormap cache (32x32x32 cells, indexed by the top
+     5 bits of r,g,b) for DoColorDither() to use with the given colors.
+     Each entry is 0 (not looked up yet) or 1 + the closest color.  The
+     caches are kept from one call to the next, and thrown away when the
+     colors change, so successive epics, images, and browser icons don't
+     have to search the colormap all over again.  There are ICM_SLOTS of
+     them, as the browser doesn't necessarily use the same colors as mainW.
+     Returns NULL if it runs out of memory */
+
+  ICMAP *ic;
+  int    i;
+
+  if (maplen > 256) maplen = 256;
+
+  for (i=0; i<ICM_SLOTS; i++) {
+    ic = &icmaps[i];
+    if (ic->cache && ic->maplen == maplen &&
+	!xvbcmp((char *) ic->r, (char *) rdisp, (size_t) maplen) &&
+	!xvbcmp((char *) ic->g, (char *) gdisp, (size_t) maplen) &&
+	!xvbcmp((char *) ic->b, (char *) bdisp, (size_t) maplen)) {
+      ic->lastused = ++icmClock;
+      return ic->cache;
     }
   }
 
+  /* not there.  reuse the least recently used one */
+  for (i=1, ic=icmaps; i<ICM_SLOTS; i++)
+    if (icmaps[i].lastused < ic->lastused) ic = &icmaps[i];
 
-  free(thisline);  free(nextline);
-  free(cache);
+  if (!ic->cache) {
+    ic->cache = (short *) malloc((size_t) ICM_SIZE * sizeof(short));
+    if (!ic->cache) return (short *) NULL;
+  }
 
-  return newpic;
+  xvbzero((char *) ic->cache, (size_t) ICM_SIZE * sizeof(short));
+  xvbcopy((char *) rdisp, (char *) ic->r, (size_t) maplen);
+  xvbcopy((char *) gdisp, (char *) ic->g, (size_t) maplen);
+  xvbcopy((char *) bdisp, (char *) ic->b, (size_t) maplen);
+  ic->maplen   = maplen;
+  ic->lastused = ++icmClock;
+  return ic->cache;
 }
 
 
@@ -754,13 +791,24 @@ byte *Do332ColorDither(pic24, pic8, w, h, rmap, gmap, bmap,
      if pic24 is NULL, uses the passed-in pic8 (an 8-bit image) as
      the source, and the rmap,gmap,bmap arrays as the desired colors */
 
-  byte *np, *ep, *newpic; 
-  int r2, g2, b2;
-  int *thisline, *nextline, *thisptr, *nextptr, *tmpptr;
-  int  i, j, rerr, gerr, berr, pwide3;
-  int  imax, jmax;
-  long cnt1, cnt2;
-  int  fserrmap[512];   /* -255 .. 0 .. +255 */
+  /* Each pixel only passes error to the next pixel along the line, and to
+     the one below it, so all that's kept for the next line is one line of
+     'short' errors, and the error going sideways is carried in a register.
+     The rounding/clamping and the error mapping come out of tables.
+
+     The error mapping tops out at 95, so pixel+error stays within
+     -142..397, and pixel+error-displayed within -397..397 */
+
+#define D332_PIX   512       /* offset of 0 in the r/g/bbits tables */
+#define D332_ERR   768       /* offset of 0 in errtab */
+
+  byte  *np, *sp, *newpic, *linebuf, *rbits, *gbits, *bbits;
+  byte   bitstab[3][1280];
+  short *errline, *ep;
+  int    r2, g2, b2, rerr, gerr, berr, rright, gright, bright;
+  int    i, j, k, pwide3, step;
+  int   *fserr, errtab[1536];
+  int    fserrmap[512];   /* -255 .. 0 .. +255 */
 
   /* compute somewhat non-linear floyd-steinberg error mapping table */
   for (i=j=0; i<=0x40; i++,j++) 
@@ -770,122 +818,251 @@ byte *Do332ColorDither(pic24, pic8, w, h, rmap, gmap, bmap,
   for (     ; i<=0xff; i++) 
     { fserrmap[256+i] = j;  fserrmap[256-i] = -j; }
 
+  for (i=0; i<1536; i++) {
+    k = i - D332_ERR;  RANGE(k, -255, 255);
+    errtab[i] = fserrmap[256+k];
+  }
+  fserr = errtab + D332_ERR;
+
+  for (i=0; i<1280; i++) {
+    k = i - D332_PIX + 0x10;  RANGE(k,0,255);    /* round top 3 bits */
+    bitstab[0][i] = k & 0xe0;
+    bitstab[1][i] = (k & 0xe0) >> 3;
+    k = i - D332_PIX + 0x20;  RANGE(k,0,255);    /* round top 2 bits */
+    bitstab[2][i] = (k & 0xc0) >> 6;
+  }
+  rbits = bitstab[0] + D332_PIX;
+  gbits = bitstab[1] + D332_PIX;
+  bbits = bitstab[2] + D332_PIX;
 
-  cnt1 = cnt2 = 0;
-  pwide3 = w*3;  imax = h-1;  jmax = w-1;
+
+  pwide3 = w*3;
 
   /* attempt to malloc things */
-  newpic   = (byte *) malloc((size_t) (w * h));
-  thisline = (int *)  malloc(pwide3 * sizeof(int));
-  nextline = (int *)  malloc(pwide3 * sizeof(int));
-  if (!newpic || !thisline || !nextline) { 
-    if (newpic)   free(newpic);
-    if (thisline) free(thisline);
-    if (nextline) free(nextline);
+  newpic  = (byte *)  malloc((size_t) (w * h));
+  errline = (short *) malloc(pwide3 * sizeof(short));
+  linebuf = (byte *)  malloc((size_t) pwide3);
+  if (!newpic || !errline || !linebuf) { 
+    if (newpic)  free(newpic);
+    if (errline) free(errline);
+    if (linebuf) free(linebuf);
 
     return (byte *) NULL;
   }
 
-  np = newpic;
-  ep = (pic24) ? pic24 : pic8;
+  for (j=0; j<pwide3; j++) errline[j] = 0;
 
 
-  /* get first line of picture */
+  for (i=0; i<h; i++) {
+    ProgressMeter(0, h-1, i, "Dither");
+    if ((i&127) == 0) WaitCursor();
 
-  if (pic24) {
-    for (j=pwide3, tmpptr=nextline; j; j--, ep++) *tmpptr++ = (int) *ep;
-  }
-  else {
-    for (j=w, tmpptr=nextline; j; j--, ep++) {
-      *tmpptr++ = (int) rmap[*ep];
-      *tmpptr++ = (int) gmap[*ep];
-      *tmpptr++ = (int) bmap[*ep];
+    if (pic24) sp = pic24 + i * pwide3;
+    else {
+      byte *ip = pic8 + i*w;
+      for (j=w, sp=linebuf; j; j--, ip++) {
+	*sp++ = rmap[*ip];  *sp++ = gmap[*ip];  *sp++ = bmap[*ip];
+      }
+      sp = linebuf;
     }
-  }
 
 
-  for (i=0; i<h; i++) {
+    /* dither a line, doing odd-lines right-to-left (serpentine) */
     np = newpic + i*w;
-    ProgressMeter(0, h-1, i, "Dither");
-    if ((i&127) == 0) WaitCursor();
+    ep = errline;
+    step = 3;
+    if (i&1) { np += w-1;  sp += pwide3-3;  ep += pwide3-3;  step = -3; }
 
-    tmpptr = thisline;  thisline = nextline;  nextline = tmpptr;   /* swap */
+    rright = gright = bright = 0;
 
-    if (i!=imax) {  /* get next line */
-      if (!pic24)
-	for (j=w, tmpptr=nextline; j; j--, ep++) {
-	  *tmpptr++ = (int) rmap[*ep];
-	  *tmpptr++ = (int) gmap[*ep];
-	  *tmpptr++ = (int) bmap[*ep];
-	}
-      else
-	for (j=pwide3, tmpptr=nextline; j; j--, ep++) *tmpptr++ = (int) *ep;
+    for (j=w; j; j--) {
+      r2 = sp[0] + ep[0] + rright;
+      g2 = sp[1] + ep[1] + gright;
+      b2 = sp[2] + ep[2] + bright;
+
+      *np = rbits[r2] | gbits[g2] | bbits[b2];
+
+      /* propogate the error */
+      rerr = fserr[r2 - rdisp[*np]];
+      gerr = fserr[g2 - gdisp[*np]];
+      berr = fserr[b2 - bdisp[*np]];
+
+      if (j>1) {  /* half goes to the next pixel, the rest below */
+	rright = rerr/2;  gright = gerr/2;  bright = berr/2;
+	rerr -= rright;   gerr -= gright;   berr -= bright;
+      }
+      ep[0] = rerr;  ep[1] = gerr;  ep[2] = berr;
+
+      sp += step;  ep += step;
+      if (i&1) np--;  else np++;
     }
+  }
 
 
-    /* dither a line, doing odd-lines right-to-left (serpentine) */
-    thisptr = (i&1) ? thisline + w*3 - 3 : thisline;
-    nextptr = (i&1) ? nextline + w*3 - 3 : nextline;
-    if (i&1) np += w-1;
+  free(errline);  free(linebuf);
 
+  return newpic;
 
-    for (j=0; j<w; j++) {
-      int k, d, mind, closest, rb,gb,bb;
+#undef D332_PIX
+#undef D332_ERR
+}
 
-      r2 = *thisptr++;  g2 = *thisptr++;  b2 = *thisptr++;
-      if (i&1) thisptr -= 6;  /* move left */
 
-      rb = (r2 + 0x10);    /* round top 3 bits */
-      RANGE(rb,0,255);
-      rb = rb & 0xe0;
 
-      gb = (g2 + 0x10);    /* round 3 bits */
-      RANGE(gb,0,255);
-      gb = gb & 0xe0;
 
-      bb = (b2 + 0x20);    /* round 2 bits */
-      RANGE(bb,0,255);
-      bb = bb & 0xc0;
-      
 
-      *np = rb | (gb>>3) | (bb>>6);
 
-      /* propogate the error */
-      rerr = r2 - rdisp[*np];
-      gerr = g2 - gdisp[*np];
-      berr = b2 - bdisp[*np];
+/********************************************/
+/* 8x8 Bayer matrix, thresholds 0..63, for the ordered dithers below.  Each
+   output pixel depends only on the input pixel and its position, so any
+   part of the image can be dithered on its own, and gets the same result */
 
+static byte bayer8[8][8] = {
+  {  0, 32,  8, 40,  2, 34, 10, 42 },
+  { 48, 16, 56, 24, 50, 18, 58, 26 },
+  { 12, 44,  4, 36, 14, 46,  6, 38 },
+  { 60, 28, 52, 20, 62, 30, 54, 22 },
+  {  3, 35, 11, 43,  1, 33,  9, 41 },
+  { 51, 19, 59, 27, 49, 17, 57, 25 },
+  { 15, 47,  7, 39, 13, 45,  5, 37 },
+  { 63, 31, 55, 23, 61, 29, 53, 21 } };
 
-      RANGE(rerr, -255, 255);
-      RANGE(gerr, -255, 255);
-      RANGE(berr, -255, 255);
-      rerr = fserrmap[256+rerr];
-      gerr = fserrmap[256+gerr];
-      berr = fserrmap[256+berr];
+static int  rq332[256], gq332[256], bq332[256];   /* see init332Order() */
 
 
-      if (j!=jmax) {  /* adjust LEFT/RIGHT pixel */
-	thisptr[0] += (rerr/2);  rerr -= (rerr/2);
-	thisptr[1] += (gerr/2);  gerr -= (gerr/2);
-	thisptr[2] += (berr/2);  berr -= (berr/2);
-      }
+/********************************************/
+byte *Do332OrderDither(pic24, pic8, w, h, rmap, gmap, bmap)
+     byte *pic24, *pic8, *rmap, *gmap, *bmap;
+     int   w, h;
+{
+  /* ordered dither onto the 3-3-2 colors (evenly spaced levels, with 0
+     and 255 included), generating a w*h image of RRRGGGBB values, which
+     it returns.  If pic24 is NULL, uses pic8 (an 8-bit image) as the
+     source, with the rmap,gmap,bmap colormap.  Returns NULL on error */
 
-      if (i!=imax) { /* adjust BOTTOM pixel */
-	nextptr[0] += rerr;    /* possibly all err if we're at l/r edge */
-	nextptr[1] += gerr;
-	nextptr[2] += berr;
-      }
+  /* each channel is scaled so that the level is in the top bits, and how
+     far it is to the next level is in the bottom 6.  Adding the threshold
+     (0..63) carries into the level a proportional amount of the time */
 
-      if (i&1) { nextptr -= 3;  np--; }
-          else { nextptr += 3;  np++; }
-    }
+  byte *newpic, *np, *sp, *dp;
+  int   i, j, k, d;
+
+  newpic = (byte *) malloc((size_t) (w * h));
+  if (!newpic) return (byte *) NULL;
+
+  if (pic24) {
+    Do332OrderRect(pic24, w, 0, 0, w, h, newpic, w);
+    return newpic;
   }
 
+  init332Order();
 
-  free(thisline);  free(nextline);
+  np = newpic;  sp = pic8;
+  for (i=0; i<h; i++) {
+    if ((i&127) == 0) WaitCursor();
+    dp = bayer8[i&7];
+
+    for (j=0; j<w; j++, sp++) {
+      d = dp[j&7];  k = *sp;
+      *np++ = (((rq332[rmap[k]] + d) >> 6) << 5) | 
+	      (((gq332[gmap[k]] + d) >> 6) << 2) | ((bq332[bmap[k]] + d) >> 6);
+    }
+  }
 
   return newpic;
 }
 
 
+/********************************************/
+void Do332OrderRect(pic24, pw, x0, y0, w, h, out, obpl)
+     byte *pic24, *out;
+     int   pw, x0, y0, w, h, obpl;
+{
+  /* Do332OrderDither() of just the w*h rectangle at x0,y0 in 'pic24' (which
+     is pw pixels wide).  The RRRGGGBB values go into 'out', which has 'obpl'
+     bytes per line.  The dither pattern stays lined up with the whole image,
+     so a piece dithered on its own matches the rest */
+
+  byte *sp, *np, *dp;
+  int   i, j, d;
+
+  init332Order();
+
+  for (i=0; i<h; i++) {
+    if (i && (i&127) == 0) WaitCursor();
+    dp = bayer8[(y0+i)&7];
+    sp = pic24 + ((y0+i) * pw + x0) * 3;
+    np = out + i * obpl;
+
+    for (j=0; j<w; j++, sp+=3) {
+      d = dp[(x0+j)&7];
+      *np++ = (((rq332[sp[0]] + d) >> 6) << 5) | 
+	      (((gq332[sp[1]] + d) >> 6) << 2) | ((bq332[sp[2]] + d) >> 6);
+    }
+  }
+}
+
+
+/********************************************/
+static void init332Order()
+{
+  /* builds the tables for the 3-3-2 ordered dithers (see the comment in
+     Do332OrderDither()) the first time it's called */
+
+  int i;
+
+  if (rq332[255]) return;     /* done already */
+
+  for (i=0; i<256; i++) {
+    rq332[i] = (i * 7 * 64 + 127) / 255;
+    gq332[i] = (i * 7 * 64 + 127) / 255;
+    bq332[i] = (i * 3 * 64 + 127) / 255;
+  }
+}
+
+
+/********************************************/
+byte *OrderDither(inpic, intype, w, h, rmap, gmap, bmap, bval, wval)
+     byte *inpic, *rmap, *gmap, *bmap;
+     int   w, h, intype, bval, wval;
+{
+  /* like FSDither(), but an ordered dither.  Takes an input pic of size
+   * w*h, and type 'intype' (PIC8 or PIC24) (if PIC8, colormap specified by
+   * rmap,gmap,bmap) and generates (mallocs) a w*h 1-byte-per-pixel 'outpic',
+   * using 'bval' and 'wval' as the 'black' and 'white' pixel values.
+   * Returns NULL on error
+   */
 
+  byte *outpic, *pp, *op, grey[256];
+  int   i, j, thresh[8][8];
+
+  outpic = (byte *) malloc((size_t) (w * h));
+  if (!outpic) return outpic;
+
+  if (intype == PIC8) {       /* monoify colormap */
+    for (i=0; i<256; i++) grey[i] = fsgamcr[MONO(rmap[i], gmap[i], bmap[i])];
+  }
+
+  /* white if grey*64 > thresh, so 0 is always black, 255 always white */
+  for (i=0; i<8; i++)
+    for (j=0; j<8; j++) thresh[i][j] = bayer8[i][j] * 255 + 127;
+
+  pp = inpic;  op = outpic;
+  for (i=0; i<h; i++) {
+    int *tp = thresh[i&7];
+
+    if ((i&127) == 0) WaitCursor();
+
+    if (intype == PIC24) {
+      for (j=0; j<w; j++, pp+=3)
+	*op++ = ((fsgamcr[MONO(pp[0],pp[1],pp[2])] << 6) > tp[j&7]) 
+	        ? (byte) wval : (byte) bval;
+    }
+    else {
+      for (j=0; j<w; j++, pp++)
+	*op++ = ((grey[*pp] << 6) > tp[j&7]) ? (byte) wval : (byte) bval;
+    }
+  }
+
+  return outpic;
+}
@@ -0,0 +1,353 @@
+/*
+ * xvstretch.c - turns deep (more than 8 bits per sample) greyscale or RGB
+ *               data into 'pic' values, and lets the user change how it's done
+ *
+ *  Contains:
+ *     DEEPPIC *DeepAlloc(w,h,nchan) - allocates a DEEPPIC, for a LoadXXX()
+ *     void     DeepFree(dp)        - frees one
+ *     void     DeepStretch(dp,mode,pic8) - maps dp into pic8, using 'mode'
+ *     int      StretchParse(str)   - stretch name -> STR_* (or -1)
+ *     char    *StretchName(mode)   - STR_* -> stretch name
+ *     void     StretchInit(dp,r,g,b) - keeps 'dp', which 'pic' was made from
+ *     void     StretchKill()       - forgets it
+ *     int      StretchActive()     - is there one?
+ *     void     StretchStep(dir)    - switches to the next/prev stretch
+ *     int      StretchSet(mode,inst) - switches to stretch 'mode'
+ *     void     StretchRotate(dir)  - rotates the data, along with 'pic'
+ *     void     StretchFlip(dir)    - flips the data, along with 'pic'
+ *
+ *  The loaders (LoadFITS(), LoadPDS(), and the 16-bit cases of LoadPBM(),
+ *  LoadPNG(), and LoadTIFF()) reduce the samples to at most 64K 'levels',
+ *  and count how many samples there are at each level as they go.  All the
+ *  stretches are computed from that histogram as a table with one entry per
+ *  level, so changing the stretch only costs one pass through the image,
+ *  and doesn't involve the file at all.  RGB data has one histogram for all
+ *  three channels, and one table, so the stretch doesn't shift the colors.
+ *
+ *  'Normalize' and 'HistEq' in the color editor use the STR_NORM and
+ *  STR_HISTEQ stretches when there's deep data, so that they don't band.
+ */
+
+#include "copyright.h"
+#include "xv.h"
+
+#define CLIPFRAC 0.005      /* fraction of samples STR_CLIP ignores at ends */
+
+static char *strNames[STR_MAX+1] = { "linear", "clip", "log", "sqrt",
+				     "asinh", "norm", "histeq" };
+
+static DEEPPIC *deep = (DEEPPIC *) NULL;
+static byte     deepr[256], deepg[256], deepb[256];  /* colormap for it */
+
+static int   restretch  PARM((int));
+static double arcsinh   PARM((double));
+
+
+
+/***********************************/
+DEEPPIC *DeepAlloc(w, h, nchan)
+     int w, h, nchan;
+{
+  /* returns a DEEPPIC with room for w*h pixels of 'nchan' samples each,
+     and an empty histogram, or NULL if there isn't enough memory */
+
+  DEEPPIC *dp;
+  int      i;
+
+  dp = (DEEPPIC *) malloc(sizeof(DEEPPIC));
+  if (!dp) return (DEEPPIC *) NULL;
+
+  dp->w = w;  dp->h = h;  dp->nchan = nchan;
+  dp->nlevels = 1;
+  dp->min = dp->max = 0.0;
+  dp->data = (unsigned short *) malloc((size_t) w * h * nchan *
+				       sizeof(unsigned short));
+  dp->hist = (long *) malloc(DEEPLEVELS * sizeof(long));
+
+  if (!dp->data || !dp->hist) {
+    DeepFree(dp);
+    return (DEEPPIC *) NULL;
+  }
+
+  for (i=0; i<DEEPLEVELS; i++) dp->hist[i] = 0;
+  return dp;
+}
+
+
+/***********************************/
+void DeepFree(dp)
+     DEEPPIC *dp;
+{
+  if (!dp) return;
+  if (dp->data) free(dp->data);
+  if (dp->hist) free(dp->hist);
+  free(dp);
+}
+
+
+/***********************************/
+void DeepStretch(dp, mode, pic8)
+     DEEPPIC *dp;
+     int      mode;
+     byte    *pic8;
+{
+  /* fills in 'pic8' (w*h*nchan bytes) from the samples in dp, using
+     stretch 'mode'.  STR_LINEAR runs from black at level 0 to white at the
+     top level.  The others run from the lowest level that's used (or, for
+     STR_CLIP, the level below which CLIPFRAC of the samples lie) to the
+     highest */
+
+  byte           *lut;
+  unsigned short *sp;
+  long            total, cum, clip, eqtot, i;
+  int             lo, hi, n;
+  double          t, d;
+
+  n = dp->nlevels;
+  lut = (byte *) malloc((size_t) n);
+  if (!lut) FatalError("out of memory in DeepStretch()");
+
+  for (i=0, total=0; i<n; i++) total += dp->hist[i];
+  clip = (mode == STR_CLIP) ? (long) (total * CLIPFRAC) : 0;
+
+  lo = 0;  hi = n-1;
+  if (mode != STR_LINEAR) {
+    for (cum=0; lo<n-1; lo++) if ((cum += dp->hist[lo]) > clip) break;
+    for (cum=0; hi>0;   hi--) if ((cum += dp->hist[hi]) > clip) break;
+    if (hi < lo) hi = lo;
+  }
+
+  for (i=lo+1, eqtot=0; i<=hi; i++) eqtot += dp->hist[i];
+
+  d = (double) (hi - lo);
+  for (i=0, cum=0; i<n; i++) {
+    if      (i <= lo) lut[i] = 0;
+    else if (i >= hi) lut[i] = 255;
+    else if (mode == STR_LINEAR || mode == STR_CLIP || mode == STR_NORM)
+      lut[i] = (byte) (255.0 * (double) (i - lo) / d);
+    else if (mode == STR_HISTEQ) {
+      cum += dp->hist[i];
+      lut[i] = (byte) (255.0 * (double) cum / (double) eqtot);
+    }
+    else {
+      t = (double) (i - lo) / d;
+      if      (mode == STR_LOG)  t = log(1.0 + 1000.0 * t) / log(1001.0);
+      else if (mode == STR_SQRT) t = sqrt(t);
+      else                       t = arcsinh(10.0 * t) / arcsinh(10.0);
+      lut[i] = (byte) (255.0 * t);
+    }
+  }
+
+  for (i=(long) dp->w * dp->h * dp->nchan, sp=dp->data; i>0; i--)
+    *pic8++ = lut[*sp++];
+  free(lut);
+}
+
+
+/***********************************/
+int StretchParse(str)
+     char *str;
+{
+  int i;
+  for (i=0; i<=STR_MAX; i++)
+    if (!strcmp(str, strNames[i])) return i;
+  return -1;
+}
+
+
+/***********************************/
+char *StretchName(mode)
+     int mode;
+{
+  return (mode >= 0 && mode <= STR_MAX) ? strNames[mode] : "unknown";
+}
+
+
+/***********************************/
+void StretchInit(dp, r, g, b)
+     DEEPPIC *dp;
+     byte    *r, *g, *b;
+{
+  /* called by openPic() once 'pic' (which was made from 'dp') has been
+     installed.  'r,g,b' is the colormap that came with it */
+
+  int i;
+
+  StretchKill();
+  if (!dp) return;
+
+  deep = dp;
+  for (i=0; i<256; i++) { deepr[i] = r[i];  deepg[i] = g[i];  deepb[i] = b[i]; }
+}
+
+
+/***********************************/
+void StretchKill()
+{
+  /* called whenever 'pic' stops being something that can be regenerated
+     from the deep data (a new image, an algorithm has been run, etc.) */
+
+  DeepFree(deep);
+  deep = (DEEPPIC *) NULL;
+}
+
+
+/***********************************/
+int StretchActive()
+{
+  return (deep != NULL);
+}
+
+
+/***********************************/
+void StretchStep(dir)
+     int dir;
+{
+  if (!deep) return;
+  stretchMode = (stretchMode + STR_MAX+1 + ((dir>0) ? 1 : -1)) % (STR_MAX+1);
+  restretch(1);
+}
+
+
+/***********************************/
+int StretchSet(mode, install)
+     int mode, install;
+{
+  /* switches to stretch 'mode', and rebuilds 'pic' from the deep data.
+     If 'install' is set, the new pic is installed (and displayed) as well.
+     Returns '0' if there's no deep data, or pic couldn't be rebuilt */
+
+  if (!deep) return 0;
+  stretchMode = mode;
+  return restretch(install);
+}
+
+
+/***********************************/
+void StretchRotate(dir)
+     int dir;
+{
+  /* rotates the data 90 degrees clockwise (dir=0) or counter-clockwise,
+     the same way RotatePic() does to 'pic' */
+
+  unsigned short *rot, *rp, *sp;
+  int             i, j, k, w, h, nc;
+
+  if (!deep) return;
+
+  w = deep->w;  h = deep->h;  nc = deep->nchan;
+  rot = (unsigned short *) malloc((size_t) w * h * nc * sizeof(unsigned short));
+  if (!rot) { StretchKill();  return; }
+
+  rp = rot;
+  if (dir==0) {
+    for (i=0; i<w; i++)                                /* CW */
+      for (j=h-1, sp=deep->data + ((h-1)*w + i)*nc; j>=0; j--, sp-=w*nc)
+	for (k=0; k<nc; k++) *rp++ = sp[k];
+  }
+  else {
+    for (i=w-1; i>=0; i--)                             /* CCW */
+      for (j=0, sp=deep->data + i*nc; j<h; j++, sp+=w*nc)
+	for (k=0; k<nc; k++) *rp++ = sp[k];
+  }
+
+  free(deep->data);
+  deep->data = rot;
+  deep->w = h;  deep->h = w;
+}
+
+
+/***********************************/
+void StretchFlip(dir)
+     int dir;
+{
+  /* flips the data horizontally (dir=0) or vertically, like FlipPic() */
+
+  unsigned short *p1, *p2, t;
+  int             i, j, k, w, h, nc;
+
+  if (!deep) return;
+
+  w = deep->w;  h = deep->h;  nc = deep->nchan;
+  if (dir==0) {
+    for (i=0; i<h; i++) {
+      p1 = deep->data + i*w*nc;  p2 = p1 + (w-1)*nc;
+      for (j=0; j<w/2; j++, p1+=nc, p2-=nc)
+	for (k=0; k<nc; k++) { t = p1[k];  p1[k] = p2[k];  p2[k] = t; }
+    }
+  }
+  else {
+    for (i=0; i<h/2; i++) {
+      p1 = deep->data + i*w*nc;  p2 = deep->data + (h-1-i)*w*nc;
+      for (j=0; j<w*nc; j++, p1++, p2++) { t = *p1;  *p1 = *p2;  *p2 = t; }
+    }
+  }
+}
+
+
+
+/***********************************/
+static int restretch(install)
+     int install;
+{
+  /* rebuilds 'pic' from the deep data, using the current stretch, and
+     installs it if 'install' is set.  Returns '1' if it worked */
+
+  byte *buf, *pic2;
+  int   i;
+
+  if (!deep || !pic) return 0;
+  if (deep->w != pWIDE || deep->h != pHIGH) { StretchKill();  return 0; }
+
+  if (install) WaitCursor();
+
+  buf = (byte *) malloc((size_t) pWIDE * pHIGH * deep->nchan);
+  if (!buf) {
+    SetCursors(-1);
+    ErrPopUp("Not enough memory to change the stretch.", "\nBummer!");
+    return 0;
+  }
+  DeepStretch(deep, stretchMode, buf);
+
+  pic2 = (byte *) NULL;
+  if (deep->nchan == 1 && picType == PIC8) {
+    pic2 = buf;
+    for (i=0; i<256; i++) {
+      rMap[i] = deepr[i];  gMap[i] = deepg[i];  bMap[i] = deepb[i];
+    }
+  }
+  else if (deep->nchan == 1)
+    pic2 = Conv8to24(buf, pWIDE, pHIGH, deepr, deepg, deepb);
+  else if (picType == PIC24)
+    pic2 = buf;
+  else
+    pic2 = Conv24to8(buf, pWIDE, pHIGH, ncols, rMap, gMap, bMap);
+
+  if (!pic2) {
+    free(buf);
+    SetCursors(-1);
+    ErrPopUp("Not enough memory to change the stretch.", "\nBummer!");
+    return 0;
+  }
+
+  xvbcopy((char *) pic2, (char *) pic,
+	  (size_t) pWIDE * pHIGH * ((picType == PIC24) ? 3 : 1));
+  if (pic2 != buf) free(pic2);
+  free(buf);
+
+  if (install) {
+    InstallNewPic();
+    SetCursors(-1);
+    SetISTR(ISTR_INFO, "%s stretch of data from %.6g to %.6g.",
+	    StretchName(stretchMode), deep->min, deep->max);
+  }
+  return 1;
+}
+
+
+/***********************************/
+static double arcsinh(x)
+     double x;
+{
+  return log(x + sqrt(x*x + 1.0));
+}
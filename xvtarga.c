@@ -181,7 +181,7 @@ int WriteTarga(fp,pic,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle)
 /*******************************************/
 {
   int i, j;
-  byte *xpic;
+  byte *xpic, *line, *lp;
 
   /* write the header */
   for (i=0; i<12; i++) putc( (i==2) ? 2 : 0, fp);
@@ -194,25 +194,32 @@ int WriteTarga(fp,pic,ptype,w,h,rmap,gmap,bmap,numcols,colorstyle)
   putc(24,fp);
   putc(0x20,fp);
 
+  /* build each line (in BGR order) in 'line', and fwrite() it in one go */
+  line = (byte *) malloc((size_t) w * 3 + 1);
+  if (!line) FatalError("couldn't malloc line buffer in WriteTarga()");
+
   xpic = pic;
 
   for (i=0; i<h; i++) {
     if ((i&63)==0) WaitCursor();
 
-    for (j=0; j<w; j++) {
-      if (ptype==PIC8) {
-	putc(bmap[*xpic],fp);  putc(gmap[*xpic],fp);  putc(rmap[*xpic],fp);
-	xpic++;
+    lp = line;
+    if (ptype==PIC8) {
+      for (j=0; j<w; j++, xpic++, lp+=3) {
+	lp[0] = bmap[*xpic];  lp[1] = gmap[*xpic];  lp[2] = rmap[*xpic];
       }
-      else {  /* PIC24 */
-	putc(xpic[2], fp);  /* b */
-	putc(xpic[1], fp);  /* g */
-	putc(xpic[0], fp);  /* r */
-	xpic+=3;
+    }
+    else {  /* PIC24 */
+      for (j=0; j<w; j++, xpic+=3, lp+=3) {
+	lp[0] = xpic[2];  lp[1] = xpic[1];  lp[2] = xpic[0];
       }
     }
+
+    if (fwrite((char *) line, (size_t) 3, (size_t) w, fp) != w) break;
   }
 
+  free(line);
+
   if (ferror(fp)) return -1;
 
   return 0;
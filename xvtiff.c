@@ -18,6 +18,7 @@
 static byte *loadPalette PARM((TIFF *, uint32, uint32, int, int, PICINFO *));
 static byte *loadColor   PARM((TIFF *, uint32, uint32, int, int, PICINFO *));
 static int   loadImage   PARM((TIFF *, uint32, uint32, byte *, int));
+static int   loadDeep    PARM((TIFF *, uint32, uint32, byte *, PICINFO *));
 static void  _TIFFerr    PARM((const char *, const char *, va_list));
 static void  _TIFFwarn   PARM((const char *, const char *, va_list));
 
@@ -137,6 +138,8 @@ int LoadTIFF(fname, pinfo)
 
   if (error_occurred) {
     if (pic8) free(pic8);
+    if (pinfo->deep) DeepFree(pinfo->deep);
+    pinfo->deep = (DEEPPIC *) NULL;
     if (pinfo->comment) free(pinfo->comment);
     pinfo->comment = (char *) NULL;
     return 0;
@@ -222,7 +225,9 @@ static byte *loadColor(tif, w, h, photo, bps, pinfo)
 
   pic8 = (byte *) NULL;
 
-  if (loadImage(tif, w, h, pic24, 0)) {
+  if ((bps == 16 && photo == PHOTOMETRIC_RGB &&
+       loadDeep(tif, w, h, pic24, pinfo)) ||
+      loadImage(tif, w, h, pic24, 0)) {
     pinfo->type = PIC24;
     pic8 = pic24;
   }
@@ -232,6 +237,68 @@ static byte *loadColor(tif, w, h, photo, bps, pinfo)
 }
 
 
+/*******************************************/
+static int loadDeep(tif, w, h, pic24, pinfo)
+     TIFF *tif;
+     uint32 w,h;
+     byte *pic24;
+     PICINFO *pinfo;
+{
+  /* reads a 16-bit RGB image that's stored in contiguous strips into a
+     DEEPPIC, which keeps all 16 bits of the samples, and stretches it into
+     pic24.  Returns '0' (having read nothing) if the image isn't stored
+     like that, so that loadImage() can have a go at it, 8 bits at a time */
+
+  DEEPPIC *dp;
+  u_short  config, spp, orient, *buf, *bp, *sp;
+  uint32   row, y, i;
+  int      j;
+
+  TIFFGetFieldDefaulted(tif, TIFFTAG_PLANARCONFIG,    &config);
+  TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, &spp);
+  TIFFGetFieldDefaulted(tif, TIFFTAG_ORIENTATION,     &orient);
+
+  /* (LoadTIFF() has swapped the orientation around: BOTLEFT here means the
+     first row in the file is the top one) */
+  if (TIFFIsTiled(tif) || config != PLANARCONFIG_CONTIG || spp < 3 ||
+      (orient != ORIENTATION_BOTLEFT && orient != ORIENTATION_TOPLEFT))
+    return 0;
+
+  buf = (u_short *) malloc((size_t) TIFFScanlineSize(tif));
+  dp  = DeepAlloc((int) w, (int) h, 3);
+  if (!buf || !dp) {
+    if (buf) free(buf);
+    DeepFree(dp);
+    return 0;
+  }
+
+  dp->nlevels = 65536;
+  dp->min = 0.0;  dp->max = 65535.0;
+
+  for (row = 0; row < h; row++) {
+    if ((row & 0x3f) == 0) WaitCursor();
+    y  = (orient == ORIENTATION_BOTLEFT) ? row : h-1-row;
+    sp = dp->data + (size_t) y * w * 3;
+
+    if (TIFFReadScanline(tif, (tdata_t) buf, row, 0) < 0) {
+      for (i = 0; i < w*3; i++) *sp++ = 0;
+      continue;
+    }
+
+    for (i = 0, bp = buf; i < w; i++, bp += spp)
+      for (j = 0; j < 3; j++) {
+	*sp = bp[j];
+	dp->hist[*sp++]++;
+      }
+  }
+  free(buf);
+
+  DeepStretch(dp, stretchMode, pic24);
+  pinfo->deep = dp;
+  return 1;
+}
+
+
 /*******************************************/
 static void _TIFFerr(module, fmt, ap)
      const char *module;